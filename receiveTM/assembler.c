@@ -0,0 +1,827 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : assembler.c
+ * Header(s)     : assembler.h
+ * Description   : Turns the stream of received HDLC frames back into .roe
+ *                 image files and the imageindex.xml catalog. Image data is
+ *                 appended to image_buf.tmp until the 16 byte terminator
+ *                 (carrying the image file name) arrives, at which point the
+ *                 buffer is renamed into place. XML entries follow each image
+ *                 and are inserted just before the closing </CATALOG> tag.
+ *
+ *                 Image writes are group-committed under a flush_policy
+ *                 instead of an fflush() per frame; the file I/O itself is
+ *                 done by a storage back-end (storage.c, storage_uring.c).
+ *                 Per-frame messages only go to the verbose log (logger.c).
+ *                 Frames with a framing header (-H, framing.c) are placed by
+ *                 the header's type and byte offset instead of their length,
+ *                 and the image is checked against the CRC-32C (crc32c.c)
+ *                 its terminator carries.
+ *                 Each image's SHA-256 (sha256.c) is computed as it is
+ *                 written and recorded in <image>.sha256 and its catalog
+ *                 entry.
+ * Function(s)   : int assembler_open(tm_assembler*, const char*, const char*, const flush_policy*, int)
+ *                                                          - Prepare image buffer and catalog
+ *                 int assembler_resume(tm_assembler*, const char*, const image_map*)
+ *                                                          - Carry on with a recovered image
+ *                 int assembler_frame(tm_assembler*, unsigned char*, int)
+ *                                                          - Classify and store one frame
+ *                 int assembler_idle(tm_assembler*)        - Flush on the time limit
+ *                 int assembler_finish(tm_assembler*)      - Settle a pass that stopped mid-image
+ *                 int assembler_link_idle(tm_assembler*, unsigned int) - Settle after the link went quiet
+ *                 int assembler_drain(tm_assembler*)       - Finish I/O before the writer exits
+ *                 void assembler_close(tm_assembler*)      - Close open streams
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE                     //memmem
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "assembler.h"
+#include "logger.h"
+#include "crc32c.h"
+
+/* Integer value of <tag>...</tag> in an XML entry, or -1 */
+static long xml_value(const char *xml, const char *tag) {
+    const char *p = strstr(xml, tag);
+
+    if (p == NULL)
+        return -1;
+    return strtol(p + strlen(tag), NULL, 10);
+}
+
+/* Image bytes described by a <ROEIMAGE> entry: WIDTH x HEIGHT x BITPIX/8 x channels */
+static size_t xml_image_bytes(const char *xml) {
+    long width = xml_value(xml, "<WIDTH>");
+    long height = xml_value(xml, "<HEIGHT>");
+    long bitpix = xml_value(xml, "<BITPIX>");
+    const char *ch = strstr(xml, "<CHANNELS>");
+    long channels = 0;
+
+    if (ch != NULL)
+        for (ch += strlen("<CHANNELS>"); *ch >= '0' && *ch <= '9'; ch++)
+            channels++;                 //"123" lists three channels
+    if (width <= 0 || height <= 0 || bitpix <= 0 || channels == 0)
+        return 0;
+    return (size_t) width * height * ((bitpix + 7) / 8) * channels;
+}
+
+/* Local time as yymmddhhmmss, the form used for image and catalog names */
+void name_timestamp(char *buf, size_t size) {
+    time_t current_time;
+    struct tm ts;
+
+    time(&current_time);
+    ts = *localtime(&current_time);
+    strftime(buf, size, "%y%m%d%H%M%S", &ts);
+}
+
+/* Move the current catalog into xml_archive/ under a timestamped name */
+static void archive_catalog(tm_assembler *as) {
+    char timestamp[80];
+
+    name_timestamp(timestamp, sizeof (timestamp));
+    if (snprintf(as->archive_file, sizeof (as->archive_file), "%s/xml_archive/imageindex_%s%s",
+            as->data_dir, timestamp, ".xml") >= (int) sizeof (as->archive_file)) {
+        printf("catalog archive path too long: %s\n", as->archive_file);
+        return;
+    }
+    as->store.ops->catalog_archive(&as->store, as->archive_file);
+}
+
+int assembler_open(tm_assembler *as, const char *data_dir, const char *backend,
+                   const flush_policy *policy, int xml_check) {
+    char current_xml[TM_PATH_LEN];
+    char image_path[TM_PATH_LEN];
+    struct stat st;
+
+    memset(as, 0, sizeof (*as));
+    as->xml_check = xml_check;
+    as->image_bytes = ROE_IMAGE_BYTES;
+    sha256_init(&as->digest);
+
+    snprintf(as->data_dir, sizeof (as->data_dir), "%s", data_dir);
+    snprintf(current_xml, sizeof (current_xml), "%s/imageindex.xml", data_dir);
+    snprintf(image_path, sizeof (image_path), "%s/image_buf.tmp", data_dir);
+
+    /* Prepare image buffer/file pointer */
+    if (store_open(&as->store, backend, image_path, current_xml, policy) < 0)
+        return -1;
+    store_expect(&as->store, as->image_bytes);
+    if (store_image_prepare(&as->store) < 0)
+        return -1;
+
+    /*check if xml exists & archive*/
+    if (stat(current_xml, &st) == 0) {
+        archive_catalog(as);
+        as->xmlCount = 1;
+    }
+
+    /* Prepare xml buffer/file pointer */
+    return as->store.ops->catalog_open(&as->store);
+}
+
+/* Zeros to the end of a framed image whose last frames were lost */
+static int image_pad(tm_assembler *as, size_t upto) {
+    static const unsigned char zeros[65536];
+    size_t n;
+
+    while ((size_t) as->totalFileSize < upto) {
+        n = upto - as->totalFileSize;
+        if (n > sizeof (zeros))
+            n = sizeof (zeros);
+        if (store_image_write(&as->store, zeros, n) < 0)
+            return -1;
+        as->totalFileSize += n;
+    }
+    return 0;
+}
+
+/*
+ * CRC-32C of the framed image, with the len bytes at off. The CRC register is
+ * linear: bytes past crc_end continue it over the zeros of any hole before
+ * them, and a late frame inside a hole adds its own register, shifted over
+ * the bytes after it. Frame order does not matter.
+ */
+static void image_crc_add(tm_assembler *as, const unsigned char *buf, size_t len, size_t off) {
+    if (off >= as->crc_end) {
+        as->image_crc = crc32c(~crc32c_shift(~as->image_crc, off - as->crc_end), buf, len);
+        as->crc_end = off + len;
+    } else {
+        as->image_crc ^= crc32c_shift(~crc32c(~0u, buf, len), as->crc_end - off - len);
+    }
+}
+
+/*
+ * Compare the framed image with the CRC-32C its terminator gave; holes read
+ * as zeros and cannot match. Returns 1 if it matched.
+ */
+static int image_crc_check(tm_assembler *as, const char *name, size_t missing) {
+    __u32 crc;
+
+    if (missing > 0 || as->crc_unknown) {
+        as->framing.crc_unchecked++;
+        return 0;
+    }
+    crc = ~crc32c_shift(~as->image_crc, as->totalFileSize - as->crc_end);
+    if (crc == as->crc_want) {
+        as->framing.crc_match++;
+        return 1;
+    }
+    as->framing.crc_mismatch++;
+    log_msg("image %s: CRC-32C %08x, its terminator gave %08x\n", name, crc, as->crc_want);
+    return 0;
+}
+
+/* Image bytes at off into the digest, after the zeros of any hole before them */
+static void image_digest(tm_assembler *as, const unsigned char *buf, size_t len, size_t off) {
+    if (off < as->digest_end) {
+        as->digest_lost = 1;
+        return;
+    }
+    sha256_zeros(&as->digest, off - as->digest_end);
+    sha256_update(&as->digest, buf, len);
+    as->digest_end = off + len;
+}
+
+/*
+ * The image just saved under name: its digest, to <name>.sha256 now and to
+ * its catalog entry when that arrives (xml_write)
+ */
+static int image_digest_save(tm_assembler *as, const char *name) {
+    char path[TM_PATH_LEN + sizeof (DIGEST_EXT)];
+    char line[SHA256_HEX + TM_PATH_LEN + 4];
+    unsigned char digest[SHA256_LEN];
+    int len;
+
+    as->digest_ready = 0;
+    if (as->digest_lost) {
+        log_msg("image %s: data arrived out of order, no SHA-256 recorded\n", name);
+        as->digests_lost++;
+        return 0;
+    }
+    sha256_zeros(&as->digest, as->totalFileSize - as->digest_end);
+    sha256_final(&as->digest, digest);
+    sha256_hex(digest, as->digest_hex);
+    as->digest_ready = 1;
+    as->digests++;
+
+    /* sha256sum -c format, run in data_dir; as durable as the image it describes */
+    snprintf(path, sizeof (path), "%s%s", as->archive_file, DIGEST_EXT);
+    len = snprintf(line, sizeof (line), "%s  %s\n", as->digest_hex, name);
+    return store_sidecar_write(&as->store, path, line, len);
+}
+
+/*
+ * Save the image under name in data_dir and expect its catalog entry. A
+ * framed image with holes gets its completeness bitmap, <name>.map.
+ */
+static int image_done(tm_assembler *as, const char *name) {
+    char map_path[TM_PATH_LEN + sizeof (IMAGE_MAP_EXT)];
+    size_t missing = 0;
+    int matched = 0;
+
+    if (as->framed) {
+        if (as->image_len > (size_t) as->totalFileSize && as->image_len - as->totalFileSize <= FRAMING_MAX_HOLE &&
+                image_pad(as, as->image_len) < 0)
+            return -1;
+        missing = image_map_missing(&as->map, 0, as->totalFileSize);
+        if (as->crc_want_set)
+            matched = image_crc_check(as, name, missing);
+        /* a matching CRC-32C settles what the resumed bytes were */
+        if (as->resumed_unknown > 0 && !matched) {
+            log_msg("image %s: resumed at %zu bytes with no journal of its holes, completeness unknown\n",
+                    name, as->resumed_unknown);
+            as->framing.unmapped++;
+        }
+    }
+    if (snprintf(as->archive_file, sizeof (as->archive_file), "%s/%s", as->data_dir, name) >=
+            (int) sizeof (as->archive_file)) {
+        printf("image path too long: %s\n", as->archive_file);
+        return -1;
+    }
+    if (store_image_finish(&as->store, as->archive_file) < 0 || image_digest_save(as, name) < 0)
+        return -1;
+    if (missing > 0) {
+        snprintf(map_path, sizeof (map_path), "%s%s", as->archive_file, IMAGE_MAP_EXT);
+        log_msg("image %s: %zu of %d bytes missing, completeness map saved as %s\n", name, missing,
+                as->totalFileSize, map_path);
+        as->framing.incomplete++;
+        as->framing.missing += missing;
+        if (image_map_save(&as->map, map_path, as->totalFileSize) < 0)
+            return -1;
+    }
+    image_map_reset(&as->map);
+    as->image_len = 0;
+    as->image_crc = 0;
+    as->crc_end = 0;
+    as->crc_unknown = 0;
+    as->crc_want_set = 0;
+    as->resumed_unknown = 0;
+    sha256_init(&as->digest);
+    as->digest_end = 0;
+    as->digest_lost = 0;
+
+    as->xml_check = 1; // next image will be an xml
+    as->totalFileSize = 0;
+    as->index = 0;
+    as->image_id_set = 0;
+    return 0;
+}
+
+/*
+ * Catalog entry complete: take its geometry, set up the next image, close the
+ * catalog. An XML terminator with no entry started means the entry was lost;
+ * the catalog is left as it is.
+ */
+static int xml_done(tm_assembler *as) {
+    int open = (as->xml_check == 2);
+    size_t bytes;
+
+    if (!open) {
+        log_msg("catalog entry lost\n");
+        as->lost_entries++;
+    }
+
+    /* bytes held back for a </ROEIMAGE> that did not come */
+    if (open && as->xml_held > 0 &&
+            (as->store.ops->catalog_write(&as->store, as->xml_hold, as->xml_held) < 0 ||
+            as->store.ops->catalog_write(&as->store, "\n", 1) < 0))
+        return -1;
+    as->xml_held = 0;
+    if (as->digest_ready) {
+        log_msg("catalog entry without </ROEIMAGE>: SHA-256 only in <image>%s\n", DIGEST_EXT);
+        as->digests_unlisted++;
+        as->digest_ready = 0;
+    }
+
+    /* the next image is expected to have the geometry of this one */
+    bytes = open ? xml_image_bytes(as->xml_entry) : 0;
+    if (bytes > 0 && bytes != as->image_bytes) {
+        log_msg("catalog geometry: expecting %zu byte images\n", bytes);
+        as->image_bytes = bytes;
+        store_expect(&as->store, bytes);
+    }
+    as->xml_len = 0;
+    as->xml_entry[0] = 0;
+    if (store_image_prepare(&as->store) < 0)
+        return -1;
+
+    /* Include footer in xml and close it */
+    if (open && as->store.ops->catalog_close(&as->store) < 0)
+        return -1;
+    as->xml_check = 0; //next packet will be an image
+    as->totalFileSize = 0;
+    as->index = 0;
+    return 0;
+}
+
+/*
+ * Save an image that has no terminator: a full one as unterminated_<time>.roe,
+ * a short one as partial_<time>.roe, so neither passes for a flight image.
+ */
+static int image_settle(tm_assembler *as) {
+    char name[TM_PATH_LEN];
+    int full = (size_t) as->totalFileSize >= as->image_bytes;
+
+    strcpy(name, full ? "unterminated_" : "partial_");
+    name_timestamp(name + strlen(name), sizeof (name) - strlen(name));
+    strcat(name, ".roe");
+    log_msg("%s image: %d of %zu bytes, saved as %s\n", full ? "unterminated" : "partial",
+            as->totalFileSize, as->image_bytes, name);
+    if (!full)
+        as->partial_bytes += as->totalFileSize;
+    return image_done(as, name);
+}
+
+static int data_frame(tm_assembler *as, unsigned char *buf, int rc);
+
+/*
+ * A catalog entry arrived in place of image data once the image was full.
+ * The entry describes the image, so its <FILENAME> names it. The frame may
+ * live in the image mapping, which finishing the image unmaps: work on a copy.
+ */
+static int image_unterminated(tm_assembler *as, const unsigned char *buf, int rc) {
+    char *xml = malloc(rc + 1);
+    char *name;
+    char *end;
+    int ret;
+
+    if (xml == NULL) {
+        printf("assembler alloc error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    memcpy(xml, buf, rc);
+    xml[rc] = 0;
+    as->lost_image_terms++;
+
+    name = strstr(xml, "<FILENAME>");
+    end = name != NULL ? strstr(name, "</FILENAME>") : NULL;
+    if (end != NULL) {
+        *end = 0;
+        name = strrchr(name, '/') != NULL ? strrchr(name, '/') + 1 : name + strlen("<FILENAME>");
+    }
+    if (end != NULL && *name != 0 && end - name < 64) {
+        log_msg("image terminator lost: %d bytes saved as %s from its catalog entry\n", as->totalFileSize, name);
+        ret = image_done(as, name);
+        *end = '<';
+    } else {
+        ret = image_settle(as);
+    }
+    if (ret == 0)
+        ret = data_frame(as, (unsigned char *) xml, rc);
+    free(xml);
+    return ret;
+}
+
+/*
+ * Start the pass inside the image recovered at path (recover.c): its bytes go
+ * through the storage back-end like received data, so every back-end can
+ * resume, then the file is removed. A framed image's completeness map starts
+ * from the byte ranges the journal had (received), or with none its resumed
+ * bytes count as in but the image's completeness is unknown. Called before
+ * the threads start.
+ */
+int assembler_resume(tm_assembler *as, const char *path, const image_map *received) {
+    unsigned char *buf;
+    ssize_t rc;
+    size_t i;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    buf = malloc(FLUSH_DEFAULT_BYTES);
+    if (fd < 0 || buf == NULL) {
+        printf("resume open error=%d %s\n", errno, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        free(buf);
+        return -1;
+    }
+    while ((rc = read(fd, buf, FLUSH_DEFAULT_BYTES)) > 0) {
+        if (store_image_write(&as->store, buf, rc) < 0)
+            break;
+        as->image_crc = crc32c(as->image_crc, buf, rc);
+        sha256_update(&as->digest, buf, rc);
+        as->totalFileSize += rc;
+    }
+    if (rc < 0)
+        printf("resume read error=%d %s\n", errno, strerror(errno));
+    close(fd);
+    free(buf);
+    if (rc != 0)
+        return -1;
+    as->xml_check = 0;
+    as->crc_end = as->totalFileSize;
+    as->digest_end = as->totalFileSize;
+    unlink(path);
+    if (received == NULL) {
+        as->resumed_unknown = as->framed ? as->totalFileSize : 0;
+        return image_map_add(&as->map, 0, as->totalFileSize);
+    }
+    for (i = 0; i < received->n; i++)
+        if (image_map_add(&as->map, received->start[i], received->end[i] - received->start[i]) < 0)
+            return -1;
+    return 0;
+}
+
+/* Image data at the end of the image */
+static int image_write(tm_assembler *as, const unsigned char *buf, int rc) {
+    log_frame("received %d bytes       %d\n", rc, as->index);
+    if (store_image_write(&as->store, buf, rc) < 0)
+        return -1;
+    image_digest(as, buf, rc, as->totalFileSize);
+
+    as->totalFileSize += rc;
+    as->index++;
+    return 0;
+}
+
+/* First frame of a catalog entry */
+static int xml_start(tm_assembler *as) {
+    log_frame("xml_header = %s\n", XML_HEADER);
+    log_frame("packet is an xml \n");
+
+    /*if not the first, archive current xml*/
+    if (as->xmlCount > 0) {
+        archive_catalog(as);
+        if (as->store.ops->catalog_open(&as->store) < 0)
+            return -1;
+    }
+
+    as->xmlCount = 1;
+    as->xml_check = 2; //start saving xml data
+    as->xml_len = 0;
+    return 0;
+}
+
+/* Byte i of the bytes held back from the last frame followed by buf */
+static unsigned char xml_byte(const tm_assembler *as, const unsigned char *buf, int i) {
+    return i < as->xml_held ? (unsigned char) as->xml_hold[i] : buf[i - as->xml_held];
+}
+
+/* Catalog bytes [from, to) of the held bytes followed by buf */
+static int xml_put(tm_assembler *as, const unsigned char *buf, int from, int to) {
+    int held = as->xml_held;
+
+    if (from < held && as->store.ops->catalog_write(&as->store, as->xml_hold + from,
+            (to < held ? to : held) - from) < 0)
+        return -1;
+    if (to > held && from < to)
+        return as->store.ops->catalog_write(&as->store, (const char *) buf + (from > held ? from - held : 0),
+                to - (from > held ? from : held));
+    return 0;
+}
+
+/* Where </ROEIMAGE> starts in the held bytes followed by buf, -1 if it is not in them */
+static int xml_footer_at(const tm_assembler *as, const unsigned char *buf, int rc) {
+    int flen = strlen(XML_FOOTER);
+    char win[2 * sizeof (XML_FOOTER)];
+    const char *p;
+    int n = rc < flen - 1 ? rc : flen - 1;
+
+    /* one that starts in the held bytes ends in the first flen - 1 of buf */
+    memcpy(win, as->xml_hold, as->xml_held);
+    memcpy(win + as->xml_held, buf, n);
+    p = memmem(win, as->xml_held + n, XML_FOOTER, flen);
+    if (p != NULL)
+        return p - win;
+    p = memmem(buf, rc, XML_FOOTER, flen);
+    return p != NULL ? as->xml_held + (int) (p - (const char *) buf) : -1;
+}
+
+/* Length of the longest tail of the held bytes and buf that could begin </ROEIMAGE> */
+static int xml_footer_tail(const tm_assembler *as, const unsigned char *buf, int rc) {
+    int n = as->xml_held + rc;
+    int k = n < (int) strlen(XML_FOOTER) - 1 ? n : (int) strlen(XML_FOOTER) - 1;
+    int i;
+
+    for (; k > 0; k--) {
+        for (i = 0; i < k && xml_byte(as, buf, n - k + i) == (unsigned char) XML_FOOTER[i]; i++)
+            ;
+        if (i == k)
+            break;
+    }
+    return k;
+}
+
+static int xml_write(tm_assembler *as, const unsigned char *buf, int rc) {
+    char tag[SHA256_HEX + 32];
+    char hold[sizeof (XML_FOOTER)];
+    int n = as->xml_held + rc;
+    int at = -1, keep = 0, len, i;
+
+    log_frame("received %d bytes       %d       [ XML ]\n", rc, as->index);
+
+    /*
+     * write new received xml to disk; catalog entries are small, they are
+     * flushed with the XML terminator. While the digest waits for its
+     * </ROEIMAGE>, a frame tail that could begin one is held back and put in
+     * front of the next frame, so a footer split across frames is found too.
+     */
+    if (as->digest_ready) {
+        at = xml_footer_at(as, buf, rc);
+        if (at < 0)
+            keep = xml_footer_tail(as, buf, rc);
+    }
+    if (at >= 0) {
+        /* the digest of the image the entry describes, just before </ROEIMAGE> */
+        len = snprintf(tag, sizeof (tag), "\t<SHA256>%s</SHA256>\n", as->digest_hex);
+        if (xml_put(as, buf, 0, at) < 0 ||
+                as->store.ops->catalog_write(&as->store, tag, len) < 0 ||
+                xml_put(as, buf, at, n) < 0)
+            return -1;
+        as->digest_ready = 0;
+    } else if (xml_put(as, buf, 0, n - keep) < 0) {
+        return -1;
+    }
+    if (as->store.ops->catalog_write(&as->store, "\n", 1) < 0)
+        return -1;
+    for (i = 0; i < keep; i++)
+        hold[i] = xml_byte(as, buf, n - keep + i);
+    memcpy(as->xml_hold, hold, keep);
+    as->xml_held = keep;
+
+    /* keep the entry text for its geometry */
+    if (as->xml_len + rc < sizeof (as->xml_entry)) {
+        memcpy(as->xml_entry + as->xml_len, buf, rc);
+        as->xml_len += rc;
+        as->xml_entry[as->xml_len] = 0;
+    }
+
+    as->totalFileSize += rc;
+    as->index++;
+    return 0;
+}
+
+/* A catalog entry that gets no XML terminator: closed if complete, dropped if not */
+static int xml_settle(tm_assembler *as) {
+    size_t written;
+
+    if (strstr(as->xml_entry, XML_FOOTER) != NULL) {
+        log_msg("catalog entry complete but not terminated, closing the catalog\n");
+    } else {
+        written = as->totalFileSize + as->index - as->xml_held;  //each frame is followed by a newline
+        as->xml_held = 0;
+        log_msg("catalog entry incomplete: %zu bytes dropped, closing the catalog\n", written);
+        if (as->store.ops->catalog_discard(&as->store, written) < 0)
+            return -1;
+        as->xml_dropped += written;
+    }
+    return xml_done(as);
+}
+
+static int image_term(tm_assembler *as, unsigned char *buf, int rc) {
+    /* Terminating characters for image */
+    log_msg("received %d bytes       %d       [ TERM ]\n", rc, as->index);
+    log_msg("%d total bytes received for file: %s\n", as->totalFileSize, buf);
+    log_msg("creating new image buffer\n");
+
+    /* Flush the stream, save the image, free up the buffer*/
+    return image_done(as, (char *) buf);
+}
+
+static int xml_term(tm_assembler *as, int rc) {
+    /* Terminating characters for xml */
+    log_msg("received %d bytes       %d       [ TERM ]\n", rc, as->index);
+    log_msg("%d total bytes received for updating xml\n", as->totalFileSize);
+
+    /* both terminators lost: the entry went into the image, which must still end here */
+    if (as->xml_check == 0 && as->totalFileSize > 0 && (size_t) as->totalFileSize >= as->image_bytes) {
+        log_msg("image and catalog terminators lost, closing the image\n");
+        as->lost_image_terms++;
+        if (image_settle(as) < 0)
+            return -1;
+    }
+    return xml_done(as);
+}
+
+/* Image or catalog data, told apart by xml_check and the entry's first bytes */
+static int data_frame(tm_assembler *as, unsigned char *buf, int rc) {
+    if (as->xml_check == 0 && as->totalFileSize > 0 && (size_t) as->totalFileSize >= as->image_bytes &&
+            strncmp((char *) buf, XML_HEADER, strlen(XML_HEADER)) == 0) {
+        /* the image is full and its entry is here: the image terminator was lost */
+        return image_unterminated(as, buf, rc);
+    }
+    if (as->xml_check == 2 && strstr(as->xml_entry, XML_FOOTER) != NULL) {
+        /* more data after a complete entry: the XML terminator was lost */
+        log_msg("catalog terminator lost, closing the catalog entry\n");
+        as->lost_xml_terms++;
+        if (xml_done(as) < 0)
+            return -1;
+    }
+    if (as->xml_check == 1) {
+        /* check if the first few characters look like an xml */
+        if (strncmp((char *) buf, XML_HEADER, strlen(XML_HEADER)) == 0) {
+            /* header matches xml format */
+            if (xml_start(as) < 0)
+                return -1;
+        } else {
+            as->xml_check = 0; // mistake: this file is not xml
+            store_no_landing(&as->store);
+        }
+
+    }
+    if (as->xml_check == 2) //start saving xml data
+        return xml_write(as, buf, rc);
+
+    /* image packet */
+    /* save received data to image file */
+    return image_write(as, buf, rc);
+}
+
+/*
+ * Image data with a framing header: written at its offset, so frames lost
+ * before it leave a hole and a late one fills its hole in place. A frame the
+ * image already holds all of is dropped. totalFileSize is the furthest end.
+ */
+static int framed_data(tm_assembler *as, const frame_hdr *h, unsigned char *buf, int rc) {
+    size_t have = as->totalFileSize;
+    size_t missing;
+
+    if (h->offset > have && h->offset - have > FRAMING_MAX_HOLE) {
+        as->framing.bad++;
+        log_msg("image %u: frame at byte %u is past a %zu byte hole, dropped\n", h->image, h->offset,
+                (size_t) h->offset - have);
+        return 0;
+    }
+    missing = image_map_missing(&as->map, h->offset, rc);
+    if (missing == 0) {
+        as->framing.overlap += rc;
+        return 0;
+    }
+    log_frame("received %d bytes at %u       %d\n", rc, h->offset, as->index);
+    if (store_image_write_at(&as->store, buf, rc, h->offset) < 0 || image_map_add(&as->map, h->offset, rc) < 0)
+        return -1;
+    if (missing == (size_t) rc)
+        image_crc_add(as, buf, rc, h->offset);
+    else
+        as->crc_unknown = 1;
+    image_digest(as, buf, rc, h->offset);
+    if (h->offset + rc > have)
+        as->totalFileSize = h->offset + rc;
+    as->index++;
+    return 0;
+}
+
+/*
+ * A frame with a framing header (-H): the header's type says what it is and
+ * the image id tells images apart, so terminators lost with the frames
+ * around them are detected exactly rather than from sizes.
+ */
+static int framed_frame(tm_assembler *as, unsigned char *buf, int rc) {
+    unsigned char *p = buf + FRAMING_HDR_LEN;
+    frame_hdr h;
+    long lost;
+    int len;
+
+    len = framing_parse(&h, buf, rc);
+    if (len < 0) {
+        as->framing.bad++;
+        log_msg("frame of %d bytes without a framing header, dropped\n", rc);
+        return 0;
+    }
+    lost = framing_seq(&as->framing, &h);
+    if (lost < 0) {
+        /* late image data still fills a hole of the image in progress */
+        if (h.type != FRAMING_DATA || as->xml_check != 0 || !as->image_id_set || h.image != as->image_id ||
+                image_map_missing(&as->map, h.offset, len) == 0) {
+            log_frame("stream %u: frame %u repeated or late, dropped\n", h.stream, h.seq);
+            return 0;
+        }
+        as->framing.refilled++;
+    }
+    if (lost > 0)
+        log_msg("stream %u: %ld frames lost before frame %u of image %u\n", h.stream, lost, h.seq, h.image);
+
+    /* the image in progress ends before anything of another image */
+    if (as->xml_check == 0 && as->totalFileSize > 0 && as->image_id_set && h.image != as->image_id &&
+            h.type != FRAMING_XML && h.type != FRAMING_TERM_XML) {
+        log_msg("image %u: terminator and catalog entry lost\n", as->image_id);
+        as->lost_image_terms++;
+        if (image_settle(as) < 0)
+            return -1;
+    }
+
+    switch (h.type) {
+        case FRAMING_DATA:
+            if (as->xml_check == 2) {
+                log_msg("catalog terminator lost, closing the catalog entry\n");
+                as->lost_xml_terms++;
+                if (xml_settle(as) < 0)
+                    return -1;
+            } else if (as->xml_check == 1) {
+                log_msg("catalog entry lost\n");
+                as->lost_entries++;
+                as->xml_check = 0;
+                store_no_landing(&as->store);
+            }
+            as->image_id = h.image;
+            as->image_id_set = 1;
+            return framed_data(as, &h, p, len);
+        case FRAMING_TERM_IMAGE:
+            /* the image is this long, whatever of its end was lost */
+            if (as->xml_check == 0 && as->image_id_set) {
+                as->image_len = h.offset;
+                as->crc_want = h.image_crc;
+                as->crc_want_set = h.crc;
+            }
+            p[len] = 0;                 //the name, without the CRC-32C after it
+            return image_term(as, p, len);
+        case FRAMING_XML:
+            if (as->xml_check == 0 && as->totalFileSize > 0) {
+                /* data for the entry: the image terminator was lost */
+                if (h.offset == 0)
+                    return image_unterminated(as, p, len);
+                log_msg("image terminator lost\n");
+                as->lost_image_terms++;
+                if (image_settle(as) < 0)
+                    return -1;
+            }
+            if (as->xml_check != 2 && xml_start(as) < 0)
+                return -1;
+            return xml_write(as, p, len);
+        default:
+            /* the header says an entry ends here: an image still open lost its terminator, full or not */
+            if (as->xml_check == 0 && as->totalFileSize > 0) {
+                log_msg("image terminator lost\n");
+                as->lost_image_terms++;
+                if (image_settle(as) < 0)
+                    return -1;
+            }
+            /* with no entry open (xml_check != 2) it was lost: counted, the catalog left closed */
+            return xml_term(as, len);
+    }
+}
+
+int assembler_frame(tm_assembler *as, unsigned char *buf, int rc) {
+    if (as->framed)
+        return framed_frame(as, buf, rc);
+    if (rc == TERM_IMAGE_LEN)
+        return image_term(as, buf, rc);
+    if (rc == TERM_XML_LEN)
+        return xml_term(as, rc);
+    /* data packet */
+    return data_frame(as, buf, rc);
+}
+
+/* Flush image data that has waited longer than flush_ms */
+int assembler_idle(tm_assembler *as) {
+    return store_idle(&as->store);
+}
+
+/*
+ * Called by the writer thread once the ring is drained, whether the pass
+ * ended or was stopped. Image data with no terminator is kept under a name
+ * that cannot be mistaken for a flight image; a catalog entry with no XML
+ * terminator is closed if it is complete and dropped otherwise, so
+ * imageindex.xml always ends with </CATALOG>. The capture journal (-j) still
+ * holds every frame of either.
+ */
+int assembler_finish(tm_assembler *as) {
+    if (as->xml_check == 0 && as->totalFileSize > 0) {
+        if (image_settle(as) < 0)
+            return -1;
+    } else if (as->xml_check == 2) {
+        if (xml_settle(as) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*
+ * No frame for idle_ms (a FRAME_IDLE marker from the reader): whatever is in
+ * progress lost its terminator, so settle it now rather than let the next
+ * image merge into it. Whatever comes next may be an entry or an image.
+ */
+int assembler_link_idle(tm_assembler *as, unsigned int idle_ms) {
+    if (!(as->xml_check == 0 && as->totalFileSize > 0) && as->xml_check != 2)
+        return 0;
+    log_msg("link idle for %u ms mid-%s\n", idle_ms, as->xml_check == 2 ? "entry" : "image");
+    as->idle_finished++;
+    return assembler_finish(as);
+}
+
+/* Called by the writer thread once the ring is drained */
+int assembler_drain(tm_assembler *as) {
+    return store_drain(&as->store);
+}
+
+void assembler_close(tm_assembler *as) {
+    store_close(&as->store);
+    image_map_free(&as->map);
+}
@@ -0,0 +1,122 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : assembler.h
+ * Source(s)     : assembler.c
+ * Description   : Frame classification and image/XML assembly. Frames are
+ *                 told apart by length and xml_check state exactly as the
+ *                 flightSW sends them:
+ *                     16 bytes  - image terminator, payload is the file name
+ *                     14 bytes  - XML terminator
+ *                     otherwise - image data, or XML data after a terminator
+ *
+ *                 The <ROEIMAGE> entry that follows each image gives its
+ *                 geometry; the next image is expected to be the same size,
+ *                 which lets the storage back-end preallocate it.
+ *
+ *                 A terminator lost to a CRC error must not merge images:
+ *                 an entry arriving once the image holds its expected size
+ *                 finishes the image (named from the entry's <FILENAME>),
+ *                 image data after a complete entry closes the entry, and a
+ *                 link that goes idle settles whatever is in progress.
+ *
+ *                 With a framing header on every frame (-H, framing.h) the
+ *                 header's type and byte offset are used instead: image data
+ *                 is written at its offset, an image with holes gets a
+ *                 completeness bitmap (imagemap.h), and a lost terminator
+ *                 shows up as data of the next image. The image's CRC-32C is
+ *                 kept up as frames are written, in whatever order, and
+ *                 checked against the one its terminator carries.
+ *
+ *                 Every image is hashed (SHA-256, sha256.h) as its data is
+ *                 written. When it is saved the digest goes to <image>.sha256
+ *                 in sha256sum format, and into the image's catalog entry as
+ *                 <SHA256>, just before </ROEIMAGE> (even one split across
+ *                 frames). The sidecar goes through the storage back-end and
+ *                 is synced under -S like the image. Holes hash as the zeros
+ *                 they read as; a frame that lands in bytes already hashed
+ *                 (a late one, -H) leaves the image without a digest.
+ *
+ *                 How the bytes reach the disk is up to the storage
+ *                 back-end (storage.h) selected at assembler_open().
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+#include <stdio.h>
+
+#include "storage.h"
+#include "framing.h"
+#include "imagemap.h"
+#include "sha256.h"
+
+#define TM_DATA_DIR  "/media/moses/Data/TM_data"
+
+#define TERM_IMAGE_LEN 16
+#define TERM_XML_LEN   14
+#define XML_HEADER     "<ROEIMAGE>"     //first bytes of a catalog entry
+#define XML_FOOTER     "</ROEIMAGE>"    //and its last
+
+#define ROE_IMAGE_BYTES (2048 * 1024 * 2 * 3)   //WIDTH x HEIGHT x BITPIX/8 x CHANNELS "123"
+#define XML_ENTRY_LEN   4096
+#define DIGEST_EXT      ".sha256"
+
+typedef struct tm_assembler {
+    tm_store store;                     //image_buf.tmp and imageindex.xml
+    int   xmlCount;
+    int   xml_check;                    //'0' expecting ROE; '1' expecting XML
+    int   totalFileSize;
+    int   index;
+    char  data_dir[TM_PATH_LEN];
+    char  archive_file[TM_PATH_LEN];
+    char  xml_entry[XML_ENTRY_LEN];     //<ROEIMAGE> entry being received
+    size_t xml_len;
+    size_t image_bytes;                 //geometry of the last catalog entry
+    int   partial_bytes;                //image data kept as partial_*.roe by assembler_finish()
+    int   xml_dropped;                  //bytes of an incomplete catalog entry dropped by it
+    unsigned long lost_image_terms;     //images finished without their terminator
+    unsigned long lost_xml_terms;       //catalog entries closed without theirs
+    unsigned long lost_entries;         //XML terminators with no catalog entry before them
+    unsigned long idle_finished;        //images or entries settled after the link went idle
+    int   framed;                       //frames carry a framing header (-H)
+    framing_state framing;
+    __u32 image_id;                     //framing image id of the image in progress...
+    int   image_id_set;                 //...once one of its frames is in
+    image_map map;                      //framed image bytes received
+    size_t resumed_unknown;             //bytes resumed with no record of their holes, 0 none
+    size_t image_len;                   //length the framed image terminator gave, 0 none
+    __u32 image_crc;                    //CRC-32C of the framed image, zeros in its holes...
+    size_t crc_end;                     //...up to this byte
+    int   crc_unknown;                  //a frame overlapped bytes already in, the CRC lost track
+    __u32 crc_want;                     //CRC-32C the image terminator carried...
+    int   crc_want_set;                 //...if it carried one
+    sha256_ctx digest;                  //SHA-256 of the image in progress...
+    size_t digest_end;                  //...up to this byte
+    int   digest_lost;                  //a frame landed in bytes already hashed
+    char  digest_hex[SHA256_HEX];       //digest of the last image saved...
+    int   digest_ready;                 //...until its catalog entry has it
+    char  xml_hold[sizeof (XML_FOOTER)]; //catalog bytes held back meanwhile, maybe a split </ROEIMAGE>
+    int   xml_held;
+    unsigned long digests;              //images saved with a digest
+    unsigned long digests_lost;         //...and without
+    unsigned long digests_unlisted;     //saved with one, but their catalog entry never got it
+} tm_assembler;
+
+void name_timestamp(char *buf, size_t size);
+int  assembler_open(tm_assembler *as, const char *data_dir, const char *backend,
+                    const flush_policy *policy, int xml_check);
+int  assembler_resume(tm_assembler *as, const char *path, const image_map *received);
+int  assembler_frame(tm_assembler *as, unsigned char *buf, int rc);
+int  assembler_idle(tm_assembler *as);
+int  assembler_finish(tm_assembler *as);
+int  assembler_link_idle(tm_assembler *as, unsigned int idle_ms);
+int  assembler_drain(tm_assembler *as);
+void assembler_close(tm_assembler *as);
+
+#endif /* ASSEMBLER_H */
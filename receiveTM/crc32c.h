@@ -0,0 +1,43 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : crc32c.h
+ * Source(s)     : crc32c.c
+ * Description   : CRC-32C (Castagnoli, reflected polynomial 0x82f63b78) of
+ *                 framed frames and images, end to end from the flight
+ *                 computer (framing.h). The link's CRC-16 is checked by the
+ *                 Synclink hardware and only shows up as a count; this one
+ *                 is checked on every frame and names the frame that failed.
+ *
+ *                 crc32c() runs on the SSE4.2 crc32 instruction when the CPU
+ *                 has it, else on slice-by-8 tables; crc32c_init() picks one
+ *                 and must run before any thread uses them. Either is orders
+ *                 of magnitude faster than the 10 Mbps downlink, see
+ *                 tmgen -b.
+ *
+ *                 crc32c(crc, buf, len) continues crc over buf, starting
+ *                 from 0, like zlib's crc32(). crc32c_shift() advances the
+ *                 raw CRC register over zero bytes in O(log len), which lets
+ *                 the CRC of an image be built from frames that arrive out of
+ *                 order or not at all (assembler.c).
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <linux/types.h>
+
+#define CRC32C_POLY 0x82f63b78          //Castagnoli, bit-reversed
+
+const char *crc32c_init(void);
+__u32 crc32c(__u32 crc, const void *buf, size_t len);
+__u32 crc32c_sw(__u32 crc, const void *buf, size_t len);
+__u32 crc32c_shift(__u32 reg, size_t len);
+
+#endif /* CRC32C_H */
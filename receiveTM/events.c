@@ -0,0 +1,253 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : events.c
+ * Header(s)     : events.h
+ * Description   : epoll set of the reader thread: frame source, signalfd,
+ *                 stop eventfd, the due time of a paced source and periodic
+ *                 timerfds.
+ * Function(s)   : int events_open(rx_events*, int)   - Build the epoll set around a source fd
+ *                 int events_timer(rx_events*, unsigned int, event_fn, void*)
+ *                                                    - Run a handler every period_ms
+ *                 int events_wait(rx_events*, __u64) - Sleep until the source is readable
+ *                 int events_poll(rx_events*, __u64) - Run due timers without sleeping
+ *                 void events_stop(rx_events*)       - Stop the reader, from any thread
+ *                 void events_raise(rx_events*, int) - Pass a signal on to another reader
+ *                 void events_resume(rx_events*)     - Keep going after a signal
+ *                 void events_close(rx_events*)
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "events.h"
+
+#define EV_SRC   0
+#define EV_SIG   1
+#define EV_STOP  2
+#define EV_DUE   3
+#define EV_TIMER 4                      //EV_TIMER + index into ev->timers
+
+#define EVENTS_POLL_NS (50 * 1000000ull)        //signals are noticed this soon while frames keep coming
+
+static __u64 events_now(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (__u64) now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static int events_add(rx_events *ev, int fd, __u32 tag) {
+    struct epoll_event e;
+
+    memset(&e, 0, sizeof (e));
+    e.events = EPOLLIN;
+    e.data.u32 = tag;
+    if (epoll_ctl(ev->epfd, EPOLL_CTL_ADD, fd, &e) < 0) {
+        printf("epoll_ctl error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* Earliest of the periodic timers, and never later than EVENTS_POLL_NS from now */
+static void events_next(rx_events *ev, __u64 now) {
+    __u64 due;
+    int i;
+
+    ev->next_ns = now + EVENTS_POLL_NS;
+    for (i = 0; i < ev->ntimers; i++) {
+        /* a timer about to fire is looked at again shortly, not on every frame */
+        due = ev->timers[i].due_ns > now ? ev->timers[i].due_ns : now + 100000;
+        if (due < ev->next_ns)
+            ev->next_ns = due;
+    }
+}
+
+int events_open(rx_events *ev, int src_fd) {
+    sigset_t sigs;
+
+    memset(ev, 0, sizeof (*ev));
+    ev->src_fd = src_fd;
+
+    /* SIGINT and SIGTERM are blocked in every thread and arrive here instead */
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+
+    ev->epfd    = epoll_create1(EPOLL_CLOEXEC);
+    ev->sig_fd  = signalfd(-1, &sigs, SFD_NONBLOCK | SFD_CLOEXEC);
+    ev->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ev->due_fd  = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (ev->epfd < 0 || ev->sig_fd < 0 || ev->stop_fd < 0 || ev->due_fd < 0) {
+        printf("event loop setup error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    if ((src_fd >= 0 && events_add(ev, src_fd, EV_SRC) < 0) ||
+            events_add(ev, ev->sig_fd, EV_SIG) < 0 ||
+            events_add(ev, ev->stop_fd, EV_STOP) < 0 ||
+            events_add(ev, ev->due_fd, EV_DUE) < 0)
+        return -1;
+    events_next(ev, events_now());
+    return 0;
+}
+
+int events_timer(rx_events *ev, unsigned int period_ms, event_fn fn, void *arg) {
+    event_timer *t = &ev->timers[ev->ntimers];
+    struct itimerspec its;
+
+    if (ev->ntimers == EVENTS_TIMERS || period_ms == 0) {
+        printf("event loop: cannot add a %u ms timer\n", period_ms);
+        return -1;
+    }
+    t->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (t->fd < 0) {
+        printf("timerfd error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    memset(&its, 0, sizeof (its));
+    its.it_value.tv_sec     = period_ms / 1000;
+    its.it_value.tv_nsec    = (period_ms % 1000) * 1000000L;
+    its.it_interval         = its.it_value;
+    if (timerfd_settime(t->fd, 0, &its, NULL) < 0 || events_add(ev, t->fd, EV_TIMER + ev->ntimers) < 0) {
+        printf("timerfd error=%d %s\n", errno, strerror(errno));
+        close(t->fd);
+        return -1;
+    }
+    t->period_ms = period_ms;
+    t->due_ns = events_now() + (__u64) period_ms * 1000000ull;
+    t->fn = fn;
+    t->arg = arg;
+    ev->ntimers++;
+    events_next(ev, events_now());
+    return 0;
+}
+
+/* Handle what epoll_wait() returned; returns -1 once the reader must stop */
+static int events_dispatch(rx_events *ev, struct epoll_event *evs, int n) {
+    struct signalfd_siginfo si;
+    event_timer *t;
+    __u64 count;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        switch (evs[i].data.u32) {
+            case EV_SRC:
+                break;
+            case EV_SIG:
+                if (read(ev->sig_fd, &si, sizeof (si)) == sizeof (si)) {
+                    ev->signo = si.ssi_signo;
+                    ev->signalled = 1;
+                    ev->stopped = 1;
+                }
+                break;
+            case EV_STOP:
+                if (read(ev->stop_fd, &count, sizeof (count)) == sizeof (count)) {
+                    ev->signo = __atomic_exchange_n(&ev->raised, 0, __ATOMIC_ACQUIRE);
+                    ev->signalled = 0;
+                    ev->stopped = 1;
+                }
+                break;
+            case EV_DUE:
+                if (read(ev->due_fd, &count, sizeof (count)) < 0)
+                    count = 0;
+                break;
+            default:
+                t = &ev->timers[evs[i].data.u32 - EV_TIMER];
+                if (read(t->fd, &count, sizeof (count)) != sizeof (count))
+                    break;
+                t->due_ns += count * t->period_ms * 1000000ull;
+                t->fn(t->arg);
+                break;
+        }
+    }
+    events_next(ev, events_now());
+    return ev->stopped ? -1 : 0;
+}
+
+/*
+ * Sleep until the source may be readable again: its fd became readable, its
+ * due time (CLOCK_MONOTONIC ns, 0 if none) passed, or a timer ran. Returns
+ * -1 when a signal or events_stop() asks the reader to stop.
+ */
+int events_wait(rx_events *ev, __u64 due_ns) {
+    struct epoll_event evs[EVENTS_TIMERS + 4];
+    struct itimerspec its;
+    int n;
+
+    if (due_ns != 0) {
+        memset(&its, 0, sizeof (its));
+        its.it_value.tv_sec  = due_ns / 1000000000ull;
+        its.it_value.tv_nsec = due_ns % 1000000000ull;
+        timerfd_settime(ev->due_fd, TFD_TIMER_ABSTIME, &its, NULL);
+    }
+    do {
+        ev->waits++;
+        n = epoll_wait(ev->epfd, evs, EVENTS_TIMERS + 4, -1);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        printf("epoll_wait error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    return events_dispatch(ev, evs, n);
+}
+
+/* Called between frames: only makes a syscall once a timer is due */
+int events_poll(rx_events *ev, __u64 now_ns) {
+    struct epoll_event evs[EVENTS_TIMERS + 4];
+    int n;
+
+    if (now_ns < ev->next_ns)
+        return ev->stopped ? -1 : 0;
+    ev->waits++;
+    n = epoll_wait(ev->epfd, evs, EVENTS_TIMERS + 4, 0);
+    if (n < 0 && errno != EINTR) {
+        printf("epoll_wait error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    return events_dispatch(ev, evs, n > 0 ? n : 0);
+}
+
+void events_stop(rx_events *ev) {
+    __u64 one = 1;
+
+    if (write(ev->stop_fd, &one, sizeof (one)) < 0)
+        printf("event loop stop error=%d %s\n", errno, strerror(errno));
+}
+
+/* As if signo had reached this reader's signalfd, from any thread */
+void events_raise(rx_events *ev, int signo) {
+    __atomic_store_n(&ev->raised, signo, __ATOMIC_RELEASE);
+    events_stop(ev);
+}
+
+/* The reader chose to carry on after a signal; the next one stops it again */
+void events_resume(rx_events *ev) {
+    ev->stopped = 0;
+}
+
+void events_close(rx_events *ev) {
+    int i;
+
+    for (i = 0; i < ev->ntimers; i++)
+        close(ev->timers[i].fd);
+    close(ev->due_fd);
+    close(ev->stop_fd);
+    close(ev->sig_fd);
+    close(ev->epfd);
+    ev->ntimers = 0;
+}
@@ -0,0 +1,73 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : events.h
+ * Source(s)     : events.c
+ * Description   : epoll event loop of the reader thread. One epoll set
+ *                 holds the frame source fd, a signalfd for SIGINT/SIGTERM,
+ *                 an eventfd other threads use to stop the reader, a timerfd
+ *                 armed at the due time of a paced source, and periodic
+ *                 timerfds whose handlers run on schedule whether or not
+ *                 frames arrive.
+ *
+ *                 The source fd is non-blocking: the reader reads until a
+ *                 read fails with EAGAIN and only then waits in
+ *                 events_wait(), so a backlog costs one read() per frame
+ *                 and no extra syscall. While frames keep coming the
+ *                 timers are checked with events_poll(), which only makes a
+ *                 syscall once the next timer is due. Sources that are
+ *                 always readable (regular files) are not in the set.
+ *
+ *                 With several readers in one process each has its own set;
+ *                 a signal is read by whichever signalfd gets to it first,
+ *                 and that reader hands it on with events_raise().
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <linux/types.h>
+
+#define EVENTS_TIMERS 8
+
+typedef void (*event_fn)(void *arg);
+
+typedef struct event_timer {
+    int            fd;
+    unsigned int   period_ms;
+    __u64          due_ns;              //CLOCK_MONOTONIC of the next expiry
+    event_fn       fn;
+    void          *arg;
+} event_timer;
+
+typedef struct rx_events {
+    int            epfd;
+    int            src_fd;              //-1 if the source is always readable
+    int            sig_fd;
+    int            stop_fd;
+    int            due_fd;              //paced source: its next frame is due
+    event_timer    timers[EVENTS_TIMERS];
+    int            ntimers;
+    __u64          next_ns;             //earliest timer expiry
+    int            signo;               //signal that stopped the reader, 0 for events_stop()
+    int            signalled;           //...and it came through this reader's own signalfd
+    int            raised;              //signal passed on by events_raise(), not yet seen
+    int            stopped;
+    unsigned long  waits;               //epoll_wait() calls
+} rx_events;
+
+int  events_open(rx_events *ev, int src_fd);
+int  events_timer(rx_events *ev, unsigned int period_ms, event_fn fn, void *arg);
+int  events_wait(rx_events *ev, __u64 due_ns);
+int  events_poll(rx_events *ev, __u64 now_ns);
+void events_stop(rx_events *ev);
+void events_raise(rx_events *ev, int signo);
+void events_resume(rx_events *ev);
+void events_close(rx_events *ev);
+
+#endif /* EVENTS_H */
@@ -0,0 +1,212 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : fec.c
+ * Header(s)     : fec.h
+ * Description   : Reed-Solomon decoder threads of one link. Each takes the
+ *                 next frame the reader published, decodes it into the
+ *                 slot's spare buffer and trades the two, so nothing is
+ *                 copied back; the writer gets the frames in order from the
+ *                 ring. Decoding a clean frame is a few microseconds, so
+ *                 one thread keeps up with the 10 Mbps downlink many times
+ *                 over (tmgen -b); more ride out bursts of errors, whose
+ *                 codewords take the full decoder.
+ * Function(s)   : int fec_parse(fec_config*, const char*) - "depth[:threads]"
+ *                 int fec_open(fec_pool*, frame_ring*, const fec_config*, int, const char*)
+ *                                                  - Spare buffers, stage the ring
+ *                 int fec_start(fec_pool*)         - Start the decoder threads
+ *                 void fec_stop(fec_pool*)         - Join them once the ring is closed
+ *                 void fec_report(const fec_pool*)
+ *                 void fec_free(fec_pool*)
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "fec.h"
+#include "framing.h"
+#include "logger.h"
+
+/* CPU time of the calling thread, so time spent preempted is not counted as decoding */
+static __u64 fec_now(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (__u64) now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+int fec_parse(fec_config *cfg, const char *arg) {
+    char *end;
+
+    cfg->depth = (int) strtol(arg, &end, 0);
+    cfg->workers = FEC_WORKERS_DEFAULT;
+    if (*end == ':')
+        cfg->workers = (int) strtol(end + 1, &end, 0);
+    if (*end != 0 || cfg->depth < 1 || cfg->depth > RS_DEPTH_MAX ||
+            cfg->workers < 1 || cfg->workers > FEC_WORKERS_MAX) {
+        printf("-E takes an interleaving depth of 1 to %d and 1 to %d decoder threads, e.g. 8 or 8:2\n",
+                RS_DEPTH_MAX, FEC_WORKERS_MAX);
+        return -1;
+    }
+    return 0;
+}
+
+/* Before the ring's threads start: a second buffer per slot, touched now like the ring's own */
+int fec_open(fec_pool *fec, frame_ring *ring, const fec_config *cfg, int framed, const char *name) {
+    size_t size = ring->slot_size + 1;
+    unsigned int i;
+
+    memset(fec, 0, sizeof (*fec));
+    fec->ring = ring;
+    fec->cfg = *cfg;
+    fec->framed = framed;
+    fec->name = name;
+    fec->buf = malloc((size_t) ring->nslots * size);
+    if (fec->buf == NULL) {
+        printf("fec alloc error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    memset(fec->buf, 0, (size_t) ring->nslots * size);
+    for (i = 0; i < ring->nslots; i++)
+        ring->slots[i].spare = fec->buf + (size_t) i * size;
+    ring_stage(ring);
+    return 0;
+}
+
+/*
+ * Decode one frame in its slot. One that does not decode is flagged like a
+ * CRC error, with its check bytes still taken out so that -m can line it up
+ * with the other link's copy; a truncated one lost its last codeblock and is
+ * left as it was.
+ */
+static void fec_frame(fec_pool *fec, fec_counts *n, frame_slot *slot) {
+    unsigned long bad = n->rs.bad;
+    unsigned char *out;
+    int len, decoded;
+
+    slot->raw = NULL;
+    if (slot->flags & FRAME_IDLE)
+        return;
+    n->frames++;
+
+    len = (slot->flags & FRAME_TRUNCATED) ? -1 : rs_decoded_len(slot->len, fec->cfg.depth);
+    decoded = len >= 0 && rs_decode(slot->data, slot->len, slot->spare, fec->cfg.depth, &n->rs) >= 0;
+    if (!decoded) {
+        n->failed++;
+        slot->flags |= FRAME_CRC_ERROR;
+        log_msg("frame %lu: %d bytes, more errors than FEC corrects\n", slot->num, slot->len);
+        if (len < 0)
+            return;
+    }
+
+    /* the decoded frame takes the slot; the one received stays for the journal */
+    out = slot->spare;
+    slot->spare = slot->data;
+    slot->raw = slot->data;
+    slot->raw_len = slot->len;
+    slot->data = out;
+    slot->len = len;
+    slot->data[len] = 0;
+    if (!decoded)
+        return;
+    if (n->rs.bad != bad)
+        n->corrected++;
+    if (slot->flags & FRAME_CRC_ERROR) {
+        slot->flags = (slot->flags & ~FRAME_CRC_ERROR) | FRAME_RECOVERED;
+        n->recovered++;
+    }
+
+    /* the end-to-end CRC-32C covers the frame as the flight computer built it */
+    if (fec->framed) {
+        switch (framing_check(slot->data, len)) {
+            case -1:
+                slot->flags |= FRAME_CRC_ERROR;
+                n->crc32c_failed++;
+                log_msg("frame %lu: CRC-32C mismatch after decoding\n", slot->num);
+                /* fall through */
+            case 1:
+                n->crc32c_frames++;
+                break;
+        }
+    }
+}
+
+static void * fec_main(void *arg) {
+    fec_worker *w = arg;
+    fec_pool *fec = w->pool;
+    frame_slot *slot;
+    unsigned int index;
+    __u64 start;
+
+    if (fec->name != NULL)
+        log_set_name(fec->name);
+    while ((slot = ring_stage_claim(fec->ring, &index)) != NULL) {
+        start = fec_now();
+        fec_frame(fec, &w->n, slot);
+        w->n.busy_ns += fec_now() - start;
+        ring_stage_done(fec->ring, index);
+    }
+    return NULL;
+}
+
+int fec_start(fec_pool *fec) {
+    int i;
+
+    for (i = 0; i < fec->cfg.workers; i++) {
+        fec->worker[i].pool = fec;
+        if (pthread_create(&fec->worker[i].thread, NULL, fec_main, &fec->worker[i]) != 0) {
+            printf("pthread_create error=%d %s\n", errno, strerror(errno));
+            return -1;
+        }
+        fec->running++;
+    }
+    return 0;
+}
+
+/* The threads return once the reader closed the ring and every frame was taken */
+void fec_stop(fec_pool *fec) {
+    for (; fec->running > 0; fec->running--)
+        pthread_join(fec->worker[fec->running - 1].thread, NULL);
+}
+
+void fec_report(const fec_pool *fec) {
+    fec_counts n;
+    int i;
+
+    memset(&n, 0, sizeof (n));
+    for (i = 0; i < fec->cfg.workers; i++) {
+        n.frames        += fec->worker[i].n.frames;
+        n.corrected     += fec->worker[i].n.corrected;
+        n.recovered     += fec->worker[i].n.recovered;
+        n.failed        += fec->worker[i].n.failed;
+        n.crc32c_frames += fec->worker[i].n.crc32c_frames;
+        n.crc32c_failed += fec->worker[i].n.crc32c_failed;
+        n.busy_ns       += fec->worker[i].n.busy_ns;
+        n.rs.codewords  += fec->worker[i].n.rs.codewords;
+        n.rs.bad        += fec->worker[i].n.rs.bad;
+        n.rs.symbols    += fec->worker[i].n.rs.symbols;
+        n.rs.failed     += fec->worker[i].n.rs.failed;
+    }
+    if (n.frames == 0)
+        return;
+    printf("FEC: RS(255,223) depth %d: %lu frames, %lu corrected, %lu that had failed the link CRC decoded, %lu not decoded\n",
+            fec->cfg.depth, n.frames, n.corrected, n.recovered, n.failed);
+    printf("     %lu codewords, %lu with errors: %lu symbols corrected, %lu codewords beyond 16 errors\n",
+            n.rs.codewords, n.rs.bad, n.rs.symbols, n.rs.failed);
+    printf("     %d decoder threads, %.1f us per frame\n", fec->cfg.workers, n.busy_ns / 1e3 / n.frames);
+    if (n.crc32c_frames > 0)
+        printf("CRC-32C: %lu frames checked after decoding, %lu failed\n", n.crc32c_frames, n.crc32c_failed);
+}
+
+void fec_free(fec_pool *fec) {
+    free(fec->buf);
+    fec->buf = NULL;
+}
@@ -0,0 +1,76 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : fec.h
+ * Source(s)     : fec.c
+ * Description   : Forward error correction on the ground (-E): every frame
+ *                 is sent as CCSDS Reed-Solomon codeblocks (rs.h), and a
+ *                 pool of decoder threads per link sits in the frame ring
+ *                 between the reader and the writer (ring_stage()). A frame
+ *                 that failed the link's CRC but decodes is stored after
+ *                 all; one with more errors than the code corrects is
+ *                 handled like a CRC error.
+ *
+ *                 Decoding replaces the frame in its slot; the frame as
+ *                 received stays next to it (frame_slot.raw) so the capture
+ *                 journal keeps what came off the link, and replays with -E.
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef FEC_H
+#define FEC_H
+
+#include <pthread.h>
+#include <linux/types.h>
+
+#include "ring.h"
+#include "rs.h"
+
+#define FEC_WORKERS_DEFAULT 2
+#define FEC_WORKERS_MAX     8
+
+typedef struct fec_config {
+    int            depth;               //interleaving depth, 0 without FEC
+    int            workers;             //decoder threads per link
+} fec_config;
+
+/* What one decoder thread did, summed for the report */
+typedef struct fec_counts {
+    unsigned long  frames;
+    unsigned long  corrected;           //frames with symbol errors, all corrected
+    unsigned long  recovered;           //frames that failed the link CRC and decoded
+    unsigned long  failed;              //frames not decoded, not stored
+    unsigned long  crc32c_frames;       //framed frames with a CRC-32C trailer, checked after decoding...
+    unsigned long  crc32c_failed;       //...of which failed it
+    __u64          busy_ns;             //CPU time spent decoding
+    rs_stats       rs;
+} fec_counts;
+
+typedef struct fec_worker {
+    struct fec_pool *pool;
+    pthread_t      thread;
+    fec_counts     n;
+} fec_worker;
+
+typedef struct fec_pool {
+    frame_ring    *ring;
+    fec_config     cfg;
+    int            framed;              //check the CRC-32C of framed frames once decoded
+    const char    *name;                //prefixes messages, NULL with one link
+    unsigned char *buf;                 //a spare buffer for every ring slot
+    int            running;             //threads started
+    fec_worker     worker[FEC_WORKERS_MAX];
+} fec_pool;
+
+int  fec_parse(fec_config *cfg, const char *arg);
+int  fec_open(fec_pool *fec, frame_ring *ring, const fec_config *cfg, int framed, const char *name);
+int  fec_start(fec_pool *fec);
+void fec_stop(fec_pool *fec);
+void fec_report(const fec_pool *fec);
+void fec_free(fec_pool *fec);
+
+#endif /* FEC_H */
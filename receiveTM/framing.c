@@ -0,0 +1,154 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : framing.c
+ * Header(s)     : framing.h
+ * Description   : Reads and writes the optional framing header and keeps
+ *                 the per-stream sequence numbers that account for lost
+ *                 frames. Shared by receiveTM and tmgen.
+ * Function(s)   : int framing_parse(frame_hdr*, const unsigned char*, int) - Check and decode a header
+ *                 int framing_type(const unsigned char*, int)   - Frame type only, -1 if no header
+ *                 void framing_put(unsigned char*, const frame_hdr*) - Encode a header
+ *                 int framing_seal(unsigned char*, int, const frame_hdr*) - Append the CRC-32C trailer
+ *                 int framing_check(const unsigned char*, int)  - Verify the CRC-32C trailer
+ *                 long framing_seq(framing_state*, const frame_hdr*) - Frames lost before this one
+ *                 void framing_report(const framing_state*)
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#include <stdio.h>
+
+#include "framing.h"
+#include "crc32c.h"
+
+static __u32 get32(const unsigned char *p) {
+    return (__u32) p[0] << 24 | (__u32) p[1] << 16 | (__u32) p[2] << 8 | p[3];
+}
+
+static void put32(unsigned char *p, __u32 v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+/* CRC-32C bytes at the end of a frame of this type */
+static int trailer_len(int type, int crc) {
+    if (!crc)
+        return 0;
+    return type == FRAMING_TERM_IMAGE ? 2 * FRAMING_CRC_LEN : FRAMING_CRC_LEN;
+}
+
+/*
+ * Decode the header of a frame; returns the payload length, which leaves out
+ * any CRC-32C trailer, or -1 if it has no header this receiver understands
+ */
+int framing_parse(frame_hdr *h, const unsigned char *buf, int len) {
+    int type = framing_type(buf, len);
+    int tail;
+
+    if (type < 0)
+        return -1;
+    h->type = type;
+    h->crc = (buf[2] & FRAMING_CRC) != 0;
+    tail = trailer_len(type, h->crc);
+    if (len < FRAMING_HDR_LEN + tail)
+        return -1;
+    h->stream = buf[3];
+    h->image = get32(buf + 4);
+    h->seq = get32(buf + 8);
+    h->offset = get32(buf + 12);
+    h->image_crc = tail == 2 * FRAMING_CRC_LEN ? get32(buf + len - tail) : 0;
+    return len - FRAMING_HDR_LEN - tail;
+}
+
+int framing_type(const unsigned char *buf, int len) {
+    if (len < FRAMING_HDR_LEN || buf[0] != (FRAMING_MAGIC >> 8) || buf[1] != (FRAMING_MAGIC & 0xff) ||
+            buf[2] >> 4 != FRAMING_VERSION || (buf[2] & FRAMING_TYPE) > FRAMING_TERM_XML)
+        return -1;
+    return buf[2] & FRAMING_TYPE;
+}
+
+void framing_put(unsigned char *buf, const frame_hdr *h) {
+    buf[0] = FRAMING_MAGIC >> 8;
+    buf[1] = FRAMING_MAGIC & 0xff;
+    buf[2] = FRAMING_VERSION << 4 | (h->crc ? FRAMING_CRC : 0) | (h->type & FRAMING_TYPE);
+    buf[3] = h->stream;
+    put32(buf + 4, h->image);
+    put32(buf + 8, h->seq);
+    put32(buf + 12, h->offset);
+}
+
+/*
+ * Header and payload of len bytes are in buf: append the image CRC-32C of a
+ * terminator and the frame's own. Returns the frame length.
+ */
+int framing_seal(unsigned char *buf, int len, const frame_hdr *h) {
+    if (!h->crc)
+        return len;
+    if (h->type == FRAMING_TERM_IMAGE) {
+        put32(buf + len, h->image_crc);
+        len += FRAMING_CRC_LEN;
+    }
+    put32(buf + len, crc32c(0, buf, len));
+    return len + FRAMING_CRC_LEN;
+}
+
+/*
+ * Check the CRC-32C trailer of a framed frame: 1 if it matches, 0 if the
+ * frame has none (or no header; the writer counts those), -1 if corrupted.
+ */
+int framing_check(const unsigned char *buf, int len) {
+    int type = framing_type(buf, len);
+
+    if (type < 0 || !(buf[2] & FRAMING_CRC))
+        return 0;
+    if (len < FRAMING_HDR_LEN + trailer_len(type, 1))
+        return -1;
+    return crc32c(0, buf, len - FRAMING_CRC_LEN) == get32(buf + len - FRAMING_CRC_LEN) ? 1 : -1;
+}
+
+/*
+ * Account for the sequence number of a frame. Returns how many frames of its
+ * stream went missing just before it, or -1 for a frame that repeats or
+ * arrives after later ones, which the caller drops. A number far behind the
+ * expected one is a sender that started over and is taken as it comes.
+ */
+long framing_seq(framing_state *fs, const frame_hdr *h) {
+    __s32 d = (__s32) (h->seq - fs->next[h->stream]);
+
+    fs->frames++;
+    if (!fs->seen[h->stream]) {
+        fs->seen[h->stream] = 1;
+        d = 0;
+    } else if (d < -FRAMING_RESTART) {
+        fs->restarts++;
+        d = 0;
+    } else if (d < 0) {
+        fs->stale++;
+        return -1;
+    }
+    fs->next[h->stream] = h->seq + 1;
+    if (d > 0) {
+        fs->gaps++;
+        fs->lost += d;
+    }
+    return d;
+}
+
+void framing_report(const framing_state *fs) {
+    printf("framing: %lu frames, %lu lost in %lu gaps, %lu repeated or late (%lu filled a hole), %lu restarts, %lu without a header\n",
+            fs->frames, fs->lost, fs->gaps, fs->stale, fs->refilled, fs->restarts, fs->bad);
+    if (fs->incomplete + fs->overlap > 0)
+        printf("framing: %lu images with holes (%llu bytes missing, see their .map), %llu bytes received twice\n",
+                fs->incomplete, fs->missing, fs->overlap);
+    if (fs->unmapped > 0)
+        printf("framing: %lu resumed images with no journal of their holes, completeness unknown\n", fs->unmapped);
+    if (fs->crc_match + fs->crc_mismatch + fs->crc_unchecked > 0)
+        printf("framing: image CRC-32C matched on %lu images, failed on %lu, not checked on %lu\n",
+                fs->crc_match, fs->crc_mismatch, fs->crc_unchecked);
+}
@@ -0,0 +1,101 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : framing.h
+ * Source(s)     : framing.c
+ * Description   : Optional framing header (-H) in front of every frame's
+ *                 payload. Without it frames are told apart by length and
+ *                 xml_check state alone, so a lost frame shifts every later
+ *                 byte of the image. The header says what the frame is and
+ *                 where its payload belongs (big-endian):
+ *
+ *                     offset size  field
+ *                          0    2  magic "MF"
+ *                          2    1  version (high nibble), CRC flag and frame type (low nibble)
+ *                          3    1  stream id
+ *                          4    4  image id
+ *                          8    4  sequence number, per stream, over every frame type
+ *                         12    4  byte offset
+ *
+ *                 The byte offset is where the payload goes in the image
+ *                 (data) or catalog entry (XML); a terminator carries the
+ *                 length of what it ends. A break in a stream's sequence
+ *                 numbers counts the frames lost exactly; image data is
+ *                 written at its offset, so lost frames leave holes (see
+ *                 imagemap.h) and a late frame can still fill one.
+ *                 Checking a header is a compare and four loads per frame.
+ *
+ *                 With the CRC flag (FRAMING_CRC) the frame ends with the
+ *                 CRC-32C (crc32c.h) of everything before it, big-endian,
+ *                 and an image terminator carries the CRC-32C of the whole
+ *                 image in the 4 bytes before that:
+ *                     header | payload | [image CRC-32C] | frame CRC-32C
+ *                 The receiver checks the frame CRC as it reads the frame
+ *                 and treats a mismatch like a link CRC error.
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef FRAMING_H
+#define FRAMING_H
+
+#include <linux/types.h>
+
+#define FRAMING_HDR_LEN  16
+#define FRAMING_MAGIC    0x4d46         //"MF"
+#define FRAMING_VERSION  1
+#define FRAMING_STREAMS  256
+#define FRAMING_RESTART  4096           //a sequence number this far behind is a sender restart, not a late frame
+#define FRAMING_MAX_HOLE (64 << 20)     //image bytes one header may ask to zero-fill
+#define FRAMING_CRC      0x8            //type nibble flag: CRC-32C trailer
+#define FRAMING_TYPE     0x7            //type nibble without the flag
+#define FRAMING_CRC_LEN  4
+
+/* Frame types */
+#define FRAMING_DATA       0            //image data
+#define FRAMING_XML        1            //catalog entry data
+#define FRAMING_TERM_IMAGE 2            //image terminator, payload is the file name
+#define FRAMING_TERM_XML   3            //catalog entry terminator
+
+typedef struct frame_hdr {
+    unsigned int   type;
+    unsigned int   stream;
+    __u32          image;
+    __u32          seq;
+    __u32          offset;
+    int            crc;                 //frame ends with a CRC-32C (FRAMING_CRC)
+    __u32          image_crc;           //image terminator with crc: CRC-32C of the image
+} frame_hdr;
+
+/* Sequence tracking and loss accounting of the frames one assembler receives */
+typedef struct framing_state {
+    __u32          next[FRAMING_STREAMS];       //sequence number expected next on each stream...
+    unsigned char  seen[FRAMING_STREAMS];       //...once it has sent a frame
+    unsigned long  frames;              //frames with a valid header
+    unsigned long  gaps;                //breaks in a stream's sequence
+    unsigned long  lost;                //frames missing in those breaks
+    unsigned long  stale;               //repeated or late frames...
+    unsigned long  refilled;            //...of which filled a hole, the rest dropped
+    unsigned long  restarts;            //streams that started over
+    unsigned long  bad;                 //frames without a valid header, dropped
+    unsigned long  incomplete;          //images finished with holes
+    unsigned long long missing;         //image bytes in those holes
+    unsigned long  unmapped;            //images resumed with no record of their holes
+    unsigned long long overlap;         //image bytes received twice, dropped
+    unsigned long  crc_match;           //images whose CRC-32C matched their terminator's
+    unsigned long  crc_mismatch;        //... did not
+    unsigned long  crc_unchecked;       //... could not be checked: holes, or bytes received twice
+} framing_state;
+
+int  framing_parse(frame_hdr *h, const unsigned char *buf, int len);
+int  framing_type(const unsigned char *buf, int len);
+void framing_put(unsigned char *buf, const frame_hdr *h);
+int  framing_seal(unsigned char *buf, int len, const frame_hdr *h);
+int  framing_check(const unsigned char *buf, int len);
+long framing_seq(framing_state *fs, const frame_hdr *h);
+void framing_report(const framing_state *fs);
+
+#endif /* FRAMING_H */
@@ -0,0 +1,154 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : imagemap.c
+ * Header(s)     : imagemap.h
+ * Description   : Received extents of the image in progress and the
+ *                 completeness bitmap saved for an image with holes.
+ * Function(s)   : int image_map_add(image_map*, size_t, size_t)   - Bytes received
+ *                 size_t image_map_missing(const image_map*, size_t, size_t)
+ *                                                  - Bytes of a range not received
+ *                 int image_map_save(const image_map*, const char*, size_t)
+ *                                                  - Write the completeness bitmap
+ *                 void image_map_reset(image_map*) - Start the next image
+ *                 void image_map_free(image_map*)
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "imagemap.h"
+
+static int map_grow(image_map *m) {
+    size_t cap = m->cap ? m->cap * 2 : 16;
+    size_t *s, *e;
+
+    s = realloc(m->start, cap * sizeof (*s));
+    if (s != NULL)
+        m->start = s;
+    e = realloc(m->end, cap * sizeof (*e));
+    if (e != NULL)
+        m->end = e;
+    if (s == NULL || e == NULL) {
+        printf("image map alloc error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    m->cap = cap;
+    return 0;
+}
+
+/* [off, off + len) was received; extents stay sorted, and touching ones are joined */
+int image_map_add(image_map *m, size_t off, size_t len) {
+    size_t end = off + len;
+    size_t i, j;
+
+    if (len == 0)
+        return 0;
+
+    /* in order: the frame continues the last extent */
+    if (m->n > 0 && off >= m->start[m->n - 1] && off <= m->end[m->n - 1]) {
+        if (end > m->end[m->n - 1])
+            m->end[m->n - 1] = end;
+        return 0;
+    }
+
+    /* extents i..j-1 touch the new range */
+    for (i = m->n; i > 0 && m->end[i - 1] >= off; i--)
+        ;
+    for (j = i; j < m->n && m->start[j] <= end; j++)
+        ;
+    if (i == j) {
+        if (m->n == m->cap && map_grow(m) < 0)
+            return -1;
+        memmove(m->start + i + 1, m->start + i, (m->n - i) * sizeof (*m->start));
+        memmove(m->end + i + 1, m->end + i, (m->n - i) * sizeof (*m->end));
+        m->start[i] = off;
+        m->end[i] = end;
+        m->n++;
+        return 0;
+    }
+    if (m->start[i] < off)
+        off = m->start[i];
+    if (m->end[j - 1] > end)
+        end = m->end[j - 1];
+    m->start[i] = off;
+    m->end[i] = end;
+    memmove(m->start + i + 1, m->start + j, (m->n - j) * sizeof (*m->start));
+    memmove(m->end + i + 1, m->end + j, (m->n - j) * sizeof (*m->end));
+    m->n -= j - i - 1;
+    return 0;
+}
+
+/* Bytes of [off, off + len) not received */
+size_t image_map_missing(const image_map *m, size_t off, size_t len) {
+    size_t end = off + len;
+    size_t got = 0;
+    size_t i, a, b;
+
+    for (i = m->n; i > 0 && m->end[i - 1] > off; i--) {
+        a = m->start[i - 1] > off ? m->start[i - 1] : off;
+        b = m->end[i - 1] < end ? m->end[i - 1] : end;
+        if (b > a)
+            got += b - a;
+    }
+    return len - got;
+}
+
+/* Completeness bitmap of an image of image_bytes, see imagemap.h */
+int image_map_save(const image_map *m, const char *path, size_t image_bytes) {
+    size_t blocks = (image_bytes + IMAGE_MAP_BLOCK - 1) / IMAGE_MAP_BLOCK;
+    size_t bytes = (blocks + 7) / 8;
+    image_map_hdr hdr;
+    unsigned char *bits;
+    size_t i, b, last;
+    int fd, rc = 0;
+
+    bits = calloc(1, bytes + 1);
+    if (bits == NULL) {
+        printf("image map alloc error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    for (i = 0; i < m->n; i++) {
+        /* whole blocks only, but the short last block of the image counts when the extent reaches its end */
+        b = (m->start[i] + IMAGE_MAP_BLOCK - 1) / IMAGE_MAP_BLOCK;
+        last = m->end[i] >= image_bytes ? blocks : m->end[i] / IMAGE_MAP_BLOCK;
+        for (; b < last; b++)
+            bits[b / 8] |= 1 << (b % 8);
+    }
+
+    memset(&hdr, 0, sizeof (hdr));
+    memcpy(hdr.magic, IMAGE_MAP_MAGIC, sizeof (hdr.magic));
+    hdr.version = IMAGE_MAP_VERSION;
+    hdr.block = IMAGE_MAP_BLOCK;
+    hdr.image_bytes = image_bytes;
+    hdr.missing = image_map_missing(m, 0, image_bytes);
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || write(fd, &hdr, sizeof (hdr)) != sizeof (hdr) || write(fd, bits, bytes) != (ssize_t) bytes) {
+        printf("image map %s error=%d %s\n", path, errno, strerror(errno));
+        rc = -1;
+    }
+    if (fd >= 0)
+        close(fd);
+    free(bits);
+    return rc;
+}
+
+void image_map_reset(image_map *m) {
+    m->n = 0;
+}
+
+void image_map_free(image_map *m) {
+    free(m->start);
+    free(m->end);
+    memset(m, 0, sizeof (*m));
+}
@@ -0,0 +1,59 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : imagemap.h
+ * Source(s)     : imagemap.c
+ * Description   : Completeness of an image assembled from framed frames
+ *                 (-H), which are written at their byte offsets so lost
+ *                 frames leave holes. While the image is received the bytes
+ *                 in are kept as a sorted list of extents; frames arrive in
+ *                 order, so adding one is a compare with the last extent.
+ *
+ *                 An image that finishes with holes gets a completeness
+ *                 bitmap next to it, <image>.roe.map (little-endian):
+ *                     image_map_hdr                            once
+ *                     one bit per IMAGE_MAP_BLOCK bytes, LSB first, set for a
+ *                     block that was received whole
+ *                 so a later merge or redownlink can fill just the missing
+ *                 blocks in place. An image without a .map is complete.
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef IMAGEMAP_H
+#define IMAGEMAP_H
+
+#include <stddef.h>
+#include <linux/types.h>
+
+#define IMAGE_MAP_MAGIC   "MOSESMAP"
+#define IMAGE_MAP_VERSION 1
+#define IMAGE_MAP_BLOCK   512           //image bytes per bit
+#define IMAGE_MAP_EXT     ".map"
+
+typedef struct image_map_hdr {
+    char  magic[8];
+    __u32 version;
+    __u32 block;                        //IMAGE_MAP_BLOCK
+    __u64 image_bytes;                  //length of the image
+    __u64 missing;                      //bytes of it never received
+} image_map_hdr;
+
+/* Byte ranges of the image in progress that were received */
+typedef struct image_map {
+    size_t        *start;
+    size_t        *end;
+    size_t         n;
+    size_t         cap;
+} image_map;
+
+int    image_map_add(image_map *m, size_t off, size_t len);
+size_t image_map_missing(const image_map *m, size_t off, size_t len);
+int    image_map_save(const image_map *m, const char *path, size_t image_bytes);
+void   image_map_reset(image_map *m);
+void   image_map_free(image_map *m);
+
+#endif /* IMAGEMAP_H */
@@ -0,0 +1,157 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : journal.c
+ * Header(s)     : journal.h
+ * Description   : Capture journal writer. Records are packed into a
+ *                 preallocated JOURNAL_BUF and written with one large
+ *                 sequential write() whenever it fills, so journaling a
+ *                 10 Mbps pass costs a handful of syscalls per second.
+ *                 Opening an existing journal appends to it, so a restarted
+ *                 receiver keeps a single record of the pass.
+ * Function(s)   : int journal_open(tm_journal*, const char*, const char*)
+ *                 int journal_append(tm_journal*, ...)   - Queue one frame
+ *                 int journal_flush(tm_journal*)         - Write queued frames
+ *                 int journal_idle(tm_journal*, unsigned int) - Write frames older than a limit
+ *                 void journal_close(tm_journal*)
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "journal.h"
+
+static unsigned long long now_ms(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int write_all(int fd, const unsigned char *p, size_t len) {
+    ssize_t rc;
+
+    while (len > 0) {
+        rc = write(fd, p, len);
+        if (rc < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += rc;
+        len -= rc;
+    }
+    return 0;
+}
+
+int journal_open(tm_journal *j, const char *path, const char *source) {
+    journal_file_hdr hdr;
+    struct timespec now;
+    struct stat st;
+
+    memset(j, 0, sizeof (*j));
+    j->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (j->fd < 0) {
+        printf("journal open error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+
+    j->buf = malloc(JOURNAL_BUF);
+    if (j->buf == NULL) {
+        printf("journal alloc error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    memset(j->buf, 0, JOURNAL_BUF);
+
+    /* new journal: write the file header, otherwise keep appending records */
+    if (fstat(j->fd, &st) == 0 && st.st_size == 0) {
+        clock_gettime(CLOCK_REALTIME, &now);
+        memset(&hdr, 0, sizeof (hdr));
+        memcpy(hdr.magic, JOURNAL_MAGIC, sizeof (hdr.magic));
+        hdr.version       = JOURNAL_VERSION;
+        hdr.hdr_size      = sizeof (hdr);
+        hdr.start_wall_ns = (__u64) now.tv_sec * 1000000000ull + now.tv_nsec;
+        snprintf(hdr.source, sizeof (hdr.source), "%s", source);
+        memcpy(j->buf, &hdr, sizeof (hdr));
+        j->used = sizeof (hdr);
+    }
+
+    printf("capture journal: %s\n", path);
+    return 0;
+}
+
+int journal_append(tm_journal *j, const unsigned char *data, __u32 len,
+                   __u64 mono_ns, __u64 wall_ns, __u32 crc_errs, __u32 flags) {
+    journal_rec_hdr rec;
+    size_t need = sizeof (rec) + JOURNAL_REC_ALIGN(len);
+    unsigned char *p;
+
+    /* frames are at most HDLC_MAX_FRAME_SIZE, so one always fits an empty buffer */
+    if (j->used + need > JOURNAL_BUF && journal_flush(j) < 0)
+        return -1;
+
+    if (j->used == 0 || j->pending_ms == 0)
+        j->pending_ms = now_ms();
+    p = j->buf + j->used;
+    rec.sync     = JOURNAL_REC_SYNC;
+    rec.len      = len;
+    rec.mono_ns  = mono_ns;
+    rec.wall_ns  = wall_ns;
+    rec.crc_errs = crc_errs;
+    rec.flags    = flags;
+    memcpy(p, &rec, sizeof (rec));
+    memcpy(p + sizeof (rec), data, len);
+    memset(p + sizeof (rec) + len, 0, JOURNAL_REC_ALIGN(len) - len);
+    j->used += need;
+    if (!(flags & (JOURNAL_REC_STATS | JOURNAL_REC_CLOSE)))
+        j->frames++;
+    return 0;
+}
+
+int journal_flush(tm_journal *j) {
+    if (j->used == 0)
+        return 0;
+    if (write_all(j->fd, j->buf, j->used) < 0) {
+        printf("journal write error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    j->writes++;
+    j->bytes += j->used;
+    j->used = 0;
+    j->pending_ms = 0;
+    return 0;
+}
+
+/* Write out records that have waited longer than flush_ms */
+int journal_idle(tm_journal *j, unsigned int flush_ms) {
+    if (j->used == 0 || flush_ms == 0 || now_ms() - j->pending_ms < flush_ms)
+        return 0;
+    return journal_flush(j);
+}
+
+void journal_close(tm_journal *j) {
+    struct timespec now;
+
+    if (j->fd < 0 || j->buf == NULL)
+        return;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    journal_append(j, (const unsigned char *) "", 0, (__u64) now.tv_sec * 1000000000ull + now.tv_nsec, 0, 0, JOURNAL_REC_CLOSE);
+    journal_flush(j);
+    printf("capture journal: %llu frames, %llu bytes in %lu writes\n",
+            j->frames, j->bytes, j->writes);
+    close(j->fd);
+    free(j->buf);
+    j->fd = -1;
+    j->buf = NULL;
+}
@@ -0,0 +1,87 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : journal.h
+ * Source(s)     : journal.c
+ * Description   : Append-only capture journal holding every frame exactly as
+ *                 it came off the frame source, before classification. It is
+ *                 the authoritative record of a pass: feeding it back through
+ *                 "file:<journal>" rebuilds the images and catalog offline.
+ *
+ *                 Layout (all fields little-endian):
+ *                     journal_file_hdr                      once, at offset 0
+ *                     { journal_rec_hdr, payload, pad to 8 } per frame
+ *
+ *                 Link statistics samples are interleaved as records flagged
+ *                 JOURNAL_REC_STATS with a journal_stats_rec payload. Older
+ *                 journals carry the rxcrc delta in each frame record instead.
+ *                 A receiver that exits cleanly ends its records with an
+ *                 empty JOURNAL_REC_CLOSE record, which tells start-up
+ *                 recovery (recover.c) that no image was left in progress.
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stddef.h>
+#include <linux/types.h>
+
+#include "synclink.h"
+
+#define JOURNAL_MAGIC    "MOSESTMJ"
+#define JOURNAL_VERSION  1
+#define JOURNAL_REC_SYNC 0x464d5452     //"RTMF", lets a reader resync after damage
+#define JOURNAL_BUF      (4 << 20)      //bytes gathered per write()
+
+typedef struct journal_file_hdr {
+    char  magic[8];
+    __u32 version;
+    __u32 hdr_size;                     //offset of the first record
+    __u64 start_wall_ns;                //CLOCK_REALTIME when the journal was created
+    char  source[96];                   //frame source spec
+} journal_file_hdr;
+
+typedef struct journal_rec_hdr {
+    __u32 sync;                         //JOURNAL_REC_SYNC
+    __u32 len;                          //payload bytes
+    __u64 mono_ns;                      //CLOCK_MONOTONIC when read() returned
+    __u64 wall_ns;                      //CLOCK_REALTIME when read() returned
+    __u32 crc_errs;                     //mgsl_icount.rxcrc delta: before this frame, or over the sample window
+    __u32 flags;                        //JOURNAL_REC_* or 0
+} journal_rec_hdr;
+
+#define JOURNAL_REC_STATS 0x1           //payload is a journal_stats_rec, not a frame
+#define JOURNAL_REC_TRUNC 0x2           //frame was cut at the receiver's max frame size
+#define JOURNAL_REC_CLOSE 0x4           //no payload: the receiver exited cleanly, nothing is in progress
+#define JOURNAL_REC_CRC   0x8           //frame failed its CRC check
+
+typedef struct journal_stats_rec {
+    __u64 frames;                       //frames read when the sample was taken
+    struct mgsl_icount icount;
+} journal_stats_rec;
+
+#define JOURNAL_REC_ALIGN(len) (((len) + 7) & ~(size_t) 7)
+
+typedef struct tm_journal {
+    int            fd;
+    unsigned char *buf;
+    size_t         used;
+    unsigned long long pending_ms;      //CLOCK_MONOTONIC ms of the oldest unwritten record
+    unsigned long long frames;          //records appended
+    unsigned long long bytes;           //bytes written to disk
+    unsigned long  writes;              //write() calls
+} tm_journal;
+
+int  journal_open(tm_journal *j, const char *path, const char *source);
+int  journal_append(tm_journal *j, const unsigned char *data, __u32 len,
+                    __u64 mono_ns, __u64 wall_ns, __u32 crc_errs, __u32 flags);
+int  journal_flush(tm_journal *j);
+int  journal_idle(tm_journal *j, unsigned int flush_ms);
+void journal_close(tm_journal *j);
+
+#endif /* JOURNAL_H */
@@ -0,0 +1,241 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : linkstats.c
+ * Header(s)     : linkstats.h
+ * Description   : Samples struct mgsl_icount on a timer of the reader's
+ *                 event loop or every N frames, into a history ring that
+ *                 the writer thread drains.
+ * Function(s)   : int linkstats_init(link_stats*, frame_source*, unsigned long*, unsigned int, unsigned int)
+ *                 void linkstats_tick(void*)             - Timer handler, timer mode
+ *                 void linkstats_frame(link_stats*, unsigned long) - Reader hook, frame mode
+ *                 void linkstats_stop(link_stats*)       - Take the final sample
+ *                 int linkstats_next(link_stats*, unsigned long, link_sample*, link_sample*)
+ *                                                        - Next sample and the one before it
+ *                 void linkstats_free(link_stats*)
+ *                 void linkstats_split(const link_sample*, const link_sample*, unsigned long, link_sample*)
+ *                                                        - Sample within a window, by frame
+ *                 int linkstats_add(link_totals*, const link_sample*, const link_sample*)
+ *                                                        - Accumulate counter deltas
+ *                 int linkstats_errors(const link_totals*) - Receive errors counted
+ *                 void linkstats_report(const char*, const link_totals*) - Print totals and rates
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stddef.h>
+
+#include "linkstats.h"
+#include "logger.h"
+
+#define ICOUNT(field) offsetof(struct mgsl_icount, field)
+
+/* Every counter of struct mgsl_icount, and whether it means lost or damaged data */
+static const struct {
+    const char *name;
+    size_t      off;
+    int         error;
+} counters[] = {
+    {"cts",         ICOUNT(cts),         0},
+    {"dsr",         ICOUNT(dsr),         0},
+    {"rng",         ICOUNT(rng),         0},
+    {"dcd",         ICOUNT(dcd),         0},
+    {"tx",          ICOUNT(tx),          0},
+    {"rx",          ICOUNT(rx),          0},
+    {"frame",       ICOUNT(frame),       1},
+    {"parity",      ICOUNT(parity),      1},
+    {"overrun",     ICOUNT(overrun),     1},
+    {"brk",         ICOUNT(brk),         0},
+    {"buf_overrun", ICOUNT(buf_overrun), 1},
+    {"txok",        ICOUNT(txok),        0},
+    {"txunder",     ICOUNT(txunder),     0},
+    {"txabort",     ICOUNT(txabort),     0},
+    {"txtimeout",   ICOUNT(txtimeout),   0},
+    {"rxshort",     ICOUNT(rxshort),     1},
+    {"rxlong",      ICOUNT(rxlong),      1},
+    {"rxabort",     ICOUNT(rxabort),     1},
+    {"rxover",      ICOUNT(rxover),      1},
+    {"rxcrc",       ICOUNT(rxcrc),       1},
+    {"rxok",        ICOUNT(rxok),        0},
+    {"exithunt",    ICOUNT(exithunt),    0},
+    {"rxidle",      ICOUNT(rxidle),      0},
+};
+
+static __u32 icount_get(const struct mgsl_icount *icount, int i) {
+    return *(const __u32 *) ((const char *) icount + counters[i].off);
+}
+
+/* Take one sample; only the reader thread samples */
+static void linkstats_sample(link_stats *ls) {
+    link_sample *s = &ls->hist[ls->produced & (LINKSTATS_HISTORY - 1)];
+    struct timespec now;
+
+    /* frames first: every frame counted here was read before the counters */
+    s->frames = __atomic_load_n(ls->frames, __ATOMIC_ACQUIRE);
+    if (ls->src->get_stats(ls->src, &s->icount) < 0)
+        return;
+    ls->ioctls++;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    s->mono_ns = (__u64) now.tv_sec * 1000000000ull + now.tv_nsec;
+    __atomic_store_n(&ls->produced, ls->produced + 1, __ATOMIC_RELEASE);
+}
+
+int linkstats_init(link_stats *ls, frame_source *src, unsigned long *frames,
+                   unsigned int period_ms, unsigned int every) {
+    struct mgsl_icount icount;
+
+    memset(ls, 0, sizeof (*ls));
+    ls->src = src;
+    ls->frames = frames;
+    ls->period_ms = every ? 0 : (period_ms ? period_ms : LINKSTATS_DEFAULT_MS);
+    ls->every = every;
+
+    /* sources without counters (pty, fifo, udp) have nothing to sample */
+    ls->enabled = (src->get_stats != NULL && src->get_stats(src, &icount) == 0);
+    if (!ls->enabled)
+        return 0;
+
+    ls->hist = calloc(LINKSTATS_HISTORY, sizeof (link_sample));
+    if (ls->hist == NULL) {
+        printf("link stats alloc error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    /* baseline for the first window */
+    linkstats_sample(ls);
+    return 0;
+}
+
+/* Timer mode: called by the reader's event loop every period_ms */
+void linkstats_tick(void *arg) {
+    link_stats *ls = arg;
+
+    if (ls->enabled)
+        linkstats_sample(ls);
+}
+
+/* Called by the reader after each frame; samples in frame mode only */
+void linkstats_frame(link_stats *ls, unsigned long frames) {
+    if (ls->enabled && ls->every && frames % ls->every == 0)
+        linkstats_sample(ls);
+}
+
+/* Close the last window once the reader is done */
+void linkstats_stop(link_stats *ls) {
+    if (ls->enabled)
+        linkstats_sample(ls);
+}
+
+/*
+ * Next sample covering no more than upto frames, with the sample before it
+ * in prev. Returns 0 if there is none yet.
+ */
+int linkstats_next(link_stats *ls, unsigned long upto, link_sample *cur, link_sample *prev) {
+    unsigned long produced;
+    link_sample *s;
+
+    if (!ls->enabled)
+        return 0;
+    produced = __atomic_load_n(&ls->produced, __ATOMIC_ACQUIRE);
+    if (produced - ls->consumed > LINKSTATS_HISTORY - 1) {
+        ls->lost += produced - ls->consumed - (LINKSTATS_HISTORY - 1);
+        ls->consumed = produced - (LINKSTATS_HISTORY - 1);
+    }
+    if (ls->consumed == produced)
+        return 0;
+    s = &ls->hist[ls->consumed & (LINKSTATS_HISTORY - 1)];
+    if (s->frames > upto)
+        return 0;
+
+    /* the baseline sample only opens the first window */
+    if (ls->consumed++ == 0) {
+        ls->last = *s;
+        return linkstats_next(ls, upto, cur, prev);
+    }
+    *prev = ls->last;
+    *cur = *s;
+    ls->last = *s;
+    return 1;
+}
+
+void linkstats_free(link_stats *ls) {
+    if (!ls->enabled)
+        return;
+    if (ls->lost > 0)
+        printf("link stats: %lu samples lost before they were reported\n", ls->lost);
+    free(ls->hist);
+    ls->hist = NULL;
+}
+
+/*
+ * The sample that would have been taken once frames had been read, between
+ * prev and cur: each counter and the time are shared out over the window in
+ * proportion to its frames, so splitting a window loses no increment.
+ */
+void linkstats_split(const link_sample *prev, const link_sample *cur, unsigned long frames, link_sample *mid) {
+    unsigned long span = cur->frames - prev->frames;
+    unsigned long part = frames - prev->frames;
+    __u32 d;
+    int i;
+
+    *mid = *prev;
+    mid->frames = frames;
+    if (span == 0)
+        return;
+    for (i = 0; i < (int) (sizeof (counters) / sizeof (counters[0])); i++) {
+        d = icount_get(&cur->icount, i) - icount_get(&prev->icount, i);     //counters wrap
+        *(__u32 *) ((char *) &mid->icount + counters[i].off) += (__u32) ((__u64) d * part / span);
+    }
+    mid->mono_ns += (cur->mono_ns - prev->mono_ns) * part / span;
+}
+
+/* Add the counter increments between two samples; returns the receive errors among them */
+int linkstats_add(link_totals *t, const link_sample *cur, const link_sample *prev) {
+    int i, errors = 0;
+    __u32 d;
+
+    for (i = 0; i < (int) (sizeof (counters) / sizeof (counters[0])); i++) {
+        d = icount_get(&cur->icount, i) - icount_get(&prev->icount, i);     //counters wrap
+        t->n[i] += d;
+        if (counters[i].error)
+            errors += d;
+    }
+    t->ns += cur->mono_ns - prev->mono_ns;
+    t->frames += cur->frames - prev->frames;
+    return errors;
+}
+
+int linkstats_errors(const link_totals *t) {
+    int i;
+
+    for (i = 0; i < (int) (sizeof (counters) / sizeof (counters[0])); i++)
+        if (counters[i].error && t->n[i] != 0)
+            return 1;
+    return 0;
+}
+
+/* One line with every counter that moved, as a total and a rate per second */
+void linkstats_report(const char *label, const link_totals *t) {
+    double secs = t->ns / 1e9;
+    char line[LOG_LINE];
+    size_t n;
+    int i, any = 0;
+
+    n = snprintf(line, sizeof (line), "%s: %lu frames", label, t->frames);
+    for (i = 0; i < (int) (sizeof (counters) / sizeof (counters[0])) && n < sizeof (line); i++) {
+        if (t->n[i] == 0)
+            continue;
+        n += snprintf(line + n, sizeof (line) - n, ", %s %llu", counters[i].name, (unsigned long long) t->n[i]);
+        if (secs > 0 && n < sizeof (line))
+            n += snprintf(line + n, sizeof (line) - n, " (%.1f/s)", t->n[i] / secs);
+        any |= counters[i].error;
+    }
+    log_msg("%s%s\n", line, any ? "" : ", no receive errors");
+}
@@ -0,0 +1,81 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : linkstats.h
+ * Source(s)     : linkstats.c
+ * Description   : Link statistics sampler. Instead of an MGSL_IOCGSTATS
+ *                 ioctl before every read(), struct mgsl_icount is sampled
+ *                 by the reader, from a timer of its event loop (events.c)
+ *                 or every N frames. Each sample records how many frames had been read
+ *                 when it was taken, so a counter increment (a CRC failure,
+ *                 say) is attributed to the window of frames between two
+ *                 samples.
+ *
+ *                 Samples are kept in a history ring; the writer thread
+ *                 consumes them in order with linkstats_next() once it has
+ *                 stored every frame they cover, and accumulates the
+ *                 differences of every mgsl_icount counter into link_totals
+ *                 per second, per image and per pass. A window that spans
+ *                 the end of an image is split at that frame with
+ *                 linkstats_split().
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef LINKSTATS_H
+#define LINKSTATS_H
+
+#include <linux/types.h>
+
+#include "synclink.h"
+#include "source.h"
+
+#define LINKSTATS_DEFAULT_MS 100
+#define LINKSTATS_HISTORY    4096       //samples kept, must be a power of two
+#define LINKSTATS_COUNTERS   (sizeof (struct mgsl_icount) / sizeof (__u32))
+
+typedef struct link_sample {
+    __u64          mono_ns;             //CLOCK_MONOTONIC when sampled
+    unsigned long  frames;              //frames read by then
+    struct mgsl_icount icount;
+} link_sample;
+
+/* Counter increments over some span of samples */
+typedef struct link_totals {
+    __u64          n[LINKSTATS_COUNTERS];       //in struct mgsl_icount order
+    __u64          ns;                          //time covered by the samples
+    unsigned long  frames;                      //frames read in that time
+} link_totals;
+
+typedef struct link_stats {
+    frame_source  *src;
+    unsigned long *frames;              //reader's frame counter
+    unsigned int   period_ms;           //timer mode, 0 if sampling by frames
+    unsigned int   every;               //frame mode: sample every N frames
+    int            enabled;             //source has statistics
+
+    link_sample   *hist;
+    unsigned long  produced;            //samples taken
+    unsigned long  consumed;            //samples returned by linkstats_next()
+    unsigned long  lost;                //overwritten before they were consumed
+    link_sample    last;                //last sample consumed
+    unsigned long  ioctls;
+} link_stats;
+
+int  linkstats_init(link_stats *ls, frame_source *src, unsigned long *frames,
+                    unsigned int period_ms, unsigned int every);
+void linkstats_tick(void *arg);
+void linkstats_frame(link_stats *ls, unsigned long frames);
+void linkstats_stop(link_stats *ls);
+int  linkstats_next(link_stats *ls, unsigned long upto, link_sample *cur, link_sample *prev);
+void linkstats_free(link_stats *ls);
+
+void linkstats_split(const link_sample *prev, const link_sample *cur, unsigned long frames, link_sample *mid);
+int  linkstats_add(link_totals *t, const link_sample *cur, const link_sample *prev);
+int  linkstats_errors(const link_totals *t);
+void linkstats_report(const char *label, const link_totals *t);
+
+#endif /* LINKSTATS_H */
@@ -0,0 +1,288 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : logger.c
+ * Header(s)     : logger.h
+ * Description   : Bounded multi-producer ring of log lines (each slot carries
+ *                 a sequence number, so producers claim slots with one
+ *                 compare-and-swap) and the nice 19 thread that drains it to
+ *                 stdout and the verbose log file.
+ *
+ *                 On a terminal the status line is kept on the last line:
+ *                 messages are printed above it and it is redrawn in place.
+ *                 When stdout is not a terminal there is no status line.
+ * Function(s)   : int log_open(const char*)       - Allocate the ring, open the verbose log
+ *                 int log_start(log_status_fn, void*) - Start the log thread
+ *                 void log_msg(const char*, ...)  - Queue a console message
+ *                 void log_frame(const char*, ...) - Queue a verbose per-frame line
+ *                 int log_verbose(void)           - Per-frame lines are kept
+ *                 void log_set_name(const char*)  - Prefix this thread's lines
+ *                 void log_stop(void)             - Drain and stop the log thread
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "logger.h"
+
+#define LOG_MSG   0
+#define LOG_FRAME 1
+
+typedef struct log_slot {
+    unsigned int   seq;                 //== position when free, position + 1 when filled
+    unsigned short kind;
+    unsigned short len;
+    char           text[LOG_LINE];
+} log_slot;
+
+static struct {
+    log_slot      *slots;
+    unsigned int   head __attribute__((aligned(64)));   //next position to claim
+    unsigned int   tail __attribute__((aligned(64)));   //next position to print
+    unsigned long  dropped;
+    unsigned long  lines;
+    FILE          *verbose;             //per-frame log, NULL if off
+    int            tty;                 //stdout is a terminal: draw the status line
+    int            status_shown;
+    log_status_fn  status;
+    void          *status_arg;
+    pthread_t      thread;
+    int            running;
+    int            stop;
+} lg;
+
+static __thread const char *log_name;  //prefix of this thread's lines, NULL for none
+
+int log_open(const char *verbose_path) {
+    unsigned int i;
+
+    lg.slots = calloc(LOG_SLOTS, sizeof (log_slot));
+    if (lg.slots == NULL) {
+        printf("log alloc error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    for (i = 0; i < LOG_SLOTS; i++)
+        lg.slots[i].seq = i;
+    lg.tty = isatty(STDOUT_FILENO);
+
+    if (verbose_path != NULL) {
+        lg.verbose = fopen(verbose_path, "w");
+        if (lg.verbose == NULL) {
+            printf("verbose log open error=%d %s\n", errno, strerror(errno));
+            return -1;
+        }
+        setvbuf(lg.verbose, NULL, _IOFBF, 1 << 20);
+    }
+    return 0;
+}
+
+int log_verbose(void) {
+    return lg.verbose != NULL;
+}
+
+void log_set_name(const char *name) {
+    log_name = name;
+}
+
+/* Moves the leading newlines of *fmt ahead of the thread's name; returns the bytes written */
+static int log_prefix(char *text, const char **fmt) {
+    int n = 0;
+
+    if (log_name == NULL)
+        return 0;
+    while (**fmt == '\n' && n < LOG_LINE / 4) {
+        text[n++] = '\n';
+        (*fmt)++;
+    }
+    return n + snprintf(text + n, LOG_LINE - n, "[%s] ", log_name);
+}
+
+/* Claim a slot, format into it and publish it; drops the line if the ring is full */
+static void log_queue(int kind, const char *fmt, va_list ap) {
+    unsigned int pos = __atomic_load_n(&lg.head, __ATOMIC_RELAXED);
+    log_slot *s;
+    int diff, len, pre;
+
+    for (;;) {
+        s = &lg.slots[pos & (LOG_SLOTS - 1)];
+        diff = (int) (__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&lg.head, &pos, pos + 1, 1,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            __atomic_fetch_add(&lg.dropped, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&lg.head, __ATOMIC_RELAXED);
+        }
+    }
+
+    pre = log_prefix(s->text, &fmt);
+    len = vsnprintf(s->text + pre, LOG_LINE - pre, fmt, ap);
+    if (len < 0)
+        len = pre;
+    else if ((len += pre) >= LOG_LINE)
+        len = LOG_LINE - 1;
+    s->len = len;
+    s->kind = kind;
+    __atomic_store_n(&s->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+void log_msg(const char *fmt, ...) {
+    va_list ap;
+
+    va_start(ap, fmt);
+    if (__atomic_load_n(&lg.running, __ATOMIC_ACQUIRE))
+        log_queue(LOG_MSG, fmt, ap);
+    else
+        vprintf(fmt, ap);
+    va_end(ap);
+}
+
+void log_frame(const char *fmt, ...) {
+    va_list ap;
+
+    if (lg.verbose == NULL)
+        return;
+    va_start(ap, fmt);
+    if (__atomic_load_n(&lg.running, __ATOMIC_ACQUIRE))
+        log_queue(LOG_FRAME, fmt, ap);
+    else
+        vfprintf(lg.verbose, fmt, ap);
+    va_end(ap);
+}
+
+static void status_clear(void) {
+    if (lg.status_shown) {
+        fputs("\r\033[K", stdout);
+        lg.status_shown = 0;
+    }
+}
+
+/* Print every published line; returns the number printed */
+static int log_drain(void) {
+    log_slot *s;
+    int n = 0;
+
+    for (;;) {
+        s = &lg.slots[lg.tail & (LOG_SLOTS - 1)];
+        if (__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) != lg.tail + 1)
+            break;
+        if (s->kind == LOG_MSG) {
+            status_clear();
+            fwrite(s->text, 1, s->len, stdout);
+        }
+        if (lg.verbose != NULL)
+            fwrite(s->text, 1, s->len, lg.verbose);
+        __atomic_store_n(&s->seq, lg.tail + LOG_SLOTS, __ATOMIC_RELEASE);
+        lg.tail++;
+        n++;
+    }
+    lg.lines += n;
+    return n;
+}
+
+static void status_draw(unsigned int elapsed_ms) {
+    char line[LOG_LINE];
+
+    if (!lg.tty || lg.status == NULL)
+        return;
+    line[0] = 0;
+    lg.status(lg.status_arg, line, sizeof (line), elapsed_ms);
+    fprintf(stdout, "\r%s\033[K", line);
+    lg.status_shown = 1;
+}
+
+static unsigned long long log_now_ms(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void * log_main(void *arg) {
+    struct timespec poll = {0, LOG_POLL_MS * 1000000L};
+    unsigned long long last = log_now_ms(), now;
+
+    (void) arg;
+
+    /* the terminal can wait; the reader and writer cannot */
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19);
+
+    while (!__atomic_load_n(&lg.stop, __ATOMIC_ACQUIRE)) {
+        /* sleep only once the ring is empty, so a verbose log keeps up */
+        if (log_drain() == 0)
+            nanosleep(&poll, NULL);
+        now = log_now_ms();
+        if (now - last >= LOG_STATUS_MS) {
+            status_draw((unsigned int) (now - last));
+            last = now;
+        }
+        fflush(stdout);
+    }
+    return NULL;
+}
+
+int log_start(log_status_fn status, void *arg) {
+    sigset_t all, old;
+    int rc;
+
+    lg.status = status;
+    lg.status_arg = arg;
+    fflush(stdout);
+
+    /* the log thread never takes signals; Ctrl-C belongs to the reader */
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    rc = pthread_create(&lg.thread, NULL, log_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc != 0) {
+        printf("pthread_create error=%d %s\n", rc, strerror(rc));
+        return -1;
+    }
+    __atomic_store_n(&lg.running, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* Print what is still queued, leave the last status on screen and stop */
+void log_stop(void) {
+    if (lg.running) {
+        __atomic_store_n(&lg.stop, 1, __ATOMIC_RELEASE);
+        pthread_join(lg.thread, NULL);
+        __atomic_store_n(&lg.running, 0, __ATOMIC_RELEASE);
+        log_drain();
+        status_draw(0);
+        if (lg.status_shown)
+            fputs("\n", stdout);
+        lg.status_shown = 0;
+        fflush(stdout);
+    }
+    if (lg.dropped > 0)
+        printf("log: %lu lines dropped, ring full\n", lg.dropped);
+    if (lg.verbose != NULL) {
+        printf("verbose log: %lu lines\n", lg.lines);
+        fclose(lg.verbose);
+        lg.verbose = NULL;
+    }
+    free(lg.slots);
+    lg.slots = NULL;
+}
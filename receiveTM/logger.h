@@ -0,0 +1,50 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : logger.h
+ * Source(s)     : logger.c
+ * Description   : Console logging off the receive path. While a pass runs,
+ *                 log_msg() and log_frame() only format into a lock-free
+ *                 ring of preallocated lines; a low-priority thread drains
+ *                 it to the terminal and redraws a one-line status summary a
+ *                 few times a second. Producers never block and never make
+ *                 a syscall: when the ring is full the line is dropped and
+ *                 counted.
+ *
+ *                 log_frame() lines (one per received frame) are only kept
+ *                 when a verbose log file was given to log_open(), and go to
+ *                 that file alone. Before log_start() and after log_stop()
+ *                 log_msg() prints directly.
+ *
+ *                 A thread that names itself with log_set_name() gets its
+ *                 lines prefixed "[name] ", so the links of a multi-source
+ *                 receiver can be told apart.
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stddef.h>
+
+#define LOG_SLOTS     4096              //lines buffered, must be a power of two
+#define LOG_LINE      240               //bytes per line, longer lines are cut
+#define LOG_POLL_MS   20                //how often the log thread drains the ring
+#define LOG_STATUS_MS 250               //status line refresh period
+
+/* Fills buf with the status line; called from the log thread */
+typedef void (*log_status_fn)(void *arg, char *buf, size_t size, unsigned int elapsed_ms);
+
+int  log_open(const char *verbose_path);
+int  log_start(log_status_fn status, void *arg);
+void log_msg(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void log_frame(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+int  log_verbose(void);
+void log_set_name(const char *name);
+void log_stop(void);
+
+#endif /* LOGGER_H */
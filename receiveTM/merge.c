@@ -0,0 +1,211 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : merge.c
+ * Header(s)     : merge.h
+ * Description   : Lines up the frame rings of two redundant links by the
+ *                 time each frame was received and picks the copy of each
+ *                 frame to store. Content hashes only compare the two copies
+ *                 of a pair, so each head is hashed once.
+ * Function(s)   : void merge_init(tm_merger*, frame_ring**)     - Attach the links' rings
+ *                 int merge_next(tm_merger*, merge_step*, __u64) - Decide what to consume next
+ *                 void merge_report(const tm_merger*)
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "merge.h"
+
+void merge_init(tm_merger *m, frame_ring *rings[MERGE_LINKS]) {
+    int l;
+
+    memset(m, 0, sizeof (*m));
+    for (l = 0; l < MERGE_LINKS; l++)
+        m->ring[l] = rings[l];
+}
+
+/* 64-bit words through a multiply-xorshift, a few GB/s; only has to tell frames apart */
+static __u64 frame_hash(const unsigned char *p, int len) {
+    __u64 h = 0x9e3779b97f4a7c15ull ^ (__u64) len;
+    __u64 w;
+
+    for (; len >= 8; p += 8, len -= 8) {
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdull;
+        h ^= h >> 29;
+    }
+    for (w = 0; len > 0; len--)
+        w = w << 8 | p[len - 1];
+    h = (h ^ w) * 0xc4ceb9fe1a85ec53ull;
+    return h ^ h >> 32;
+}
+
+/* Hash of a queued frame's content */
+static __u64 slot_hash(const frame_slot *s) {
+    return frame_hash(s->zc != NULL ? s->zc : s->data, s->len);
+}
+
+static __u64 gap_ns(const frame_slot *a, const frame_slot *b) {
+    return a->rx_ns > b->rx_ns ? a->rx_ns - b->rx_ns : b->rx_ns - a->rx_ns;
+}
+
+/*
+ * Link l consumes f: the rx_ns spacing of two full-length frames in a row is
+ * one frame time, averaged over 16. A longer spacing is a lost frame or a
+ * pause in the downlink, and counts as no more than four frame times.
+ */
+static void merge_clock(tm_merger *m, int l, const frame_slot *f) {
+    __u64 d;
+
+    if (f->len > m->full_len)
+        m->full_len = f->len;
+    if (f->len == m->full_len && m->last_len[l] == f->len && f->rx_ns > m->last_ns[l]) {
+        d = f->rx_ns - m->last_ns[l];
+        if (m->frame_ns == 0) {
+            m->frame_ns = d;
+        } else {
+            if (d > 4 * m->frame_ns)
+                d = 4 * m->frame_ns;
+            m->frame_ns = m->frame_ns - m->frame_ns / 16 + d / 16;
+        }
+    }
+    m->last_ns[l] = f->rx_ns;
+    m->last_len[l] = f->len;
+}
+
+/*
+ * Half a frame time: copies of one frame are received closer together than
+ * that, and two frames of one link further apart. Until two full frames in a
+ * row have been consumed, the first two equal-length frames in a row queued
+ * on either link give the frame time. 0 while there are none.
+ */
+static __u64 merge_tolerance(tm_merger *m) {
+    frame_slot *s, *n;
+    unsigned int i;
+    int l;
+
+    for (l = 0; l < MERGE_LINKS && m->frame_ns == 0; l++) {
+        s = ring_peek_at(m->ring[l], 0);
+        for (i = 1; i < MERGE_WINDOW && s != NULL; i++, s = n) {
+            n = ring_peek_at(m->ring[l], i);
+            if (n != NULL && n->len == s->len && n->rx_ns > s->rx_ns) {
+                m->frame_ns = n->rx_ns - s->rx_ns;
+                break;
+            }
+        }
+    }
+    return m->frame_ns / 2;
+}
+
+/* Both heads are copies of one frame: keep one that passed its CRC check */
+static void merge_pair(tm_merger *m, merge_step *st, frame_slot *a, frame_slot *b, int same) {
+    int bad_a = (a->flags & FRAME_CRC_ERROR) != 0;
+    int bad_b = (b->flags & FRAME_CRC_ERROR) != 0;
+
+    st->take[0] = st->take[1] = 1;
+    st->from = 0;
+    merge_clock(m, 0, a);
+    merge_clock(m, 1, b);
+    if (bad_a && !bad_b) {
+        st->from = 1;
+        m->repaired++;
+    } else if (bad_b && !bad_a) {
+        m->repaired++;
+    } else if (bad_a) {
+        m->bad++;
+    } else if (same) {
+        m->both++;
+    } else {
+        m->differ++;
+    }
+    m->frames++;
+}
+
+/* The head of link l is a frame the other link missed; stored even with a bad CRC, it keeps its place */
+static void merge_only(tm_merger *m, merge_step *st, int l, frame_slot *f) {
+    st->take[l] = 1;
+    st->from = l;
+    merge_clock(m, l, f);
+    m->only[l]++;
+    if (f->flags & FRAME_CRC_ERROR)
+        m->bad++;
+    m->frames++;
+}
+
+/*
+ * Decide what to consume next, without waiting. Returns 1 with st filled in,
+ * 0 when a link has to deliver more frames first (st->wait), -1 once both
+ * links are done.
+ */
+int merge_next(tm_merger *m, merge_step *st, __u64 now_ns) {
+    __u64 wait_ns = MERGE_WAIT_MS * 1000000ull;
+    frame_slot *h[MERGE_LINKS], *a, *b;
+    __u64 tol;
+    int l;
+
+    memset(st, 0, sizeof (*st));
+    st->from = -1;
+    st->wait = -1;
+    for (l = 0; l < MERGE_LINKS; l++) {
+        h[l] = ring_peek_at(m->ring[l], 0);
+        /* idle markers carry no frame */
+        if (h[l] != NULL && (h[l]->flags & FRAME_IDLE)) {
+            st->take[l] = 1;
+            return 1;
+        }
+    }
+    a = h[0];
+    b = h[1];
+
+    /* one link has a frame: store it once the other has fallen too far behind to have it */
+    if (a == NULL || b == NULL) {
+        if (a == NULL && b == NULL) {
+            if (ring_done(m->ring[0]) && ring_done(m->ring[1]))
+                return -1;
+            st->wait = ring_done(m->ring[0]) ? 1 : 0;
+            return 0;
+        }
+        l = (a != NULL) ? 0 : 1;
+        if (ring_closed(m->ring[!l]) || (now_ns > h[l]->mono_ns + wait_ns && ring_staged(m->ring[!l]) == 0)) {
+            merge_only(m, st, l, h[l]);
+            return 1;
+        }
+        st->wait = !l;
+        return 0;
+    }
+
+    /* no frame time yet: more frames tell it, unless they are late */
+    tol = merge_tolerance(m);
+    if (tol == 0 && !(ring_closed(m->ring[0]) && ring_closed(m->ring[1])) &&
+            now_ns < a->mono_ns + wait_ns && now_ns < b->mono_ns + wait_ns) {
+        st->wait = ring_closed(m->ring[0]) ? 1 : 0;
+        return 0;
+    }
+
+    /*
+     * Each head is the first frame its link has left, so a head received
+     * more than half a frame time before the other is a frame the other
+     * link missed. Content repeats from frame to frame, so it does not
+     * line frames up: it only tells the copies of a pair apart.
+     */
+    if (gap_ns(a, b) > tol || a->len != b->len) {
+        l = (a->rx_ns <= b->rx_ns) ? 0 : 1;
+        merge_only(m, st, l, h[l]);
+    } else {
+        merge_pair(m, st, a, b, slot_hash(a) == slot_hash(b));
+    }
+    return 1;
+}
+
+void merge_report(const tm_merger *m) {
+    printf("merge: %lu frames stored, %lu on both links, %lu only on link1, %lu only on link2\n",
+            m->frames - (m->drop_bad ? m->bad : 0), m->both, m->only[0], m->only[1]);
+    printf("merge: %lu CRC errors repaired from the other link, %lu frames %s with a CRC error, %lu copies disagreed\n",
+            m->repaired, m->bad, m->drop_bad ? "left out" : "stored", m->differ);
+}
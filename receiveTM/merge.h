@@ -0,0 +1,81 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : merge.h
+ * Source(s)     : merge.c
+ * Description   : Redundant-link merge (-m). Two receivers hear the same
+ *                 downlink; each link's reader fills its own frame ring and
+ *                 a single merger thread consumes both, lining the frames up
+ *                 so that each downlink frame is stored once, from the copy
+ *                 that passed its CRC check, and a frame only one receiver
+ *                 heard still makes it into the image.
+ *
+ *                 Frames are lined up by the time the links received them
+ *                 (rx_ns), since image content repeats from frame to frame.
+ *                 The heads of the two rings are copies of one frame when
+ *                 they were received within half a frame time of each other
+ *                 and have the same length; their 64-bit content hashes then
+ *                 only tell identical copies from a CRC error or copies that
+ *                 disagree. Otherwise the earlier head is a frame the other
+ *                 link missed, and is stored alone. The frame time is the
+ *                 averaged rx_ns spacing of full-length frames. A frame one
+ *                 link has while the other has none queued is stored alone
+ *                 once the other link is MERGE_WAIT_MS late with it and has
+ *                 no frames left in its FEC decoders (ring_staged()).
+ *
+ *                 A frame that failed its CRC on every link is stored so it
+ *                 keeps its place, unless frames carry a framing header
+ *                 (drop_bad): then the header places the rest and the frame
+ *                 is left out, a hole in the image's completeness bitmap.
+ *
+ *                 merge_next() only decides; the caller journals and counts
+ *                 every frame it consumes, so each link keeps its own
+ *                 capture journal and statistics.
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef MERGE_H
+#define MERGE_H
+
+#include <linux/types.h>
+
+#include "ring.h"
+
+#define MERGE_LINKS   2                 //receivers merged
+#define MERGE_WINDOW  64                //frames looked at on each link for a first frame time
+#define MERGE_WAIT_MS 200               //a frame one link has waits this long for the other's copy
+#define MERGE_POLL_MS 20                //a merger waiting for frames looks again this often
+
+typedef struct tm_merger {
+    frame_ring    *ring[MERGE_LINKS];
+    int            drop_bad;            //a frame every copy of which failed its CRC is left out (-H)
+    __u64          frame_ns;            //rx_ns spacing of full-length frames, averaged
+    int            full_len;            //longest frame seen
+    __u64          last_ns[MERGE_LINKS]; //rx_ns and length of the last frame each link consumed
+    int            last_len[MERGE_LINKS];
+
+    /* frames passed on */
+    unsigned long  frames;
+    unsigned long  both;                //identical copies on both links
+    unsigned long  only[MERGE_LINKS];   //heard by one link alone
+    unsigned long  repaired;            //one copy failed its CRC, the other was kept
+    unsigned long  bad;                 //every copy failed its CRC
+    unsigned long  differ;              //clean copies that disagree, the first link's kept
+} tm_merger;
+
+/* What merge_next() decided */
+typedef struct merge_step {
+    int            take[MERGE_LINKS];   //1: consume the head of that link's ring
+    int            from;                //link whose head is passed on, -1 for none
+    int            wait;                //nothing decided: link to wait for a frame from
+} merge_step;
+
+void merge_init(tm_merger *m, frame_ring *rings[MERGE_LINKS]);
+int  merge_next(tm_merger *m, merge_step *st, __u64 now_ns);
+void merge_report(const tm_merger *m);
+
+#endif /* MERGE_H */
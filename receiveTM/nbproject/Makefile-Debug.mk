@@ -35,7 +35,27 @@ OBJECTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}
 
 # Object Files
 OBJECTFILES= \
-	${OBJECTDIR}/receiveTM.o
+	${OBJECTDIR}/assembler.o \
+	${OBJECTDIR}/crc32c.o \
+	${OBJECTDIR}/events.o \
+	${OBJECTDIR}/fec.o \
+	${OBJECTDIR}/framing.o \
+	${OBJECTDIR}/imagemap.o \
+	${OBJECTDIR}/journal.o \
+	${OBJECTDIR}/linkstats.o \
+	${OBJECTDIR}/logger.o \
+	${OBJECTDIR}/merge.o \
+	${OBJECTDIR}/receiveTM.o \
+	${OBJECTDIR}/recover.o \
+	${OBJECTDIR}/ring.o \
+	${OBJECTDIR}/rs.o \
+	${OBJECTDIR}/rt.o \
+	${OBJECTDIR}/sha256.o \
+	${OBJECTDIR}/source.o \
+	${OBJECTDIR}/storage.o \
+	${OBJECTDIR}/storage_direct.o \
+	${OBJECTDIR}/storage_mmap.o \
+	${OBJECTDIR}/storage_uring.o
 
 
 # C Compiler Flags
@@ -52,7 +72,7 @@ FFLAGS=
 ASFLAGS=
 
 # Link Libraries and Options
-LDLIBSOPTIONS=
+LDLIBSOPTIONS=-lpthread
 
 # Build Targets
 .build-conf: ${BUILD_SUBPROJECTS}
@@ -62,11 +82,111 @@ ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/receivetm: ${OBJECTFILES}
 	${MKDIR} -p ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}
 	${LINK.c} -o ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/receivetm ${OBJECTFILES} ${LDLIBSOPTIONS}
 
+${OBJECTDIR}/assembler.o: assembler.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/assembler.o assembler.c
+
+${OBJECTDIR}/crc32c.o: crc32c.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/crc32c.o crc32c.c
+
+${OBJECTDIR}/events.o: events.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/events.o events.c
+
+${OBJECTDIR}/fec.o: fec.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/fec.o fec.c
+
+${OBJECTDIR}/framing.o: framing.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/framing.o framing.c
+
+${OBJECTDIR}/imagemap.o: imagemap.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/imagemap.o imagemap.c
+
+${OBJECTDIR}/journal.o: journal.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/journal.o journal.c
+
+${OBJECTDIR}/linkstats.o: linkstats.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/linkstats.o linkstats.c
+
+${OBJECTDIR}/logger.o: logger.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/logger.o logger.c
+
+${OBJECTDIR}/merge.o: merge.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/merge.o merge.c
+
 ${OBJECTDIR}/receiveTM.o: receiveTM.c 
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/receiveTM.o receiveTM.c
 
+${OBJECTDIR}/recover.o: recover.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/recover.o recover.c
+
+${OBJECTDIR}/ring.o: ring.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/ring.o ring.c
+
+${OBJECTDIR}/rs.o: rs.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/rs.o rs.c
+
+${OBJECTDIR}/rt.o: rt.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/rt.o rt.c
+
+${OBJECTDIR}/sha256.o: sha256.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/sha256.o sha256.c
+
+${OBJECTDIR}/source.o: source.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/source.o source.c
+
+${OBJECTDIR}/storage.o: storage.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/storage.o storage.c
+
+${OBJECTDIR}/storage_direct.o: storage_direct.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/storage_direct.o storage_direct.c
+
+${OBJECTDIR}/storage_mmap.o: storage_mmap.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/storage_mmap.o storage_mmap.c
+
+${OBJECTDIR}/storage_uring.o: storage_uring.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -g -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/storage_uring.o storage_uring.c
+
 # Subprojects
 .build-subprojects:
 
@@ -5,7 +5,9 @@
  *
  *
  * Filename      : receiveTM.c
- * Header(s)     : synclink.h
+ * Header(s)     : synclink.h, ring.h, assembler.h, storage.h, source.h, journal.h,
+ *                 linkstats.h, logger.h, rt.h, events.h, recover.h, merge.h,
+ *                 framing.h, crc32c.h, sha256.h, rs.h, fec.h
  * Description   : Uses the Microgate USB Synclink adapter to receive 10 Mbps 
  *                 telemetry data from VDX104 flight computer with MOSES flightSW
  *                 and save locally to ./data_output/
@@ -25,223 +27,1300 @@
  *                     2. configure serial device (syscall ioctl)
  *                     3. receive data from serial device (syscall read)
  *                     4. write received data to a file
- * Function(s)   : FILE* openFile(char*)    - Opens file streams/handles errors
- *                 void sigint_handler(int) - Does Nothing
- *                 int main(int, char*)     - Contains initialization/read/write
+ *                 Reception runs on two threads joined by a lock-free frame
+ *                 ring (ring.c): the reader thread only pulls frames off the
+ *                 frame source (source.c), the writer thread classifies them
+ *                 and writes them to disk (assembler.c), so a disk stall no
+ *                 longer backs up the N_HDLC receive buffers.
+ *
+ *                 Besides the Synclink device, frames can come from a pty,
+ *                 FIFO, UDP socket or capture file so the pipeline can be
+ *                 exercised without the adapter, e.g.:
+ *                     receivetm -n -o /tmp/tm udp:5000
+ *
+ *                 With -j every frame is also appended, before classification,
+ *                 to a capture journal (journal.c) that can be replayed later
+ *                 with "file:<journal>" to rebuild the pass, as fast as
+ *                 possible or paced from the recorded timestamps (-x), e.g.:
+ *                     receivetm -n -x 4 -o /tmp/replay file:pass.tmj
+ *
+ *                 Images and the catalog are written through stdio by
+ *                 default, asynchronously through io_uring with -w uring,
+ *                 around the page cache with -w direct, or into a mapping
+ *                 preallocated from the catalog geometry with -w mmap
+ *                 (storage.c, storage_uring.c, storage_direct.c,
+ *                 storage_mmap.c).
+ *
+ *                 Link statistics (struct mgsl_icount) are sampled on a timer
+ *                 or every N frames (-s) rather than before every read(), and
+ *                 CRC failures are reported per window of frames (linkstats.c).
+ *                 Every counter is reported as totals per image and per pass,
+ *                 and as rates for any second with a receive error.
+ *
+ *                 Console output goes through a lock-free log ring drained
+ *                 by a low-priority thread (logger.c), which also keeps a
+ *                 status line on the terminal; per-frame lines are only
+ *                 written to a verbose log file (-v).
+ *
+ *                 With -R the reader runs SCHED_FIFO on its own core with
+ *                 all memory locked (rt.c); the delay from a frame becoming
+ *                 available to read() returning it is reported either way
+ *                 when the source can timestamp frames.
+ *
+ *                 The reader never blocks in read(): the source is
+ *                 non-blocking and the reader sleeps in epoll (events.c)
+ *                 only when it runs dry, woken by the source, the due time
+ *                 of a paced replay, SIGINT/SIGTERM through a signalfd, or
+ *                 the link statistics timer.
+ *
+ *                 An image left in image_buf.tmp by a receiver that died is
+ *                 resumed, named or kept aside at start-up (recover.c).
+ *
+ *                 Every source given on the command line is a link of its
+ *                 own, with its own reader and writer threads, ring,
+ *                 statistics and output directory, e.g. both receivers:
+ *                     receivetm -o /data /dev/ttyUSB0 /dev/ttyUSB1
+ *                 With -m the two are redundant receivers of one downlink
+ *                 and a merger thread stores the best copy of each frame
+ *                 into one tree (merge.c).
+ *
+ *                 With -H every frame carries a framing header (framing.c)
+ *                 whose sequence numbers count lost frames exactly and whose
+ *                 byte offsets keep the image in place across them. A frame
+ *                 that carries a CRC-32C (crc32c.c) is checked by the reader,
+ *                 and one that fails is handled like a link CRC error.
+ *
+ *                 Every image's SHA-256 is computed as it is written and
+ *                 saved in <image>.sha256 and its catalog entry, so archive
+ *                 audits need not read it back through the receiver.
+ *
+ *                 With -E every frame is sent as Reed-Solomon codeblocks
+ *                 (rs.c), decoded by a pool of threads per link between its
+ *                 reader and writer (fec.c); a frame that failed the link
+ *                 CRC is stored if it decodes.
+ * Function(s)   : void* reader_main(void*)  - read() frames into the ring
+ *                 void* writer_main(void*)  - drain the ring to disk
+ *                 void* merger_main(void*)  - drain both rings of redundant links to one tree
+ *                 int link_open(rx_ctx*, const char*, const rx_config*)
+ *                                           - Set up one link before its threads start
+ *                 int main(int, char*)      - Contains initialization/thread setup
  * Authors(s)    : Jackson Remington, Roy Smart, Jake Plovanic
  * Date          : Updated 03/12/15
  ******************************************************************************/
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE                     //pthread_timedjoin_np
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <memory.h>
 #include <signal.h>
-#include <fcntl.h>
 #include <unistd.h>
-#include <sys/ioctl.h>
+#include <pthread.h>
 #include <linux/types.h>
-#include <termios.h>
 #include <errno.h>
 #include <sys/time.h>
-#include <sys/statvfs.h>
+#include <sys/stat.h>
 #include <time.h>
 
 #include "synclink.h"
+#include "ring.h"
+#include "assembler.h"
+#include "source.h"
+#include "journal.h"
+#include "linkstats.h"
+#include "logger.h"
+#include "rt.h"
+#include "events.h"
+#include "recover.h"
+#include "merge.h"
+#include "framing.h"
+#include "crc32c.h"
+#include "sha256.h"
+#include "rs.h"
+#include "fec.h"
 
-#ifndef N_HDLC
-#define N_HDLC 13
-#endif
+#define FRAME_DEFAULT_MAX 8192          //glibc BUFSIZ, the old fixed receive buffer
 
-#ifndef BUFSIZ
-#define BUFSIZ 4096
-#endif
+#define IMAGE_ENDS 64                   //completed images awaiting their link totals
+
+#define DRAIN_DEFAULT_MS   5000         //reception after Ctrl-C to finish the image in progress
+#define DRAIN_IDLE_MS      500          //...unless the link is quiet this long
+#define WRITER_DEADLINE_MS 10000        //after the reader stops, to store what is queued
+#define IDLE_DEFAULT_MS    2000         //quiet link that settles an image or entry missing its terminator
 
-/* Handles stream opens and errors*/
-FILE * openFile(char* name) {
+/* Per-link settings from the command line */
+typedef struct rx_config {
+    const char    *data_dir;
+    const char    *journal_path;        //NULL for no journal
+    const char    *backend;
+    flush_policy   policy;
+    unsigned int   ring_slots;
+    size_t         max_frame;
+    unsigned int   stats_ms;
+    unsigned int   stats_every;
+    double         speed;
+    unsigned int   drain_ms;
+    unsigned int   idle_ms;
+    int            framed;              //frames carry a framing header (-H)
+    fec_config     fec;                 //frames are Reed-Solomon codeblocks (-E)
+    rt_config      rt;
+} rx_config;
 
-    FILE *file;
-    file = fopen(name, "a+");
-    fclose(file);
-    file = fopen(name, "r+");
-    if (file == NULL) {
-        printf("fopen error = %d %s\n", errno, strerror(errno));
+/* State shared by the reader and writer threads of one link */
+typedef struct rx_ctx {
+    int            id;                  //index into links
+    char           name[16];            //"link<id + 1>", prefixes its messages when there are several
+    const char    *devname;
+    char           data_dir[TM_PATH_LEN];
+    char           journal_path[TM_PATH_LEN];
+    frame_source   src;
+    frame_ring     ring;
+    fec_pool       fec;                 //decoder threads on the ring (-E)
+    int            fec_depth;           //interleaving depth, 0 without FEC
+    tm_assembler   as;
+    tm_assembler  *out;                 //where the link's frames are assembled: as, or the merged tree (-m)
+    tm_journal     journal;
+    int            journaling;
+    link_stats     stats;
+    unsigned long  read;                //frames read by the reader
+    rt_config      rt;
+    rt_latency     latency;             //frame available to read() returning, reader only
+    rx_events      ev;                  //reader's epoll set
+    size_t         max_frame;           //longest frame kept whole
+    int            framed;              //frames carry a framing header (-H)
+    size_t         resumed;             //image bytes recovered from the last run
+    unsigned long  truncated;           //frames longer than max_frame, cut to it
+    unsigned long  overflows;           //frames the driver dropped as too long (EOVERFLOW)
+    unsigned long  crc_frames;          //frames that failed their CRC check
+    unsigned long  crc32c_frames;       //framed frames with a CRC-32C trailer...
+    unsigned long  crc32c_failed;       //...of which failed it, counted in crc_frames too
+    unsigned int   drain_ms;            //how long a stop request may keep receiving (-D)
+    __u64          drain_ns;            //CLOCK_MONOTONIC of the stop request, 0 if none
+    unsigned long  drain_frames;        //frames read before it
+    const char    *drain_end;           //why the drain ended
+    int            aborted;             //storage failed, the writer gave up
+    unsigned int   idle_ms;             //link idle timeout (-I), 0 off
+    unsigned long  idle_read;           //frames read at the last idle timer tick
+    unsigned int   idle_ticks;          //ticks since then
+    int            idle_mark;           //reader owes the writer a FRAME_IDLE marker
+    unsigned long  idle_marks;
+    link_totals    link_sec;            //counter increments this second
+    link_totals    link_image;          //... in the image being assembled
+    link_totals    link_pass;           //... since the start of the pass
+    unsigned long  images;              //images completed by the writer
+    unsigned long  image_end[IMAGE_ENDS];       //frame number of each image terminator...
+    unsigned int   image_ends;                  //...not yet reported with its link totals
+    unsigned long  crc_errs;            //rxcrc increments reported by the writer
+    unsigned long  status_frames;       //frames and bytes at the last status line
+    unsigned long long status_bytes;
+    double         status_fps;
+    double         status_mbps;
+    unsigned long  frames;              //frames stored by the writer
+    unsigned long long bytes;
+    __u64          first_ns;            //mono_ns of the first frame
+    __u64          done_ns;             //CLOCK_MONOTONIC when the writer finished
+    pthread_t      reader;
+    pthread_t      writer;
+    struct timeval runtime_begin;
+} rx_ctx;
+
+static rx_ctx *links;                   //one per frame source, each with its own threads
+static int     nlinks;
+
+/* Redundant receivers (-m): one merger thread stores the links into one tree */
+static struct {
+    int            enabled;
+    tm_merger      m;
+    tm_assembler   as;
+    unsigned int   idle_ms;
+    int            aborted;
+    pthread_t      thread;
+} mg;
+
+static __u64 mono_now(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (__u64) now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/*
+ * The event loop stopped. SIGINT/SIGTERM only start a drain: reception goes
+ * on until the image in progress and its catalog entry are in, the link goes
+ * quiet, or -D ms pass. A second signal, writer_abort() or -D 0 stop at once.
+ */
+static int reader_stop(rx_ctx *rx) {
+    int i;
+
+    /* a signal reaches one reader's signalfd; every other link stops the same way */
+    if (rx->ev.signalled) {
+        rx->ev.signalled = 0;
+        for (i = 0; i < nlinks; i++)
+            if (&links[i] != rx)
+                events_raise(&links[i].ev, rx->ev.signo);
     }
-    //printf("filepath = %d\n", (int)fileno(file));
-    return file;
+    if (rx->ev.signo == 0 || rx->drain_ns != 0 || rx->drain_ms == 0)
+        return 1;
+    rx->drain_ns = mono_now();
+    rx->drain_frames = rx->read;
+    events_resume(&rx->ev);
+    log_msg("\nreceiveTM %s: finishing the image in progress within %u ms, again to stop now\n",
+            rx->ev.signo == SIGTERM ? "terminated" : "interrupted", rx->drain_ms);
+    return 0;
 }
 
-/* handle SIGINT - do nothing */
-void sigint_handler(int sigid) {
+/* Draining: the deadline, or the idle limit counted from the last frame or the stop request */
+static __u64 reader_drain_due(rx_ctx *rx, __u64 last_ns) {
+    __u64 due = rx->drain_ns + rx->drain_ms * 1000000ull;
+
+    if (last_ns < rx->drain_ns)
+        last_ns = rx->drain_ns;
+    if (last_ns + DRAIN_IDLE_MS * 1000000ull < due)
+        due = last_ns + DRAIN_IDLE_MS * 1000000ull;
+    return due;
 }
 
-int main(int argc, char* argv[]) {
-/*********************************************************************************                           
-*                                    VARIABLES
-*********************************************************************************/   
-    FILE *fp = NULL;
-    FILE *outxml = NULL;
-    pid_t MTV_child;
-    int fd, rc;
-    int sigs;
-    int xmlCount       = 0;
-    int xml_check      = 0;                     //Set this value to '0' if expecting ROE first; '1' if expecting XML first
-    int count          = 0;
-    int totalFileSize  = 0;
-    int index          = 0;
-    int ldisc          = N_HDLC;
-    char *xml_header   = malloc(strlen("<ROEIMAGE>") + 1);
-    char *archive_file = malloc(strlen("/media/moses/Data/TM_data/xml_archive/imageindex_000.xml") + 1);
-    char *current_xml  = "/media/moses/Data/TM_data/imageindex.xml";
-    char *image_path   = "/media/moses/Data/TM_data/image_buf.tmp";
-    char *devname;
-    unsigned char buf[BUFSIZ];
-    MGSL_PARAMS params;
-    size_t size = BUFSIZ;
-    struct mgsl_icount icount;
-    struct timeval runtime_begin, runtime_end;
+/* Draining: whether to stop before the next read; boundary is set between images */
+static int reader_drained(rx_ctx *rx, int boundary, __u64 last_ns) {
+    __u64 now = mono_now();
+
+    if (boundary)
+        rx->drain_end = "last image and catalog entry complete";
+    else if (now >= rx->drain_ns + rx->drain_ms * 1000000ull)
+        rx->drain_end = "drain deadline passed";
+    else if (now >= reader_drain_due(rx, last_ns))
+        rx->drain_end = "link idle";
+    else
+        return 0;
+    return 1;
+}
+
+/*
+ * Link idle timer, run by the reader's event loop every idle_ms / 2: after a
+ * quiet idle_ms asks for one FRAME_IDLE marker, which reaches the writer in
+ * order with the frames. Costs nothing per frame.
+ */
+static void reader_idle(void *arg) {
+    rx_ctx *rx = arg;
+
+    if (rx->read != rx->idle_read) {
+        rx->idle_read = rx->read;
+        rx->idle_ticks = 0;
+    } else if (++rx->idle_ticks == 2 && rx->read > 0) {
+        rx->idle_mark = 1;
+    }
+}
+
+/* 
+ * Reader thread: the only thread that touches the frame source during a pass.
+ * It reads until the source runs dry and only then sleeps in events_wait();
+ * Ctrl-C, SIGTERM and writer_abort() reach it through the same epoll set.
+ * A stop signal lets the image being received finish first, see reader_stop().
+ * Each link has its own reader; a signal stops them all.
+ *
+ * When the storage back-end publishes the mapping of the image being
+ * assembled (-w mmap), image data is read straight into it at the offset the
+ * writer will expect; the reader only needs to follow the terminators to know
+ * which image and offset that is.
+ */
+void * reader_main(void *arg) {
+    rx_ctx *rx = arg;
+    frame_source *src = &rx->src;
+    frame_slot *slot;
+    struct timeval runtime_end;
+    struct timespec now;
     int runtime_elapsed;
-    time_t current_time;
-    struct tm ts;
-    char timestamp[80];
-    
-    /*disk check debug stuff*/
-    unsigned long free_disk;
-    struct statvfs * disk_info = malloc(sizeof(statvfs));
+    unsigned char *dst;
+    int image_mode = 1;                 //image data expected: at start and after an XML terminator
+    unsigned long images = 0;           //image terminators seen
+    size_t image_off = rx->resumed;     //image bytes since the current image started
+    __u64 last_ns = 0;                  //mono_ns of the last frame
+    __u64 due_ns;
+    int rc, len;
+
+    if (nlinks > 1)
+        log_set_name(rx->name);
+    rt_reader(&rx->rt);
+
+    for (;;) {
+        /* after a stop request, only until the image in progress is complete */
+        if (rx->drain_ns != 0 && reader_drained(rx, image_mode && image_off == 0, last_ns))
+            break;
+
+        /* wait for a free slot; only fails once the writer has given up */
+        slot = ring_reserve(&rx->ring);
+        if (slot == NULL)
+            break;
+
+        /* quiet link: the writer settles what lost its terminator; so does this thread's count */
+        if (rx->idle_mark) {
+            rx->idle_mark = 0;
+            rx->idle_marks++;
+            slot->len = 0;
+            slot->flags = FRAME_IDLE;
+            slot->zc = NULL;
+            slot->mono_ns = mono_now();
+            slot->rx_ns = slot->mono_ns;
+            slot->wall_ns = 0;
+            ring_publish(&rx->ring);
+            if (image_mode && image_off > 0) {
+                images++;
+                image_mode = 0;
+            }
+            image_off = 0;
+            continue;
+        }
+
+        /* image data goes straight into the destination mapping when there is one, never when merging, framed or coded */
+        dst = (image_mode && rx->out == &rx->as && !rx->framed && rx->fec_depth == 0) ?
+                store_landing_get(&rx->as.store, images, image_off, rx->ring.slot_size) : NULL;
+
+        /*
+         * wait for and receive data from the frame source; the buffer holds
+         * one byte more than the max frame, so a longer frame shows up as
+         * rc > max_frame whether the source truncates or not
+         */
+        rc = src->read_frame(src, dst != NULL ? dst : slot->data, rx->ring.slot_size);
+
+        /* Check received packet size for expected values */
+        if (rc < 0) {
+            /* read error */
+            if (errno == EOVERFLOW) {
+                /* N_HDLC discards a frame that does not fit the buffer */
+                rx->overflows++;
+                log_msg("frame %lu: longer than %zu bytes, discarded by the driver\n",
+                        rx->read + 1, rx->max_frame);
+                continue;
+            } else if (errno == EAGAIN || errno == EINTR) {
+                /* nothing to read yet: sleep until the source is readable or its frame is due */
+                due_ns = src->due_ns;
+                if (rx->drain_ns != 0 && (due_ns == 0 || reader_drain_due(rx, last_ns) < due_ns))
+                    due_ns = reader_drain_due(rx, last_ns);
+                src->due_ns = 0;
+                if (events_wait(&rx->ev, due_ns) < 0 && reader_stop(rx))
+                    break;
+                continue;
+            }
+            else {
+                printf("read error=%d %s\n", errno, strerror(errno));
+                break;
+            }
+        } else if (rc == 0) {
+            if (src->eof_ok) {
+                log_msg("\nend of input from %s:%s\n", src->type, src->path);
+                break;
+            }
+            /* Incorrect synclink settings - set NONBLOCK mode */
+            gettimeofday(&runtime_end, NULL);
+            runtime_elapsed = 1000000 * ((long) (runtime_end.tv_sec) - (long) (rx->runtime_begin.tv_sec)) + (long) (runtime_end.tv_usec) - (long) (rx->runtime_begin.tv_usec);
+            printf("program ran for %-3.2f seconds before failing\n", (float) runtime_elapsed / (float) 1000000);
+            printf("read returned with no data - set NONBLOCK mode to continue\n");
+            break;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        slot->mono_ns = (__u64) now.tv_sec * 1000000000ull + now.tv_nsec;
+        clock_gettime(CLOCK_REALTIME, &now);
+        slot->wall_ns = (__u64) now.tv_sec * 1000000000ull + now.tv_nsec;
+        if (src->ready_ns != 0 && slot->wall_ns > src->ready_ns)
+            rt_latency_add(&rx->latency, slot->wall_ns - src->ready_ns, rx->read + 1);
+        slot->rx_ns = src->frame_ns != 0 ? src->frame_ns : slot->mono_ns;
+
+        slot->flags = 0;
+        slot->num = rx->read + 1;
+        if (src->crc_error) {
+            slot->flags |= FRAME_CRC_ERROR;
+            rx->crc_frames++;
+        }
+        if ((size_t) rc > rx->max_frame) {
+            rc = rx->max_frame;
+            slot->flags |= FRAME_TRUNCATED;
+            rx->truncated++;
+            log_msg("frame %lu: longer than %zu bytes, truncated (raise -M)\n", rx->read + 1, rx->max_frame);
+        }
+
+        /* end-to-end CRC-32C: a frame that fails it is flagged exactly as the driver flags its own */
+        if (rx->framed && rx->fec_depth == 0 && !(slot->flags & FRAME_CRC_ERROR)) {
+            switch (framing_check(slot->data, rc)) {
+                case -1:
+                    slot->flags |= FRAME_CRC_ERROR;
+                    rx->crc_frames++;
+                    rx->crc32c_failed++;
+                    log_msg("frame %lu: CRC-32C mismatch\n", rx->read + 1);
+                    /* fall through */
+                case 1:
+                    rx->crc32c_frames++;
+                    break;
+            }
+        }
+
+        /* a coded frame holds its data in order, ahead of the check bytes; the decoders do the rest */
+        len = rx->fec_depth > 0 ? rs_decoded_len(rc, rx->fec_depth) : rc;
+        if (len < 0)
+            len = rc;                   //not a coded length: the decoders reject it
+
+        /* terminators are told apart by length; move them out of the image region */
+        slot->zc = NULL;
+        if (slot->flags & FRAME_CRC_ERROR) {
+            /* not assembled, see writer_main(); the next frame takes its place */
+            if (dst != NULL)
+                memcpy(slot->data, dst, rc);
+        } else if (rx->framed) {
+            /* the header says what the frame is; the writer checks the rest */
+            switch (framing_type(slot->data, len)) {
+                case FRAMING_DATA:
+                    image_mode = 1;
+                    image_off += len;
+                    break;
+                case FRAMING_TERM_XML:
+                    image_mode = 1;
+                    image_off = 0;
+                    break;
+                case FRAMING_XML:
+                case FRAMING_TERM_IMAGE:
+                    image_mode = 0;
+                    image_off = 0;
+                    break;
+            }
+        } else if (len == TERM_IMAGE_LEN || len == TERM_XML_LEN) {
+            if (dst != NULL)
+                memcpy(slot->data, dst, rc);
+            image_mode = (len == TERM_XML_LEN);
+            if (len == TERM_IMAGE_LEN)
+                images++;
+            image_off = 0;
+        } else if (image_mode && image_off >= __atomic_load_n(&rx->out->image_bytes, __ATOMIC_RELAXED) &&
+                len >= (int) strlen(XML_HEADER) &&
+                memcmp(dst != NULL ? dst : slot->data, XML_HEADER, strlen(XML_HEADER)) == 0) {
+            /* an entry after a full image: the writer finishes the image, see assembler.c */
+            if (dst != NULL)
+                memcpy(slot->data, dst, rc);
+            image_mode = 0;
+            images++;
+            image_off = 0;
+        } else if (image_mode) {
+            slot->zc = dst;
+            image_off += len;
+        }
+
+        if (slot->zc == NULL)
+            slot->data[rc] = 0;
+        slot->len = rc;
+        ring_publish(&rx->ring);
+
+        /* link counters are sampled off this path, see linkstats.c */
+        __atomic_store_n(&rx->read, rx->read + 1, __ATOMIC_RELEASE);
+        linkstats_frame(&rx->stats, rx->read);
+
+        /* a backlog never sleeps, but timers and signals are still looked at */
+        last_ns = slot->mono_ns;
+        if (events_poll(&rx->ev, last_ns) < 0 && reader_stop(rx))
+            break;
+    }
+
+    if (rx->ev.stopped)
+        log_msg("\nreceiveTM %s\n", rx->ev.signo == SIGTERM ? "terminated" : rx->ev.signo ? "interrupted" : "stopped");
+    else if (rx->drain_end != NULL)
+        log_msg("receiveTM stopped: %s\n", rx->drain_end);
+
+    /* close the last statistics window, then let the writer drain the ring */
+    linkstats_stop(&rx->stats);
+    ring_close(&rx->ring);
+    return NULL;
+}
+
+/* Storage failure: stop the reader at once, with no drain */
+static void writer_abort(rx_ctx *rx) {
+    rx->aborted = 1;
+    ring_close(&rx->ring);
+    events_stop(&rx->ev);
+}
+
+/* Print and reset the link totals of the oldest completed image */
+static void writer_image_link(rx_ctx *rx) {
+    char label[64];
+
+    /* the merger reports for both links, under no link's name */
+    snprintf(label, sizeof (label), "    image %lu %s", rx->images - rx->image_ends + 1, mg.enabled ? rx->name : "link");
+    linkstats_report(label, &rx->link_image);
+    memset(&rx->link_image, 0, sizeof (rx->link_image));
+    memmove(rx->image_end, rx->image_end + 1, --rx->image_ends * sizeof (rx->image_end[0]));
+}
+
+/*
+ * Report and journal the link statistics samples whose frames have all been
+ * stored. Counter increments are attributed to the frames read between a
+ * sample and the one before it; a window that spans image terminators is
+ * shared out among those images by frame position. Rates are printed for
+ * every second with a receive error.
+ */
+static int writer_stats(rx_ctx *rx, unsigned long upto) {
+    link_sample cur, prev, from, mid;
+    journal_stats_rec rec;
+    __u32 crc;
+
+    while (linkstats_next(&rx->stats, upto, &cur, &prev)) {
+        crc = cur.icount.rxcrc - prev.icount.rxcrc;
+        if (crc != 0)
+            log_msg("    CRC Failed! %u errors in frames %lu-%lu\n", crc, prev.frames + 1, cur.frames);
+        rx->crc_errs += crc;
+        while (rx->image_ends > 0 && rx->image_end[0] <= prev.frames)
+            writer_image_link(rx);
+        linkstats_add(&rx->link_sec, &cur, &prev);
+        linkstats_add(&rx->link_pass, &cur, &prev);
+        for (from = prev; rx->image_ends > 0 && rx->image_end[0] <= cur.frames; from = mid) {
+            linkstats_split(&from, &cur, rx->image_end[0], &mid);
+            linkstats_add(&rx->link_image, &mid, &from);
+            writer_image_link(rx);
+        }
+        linkstats_add(&rx->link_image, &cur, &from);
+        if (rx->link_sec.ns >= 1000000000ull) {
+            if (linkstats_errors(&rx->link_sec))
+                linkstats_report("    link errors", &rx->link_sec);
+            memset(&rx->link_sec, 0, sizeof (rx->link_sec));
+        }
+        if (!rx->journaling)
+            continue;
+        memset(&rec, 0, sizeof (rec));
+        rec.frames = cur.frames;
+        rec.icount = cur.icount;
+        if (journal_append(&rx->journal, (unsigned char *) &rec, sizeof (rec),
+                cur.mono_ns, 0, crc, JOURNAL_REC_STATS) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* Journal a frame as it came off the link, before classification can lose anything; coded, with -E */
+static int writer_journal(rx_ctx *rx, frame_slot *slot, unsigned char *frame) {
+    unsigned int flags = 0;
+    int len = slot->len;
+
+    if (!rx->journaling)
+        return 0;
+    if (slot->raw != NULL) {
+        frame = slot->raw;
+        len = slot->raw_len;
+    }
+    if (slot->flags & FRAME_TRUNCATED)
+        flags |= JOURNAL_REC_TRUNC;
+    if (slot->flags & (FRAME_CRC_ERROR | FRAME_RECOVERED))
+        flags |= JOURNAL_REC_CRC;
+    if (journal_append(&rx->journal, frame, len, slot->mono_ns, slot->wall_ns, 0, flags) < 0 ||
+            journal_idle(&rx->journal, rx->out->store.policy.flush_ms) < 0)
+        return -1;
+    return 0;
+}
+
+/* Count a frame taken off the ring and report the link statistics it completes */
+static void writer_count(rx_ctx *rx, frame_slot *slot) {
+    if (rx->frames++ == 0)
+        rx->first_ns = slot->mono_ns;
+    /* the merged tree's images under -m */
+    while (rx->stats.enabled && rx->images != rx->out->store.images) {
+        rx->images++;
+        if (rx->image_ends == IMAGE_ENDS)
+            writer_image_link(rx);
+        rx->image_end[rx->image_ends++] = rx->frames;
+    }
+    rx->bytes += slot->len;
+}
+
+static void writer_done(rx_ctx *rx) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    rx->done_ns = (__u64) now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/* Writer thread: drains the frame ring into image_buf.tmp/imageindex.xml */
+void * writer_main(void *arg) {
+    rx_ctx *rx = arg;
+    frame_slot *slot;
+    unsigned char *frame;
+    unsigned int flush_ms = rx->as.store.policy.flush_ms;
+
+    if (nlinks > 1)
+        log_set_name(rx->name);
+    for (;;) {
+        slot = ring_peek_timed(&rx->ring, flush_ms);
+        if (slot == NULL) {
+            if (ring_done(&rx->ring))
+                break;
+            /* idle link: commit what is buffered so the loss window stays bounded */
+            if (writer_stats(rx, rx->frames) < 0 || assembler_idle(&rx->as) < 0 ||
+                    (rx->journaling && journal_idle(&rx->journal, flush_ms) < 0)) {
+                writer_abort(rx);
+                break;
+            }
+            continue;
+        }
+
+        if (slot->flags & FRAME_IDLE) {
+            if (assembler_link_idle(&rx->as, rx->idle_ms) < 0) {
+                writer_abort(rx);
+                break;
+            }
+            ring_release(&rx->ring);
+            continue;
+        }
+
+        /* frames read in place live in the image mapping, not the slot */
+        frame = slot->zc != NULL ? slot->zc : slot->data;
+        if (writer_journal(rx, slot, frame) < 0) {
+            writer_abort(rx);
+            break;
+        }
+
+        /* a frame that failed its CRC is only journaled, as if the driver had dropped it */
+        if (!(slot->flags & FRAME_CRC_ERROR) && assembler_frame(&rx->as, frame, slot->len) < 0) {
+            writer_abort(rx);
+            break;
+        }
+        writer_count(rx, slot);
+        ring_release(&rx->ring);
+
+        if (writer_stats(rx, rx->frames) < 0) {
+            writer_abort(rx);
+            break;
+        }
+    }
+
+    /* the reader took the last sample before closing the ring */
+    if (writer_stats(rx, rx->frames) < 0)
+        printf("link stats journal failed\n");
+
+    /* a pass stopped mid-image still leaves its data and a valid catalog */
+    if (!rx->aborted && assembler_finish(&rx->as) < 0)
+        printf("storage finish failed\n");
+
+    /* completions are delivered to this thread, so wait for them here */
+    if (assembler_drain(&rx->as) < 0)
+        printf("storage drain failed\n");
+
+    writer_done(rx);
+    return NULL;
+}
+
+/* Storage failure while merging: stop every link */
+static void merger_abort(void) {
+    int l;
+
+    mg.aborted = 1;
+    for (l = 0; l < nlinks; l++)
+        writer_abort(&links[l]);
+}
+
+/* Nothing to merge for a while: the periodic work of an idle writer, for every link */
+static int merger_idle(void) {
+    rx_ctx *rx;
+    int l;
+
+    for (l = 0; l < nlinks; l++) {
+        rx = &links[l];
+        if (writer_stats(rx, rx->frames) < 0 ||
+                (rx->journaling && journal_idle(&rx->journal, mg.as.store.policy.flush_ms) < 0))
+            return -1;
+    }
+    return assembler_idle(&mg.as);
+}
+
+/*
+ * Merger thread (-m), in place of the links' writers: the consumer of both
+ * frame rings. Every frame is journaled and counted on its own link; the
+ * copy merge_next() picks is stored into the merged tree.
+ */
+void * merger_main(void *arg) {
+    unsigned int flush_ms = mg.as.store.policy.flush_ms;
+    __u64 idle_ns = mono_now();         //last time the periodic work was done
+    frame_slot *slot[MERGE_LINKS], *keep;
+    merge_step st;
+    rx_ctx *rx;
+    int l, rc;
+
+    (void) arg;
+    for (;;) {
+        rc = merge_next(&mg.m, &st, mono_now());
+        if (rc < 0)
+            break;
+        if (rc == 0) {
+            rx = &links[st.wait];
+            if (!ring_wait(&rx->ring, ring_fill(&rx->ring), MERGE_POLL_MS) &&
+                    mono_now() >= idle_ns + flush_ms * 1000000ull) {
+                idle_ns = mono_now();
+                if (merger_idle() < 0) {
+                    merger_abort();
+                    break;
+                }
+            }
+            continue;
+        }
+
+        keep = NULL;
+        for (l = 0; l < MERGE_LINKS; l++) {
+            slot[l] = st.take[l] ? ring_peek_at(&links[l].ring, 0) : NULL;
+            if (slot[l] == NULL)
+                continue;
+            if (slot[l]->flags & FRAME_IDLE) {
+                /* the downlink is quiet when the other receiver has nothing queued either */
+                if (ring_fill(&links[!l].ring) == 0 && assembler_link_idle(&mg.as, mg.idle_ms) < 0)
+                    rc = -1;
+                continue;
+            }
+            if (writer_journal(&links[l], slot[l], slot[l]->data) < 0)
+                rc = -1;
+            if (l == st.from && !(mg.m.drop_bad && (slot[l]->flags & FRAME_CRC_ERROR)))
+                keep = slot[l];
+        }
+        if (rc < 0 || (keep != NULL && assembler_frame(&mg.as, keep->data, keep->len) < 0)) {
+            merger_abort();
+            break;
+        }
+
+        for (l = 0; l < MERGE_LINKS; l++) {
+            if (slot[l] == NULL)
+                continue;
+            rx = &links[l];
+            if (!(slot[l]->flags & FRAME_IDLE))
+                writer_count(rx, slot[l]);
+            ring_release(&rx->ring);
+            if (writer_stats(rx, rx->frames) < 0)
+                rc = -1;
+        }
+        if (rc < 0) {
+            merger_abort();
+            break;
+        }
+    }
+
+    for (l = 0; l < nlinks; l++)
+        if (writer_stats(&links[l], links[l].frames) < 0)
+            printf("link stats journal failed\n");
+    if (!mg.aborted && assembler_finish(&mg.as) < 0)
+        printf("storage finish failed\n");
+    if (assembler_drain(&mg.as) < 0)
+        printf("storage drain failed\n");
+    for (l = 0; l < nlinks; l++)
+        writer_done(&links[l]);
+    return NULL;
+}
+
+/* Rates of one link since the last status line */
+static void status_rates(rx_ctx *rx, unsigned int elapsed_ms) {
+    unsigned long frames = __atomic_load_n(&rx->frames, __ATOMIC_RELAXED);
+    unsigned long long bytes = __atomic_load_n(&rx->bytes, __ATOMIC_RELAXED);
+
+    if (elapsed_ms > 0) {
+        rx->status_fps = (frames - rx->status_frames) * 1000.0 / elapsed_ms;
+        rx->status_mbps = (bytes - rx->status_bytes) / 1e3 / elapsed_ms;
+    }
+    rx->status_frames = frames;
+    rx->status_bytes = bytes;
+}
 
-    /* Run device with arguments to force device selection */
-    if (argc > 1)
-        devname = argv[1];
+/*
+ * Status line, redrawn by the log thread: rates since the last one, image
+ * progress, CRC errors. With several links the rates and errors are totals
+ * and the image progress is given per link, or once for the merged tree.
+ */
+static void status_line(void *arg, char *buf, size_t size, unsigned int elapsed_ms) {
+    rx_ctx *rx;
+    unsigned long frames = 0, crc_errs = 0, images;
+    double fps = 0, mbps = 0;
+    int stats = 0, i, image;
+    size_t expect, len;
+    char crc[32];
+
+    (void) arg;                         //every link is in links[]
+    for (i = 0; i < nlinks; i++) {
+        rx = &links[i];
+        status_rates(rx, elapsed_ms);
+        frames += rx->status_frames;
+        fps += rx->status_fps;
+        mbps += rx->status_mbps;
+        crc_errs += __atomic_load_n(&rx->crc_errs, __ATOMIC_RELAXED);
+        stats |= rx->stats.enabled;
+    }
+
+    if (stats)
+        snprintf(crc, sizeof (crc), "%lu", crc_errs);
     else
-        devname = "/dev/ttyUSB0";
+        snprintf(crc, sizeof (crc), "-");
+    len = snprintf(buf, size, "%lu frames  %.0f frames/s  %.2f MB/s ", frames, fps, mbps);
+    for (i = 0; i < (mg.enabled ? 1 : nlinks) && len < size; i++) {
+        rx = &links[i];
+        image = __atomic_load_n(&rx->out->totalFileSize, __ATOMIC_RELAXED);
+        images = __atomic_load_n(&rx->out->store.images, __ATOMIC_RELAXED);
+        expect = __atomic_load_n(&rx->out->image_bytes, __ATOMIC_RELAXED);
+        if (nlinks == 1 || mg.enabled)
+            len += snprintf(buf + len, size - len, " image %lu: %.1f/%.1f MB (%.0f%%)",
+                    images + 1, image / 1e6, expect / 1e6, expect ? 100.0 * image / expect : 0.0);
+        else
+            len += snprintf(buf + len, size - len, " %s: image %lu %.0f%%",
+                    rx->name, images + 1, expect ? 100.0 * image / expect : 0.0);
+    }
+    if (len < size)
+        snprintf(buf + len, size - len, "  CRC %s", crc);
+}
 
-/*********************************************************************************                           
-*                              SYNCLINK INITIALIZATION
-*********************************************************************************/   
-   
-    printf("receive HDLC data on device: %s\n", devname);
-
-    /* open serial device with O_NONBLOCK to ignore DCD input */
-    fd = open(devname, O_RDWR | O_NONBLOCK, 0);
-    if (fd < 0) {
-        printf("open error=%d %s\n", errno, strerror(errno));
-        return errno;
-    } else printf("%s port opened\n", devname);
-    
-    /* Timing */
-    gettimeofday(&runtime_begin, NULL);
+static void usage(char *prog) {
+    printf("usage: %s [-HmnS] [-D ms] [-E depth[:n]] [-F bytes] [-I ms] [-M max_frame] [-T ms] [-j journal] [-o data_dir] [-r ring_slots] [-R cpu[:prio]] [-s ms|Nf] [-v logfile] [-w backend] [-x speed] [source...]\n", prog);
+    printf("    -D ms          after Ctrl-C, keep receiving up to ms to finish the image in progress,\n");
+    printf("                   0 = stop at once (default %d)\n", DRAIN_DEFAULT_MS);
+    printf("    -I ms          settle an image or entry missing its terminator after the link is idle\n");
+    printf("                   this long, 0 = never (default %d)\n", IDLE_DEFAULT_MS);
+    printf("    -F bytes       flush image data every N bytes, 0 = every frame (default %d)\n", FLUSH_DEFAULT_BYTES);
+    printf("    -E depth[:n]   every frame is sent as CCSDS Reed-Solomon (255,223) codeblocks interleaved\n");
+    printf("                   depth deep (1-%d; CCSDS uses 1-5 or 8), decoded by n threads per source\n", RS_DEPTH_MAX);
+    printf("                   (default %d); a frame that decodes is stored even if it failed the link CRC\n", FEC_WORKERS_DEFAULT);
+    printf("    -H             every frame starts with a framing header (type, image, sequence number,\n");
+    printf("                   byte offset): lost frames are counted and leave holes in the image;\n");
+    printf("                   a CRC-32C trailer, when the header flags one, is checked on every frame\n");
+    printf("    -M max_frame   longest frame received whole, up to %d (default %d)\n", HDLC_MAX_FRAME_SIZE, FRAME_DEFAULT_MAX);
+    printf("    -T ms          flush buffered data older than T ms, 0 = never (default %d)\n", FLUSH_DEFAULT_MS);
+    printf("    -S             fdatasync each image and catalog update on completion\n");
+    printf("    -j journal     append every received frame to a capture journal\n");
+    printf("                   (journal-link<N>.ext per source when there are several)\n");
+    printf("    -m             the %d sources are redundant receivers of one downlink: store each frame\n", MERGE_LINKS);
+    printf("                   once, from the copy that passed its CRC check, into data_dir\n");
+    printf("    -n             do not launch MOSES_TV\n");
+    printf("    -o data_dir    output directory (default %s), data_dir/link<N> per source\n", TM_DATA_DIR);
+    printf("                   when there are several\n");
+    printf("    -r ring_slots  frames buffered between reader and writer (default %d)\n", RING_DEFAULT_SLOTS);
+    printf("    -R cpu[:prio]  real-time: reader pinned to cpu (or auto) at SCHED_FIFO prio (default %d),\n", RT_DEFAULT_PRIO);
+    printf("                   memory locked and pre-faulted; the readers of several sources\n");
+    printf("                   take consecutive cpus\n");
+    printf("    -s ms|Nf       sample link statistics every ms, or every N frames (e.g. 64f)\n");
+    printf("                   (default %d ms)\n", LINKSTATS_DEFAULT_MS);
+    printf("    -v logfile     write every message and a line per received frame to logfile\n");
+    printf("    -w backend     image and catalog storage: stdio (default) | uring | direct | mmap\n");
+    printf("    -x speed       journal replay rate: 1 original timing, n times faster,\n");
+    printf("                   0 as fast as possible (default)\n");
+    printf("    source         /dev/ttyUSBn | synclink:dev | pty: | fifo:path | udp:[addr:]port | file:path\n");
+    printf("                   (default /dev/ttyUSB0); each source given is received concurrently\n");
+}
 
-    /*
-     * set N_HDLC line discipline
-     *
-     * A line discipline is a software layer between a tty device driver
-     * and user application that performs intermediate processing,
-     * formatting, and buffering of data.
-     */
-    rc = ioctl(fd, TIOCSETD, &ldisc);
-    if (rc < 0) {
-        printf("set line discipline error=%d %s\n",
-                errno, strerror(errno));
-        return rc;
+/* Output directory and journal of one of several links: data_dir/link<N>, journal-link<N>.ext */
+static int link_paths(rx_ctx *rx, const rx_config *cfg) {
+    char dir[TM_PATH_LEN];
+    const char *ext;
+
+    if (nlinks == 1) {
+        snprintf(rx->data_dir, sizeof (rx->data_dir), "%s", cfg->data_dir);
+        if (cfg->journal_path != NULL)
+            snprintf(rx->journal_path, sizeof (rx->journal_path), "%s", cfg->journal_path);
+        return 0;
     }
 
-    /* get current device parameters */
-    rc = ioctl(fd, MGSL_IOCGPARAMS, &params);
-    if (rc < 0) {
-        printf("ioctl(MGSL_IOCGPARAMS) error=%d %s\n",
-                errno, strerror(errno));
-        return rc;
+    /* merged links share data_dir, but each keeps its own journal */
+    if (mg.enabled) {
+        snprintf(rx->data_dir, sizeof (rx->data_dir), "%s", cfg->data_dir);
+    } else {
+        if (snprintf(rx->data_dir, sizeof (rx->data_dir), "%s/%s", cfg->data_dir, rx->name) >=
+                (int) sizeof (rx->data_dir) ||
+                snprintf(dir, sizeof (dir), "%s/xml_archive", rx->data_dir) >= (int) sizeof (dir)) {
+            printf("output directory too long: %s\n", cfg->data_dir);
+            return -1;
+        }
+        if ((mkdir(rx->data_dir, 0755) < 0 && errno != EEXIST) || (mkdir(dir, 0755) < 0 && errno != EEXIST)) {
+            printf("mkdir %s error=%d %s\n", dir, errno, strerror(errno));
+            return -1;
+        }
     }
+    if (cfg->journal_path != NULL) {
+        ext = strrchr(cfg->journal_path, '.');
+        if (ext == NULL || strchr(ext, '/') != NULL)
+            ext = cfg->journal_path + strlen(cfg->journal_path);
+        snprintf(rx->journal_path, sizeof (rx->journal_path), "%.*s-%s%s",
+                (int) (ext - cfg->journal_path), cfg->journal_path, rx->name, ext);
+    }
+    return 0;
+}
 
-    /*
-     * modify device parameters
-     *
-     * HDLC/SDLC mode, loopback disabled, NRZ encoding
-     * Data clocks sourced from clock input pins
-     * Output 9600bps clock on auxclk output
-     * Hardware generation/checking of CCITT (ITU) CRC 16
-     */
-    params.mode            = MGSL_MODE_HDLC;
-    params.loopback        = 0;
-    params.flags           = HDLC_FLAG_RXC_RXCPIN + HDLC_FLAG_TXC_TXCPIN;
-    params.encoding        = HDLC_ENCODING_NRZ;
-    params.clock_speed     = HDLC_FLAG_TXC_BRG;
-    params.crc_type        = HDLC_CRC_16_CCITT;
-    params.preamble        = HDLC_PREAMBLE_PATTERN_ONES;
-    params.preamble_length = HDLC_PREAMBLE_LENGTH_16BITS;
-
-    /* set current device parameters */
-    rc = ioctl(fd, MGSL_IOCSPARAMS, &params);
-    if (rc < 0) {
-        printf("ioctl(MGSL_IOCSPARAMS) error=%d %s\n",
-                errno, strerror(errno));
-        return rc;
+/* Everything one link needs before any data can arrive; its threads are started by main() */
+static int link_open(rx_ctx *rx, const char *devname, const rx_config *cfg) {
+    tm_recovery recovery;
+
+    snprintf(rx->name, sizeof (rx->name), "link%d", rx->id + 1);
+    rx->devname = devname;
+    rx->rt = cfg->rt;
+    rx->rt.cpu += rx->id;
+    rx->max_frame = cfg->max_frame;
+    rx->drain_ms = cfg->drain_ms;
+    rx->idle_ms = cfg->idle_ms;
+    rx->framed = cfg->framed;
+    rx->fec_depth = cfg->fec.depth;
+    if (link_paths(rx, cfg) < 0)
+        return -1;
+    if (nlinks > 1)
+        printf("%s: %s -> %s\n", rx->name, devname, rx->data_dir);
+
+    if (source_open(&rx->src, devname) < 0)
+        return -1;
+    source_set_speed(&rx->src, cfg->speed);
+
+    /* Timing */
+    gettimeofday(&rx->runtime_begin, NULL);
+
+    /* merged links are assembled by the merger, see merged_open() */
+    if (mg.enabled) {
+        rx->out = &mg.as;
+    } else {
+        rx->out = &rx->as;
+
+        /* What a receiver that died mid-image left behind, before the image buffer is reopened */
+        if (recover_image(&recovery, rx->data_dir, cfg->journal_path != NULL ? rx->journal_path : NULL,
+                cfg->framed, cfg->fec.depth, store_pads(cfg->backend)) < 0)
+            return -1;
+
+        /* Prepare image buffer and xml catalog */
+        if (assembler_open(&rx->as, rx->data_dir, cfg->backend, &cfg->policy, 0) < 0)     //'0' if expecting ROE first; '1' if expecting XML first
+            return -1;
+        rx->as.framed = cfg->framed;
+        if (recovery.action == RECOVER_RESUME) {
+            if (assembler_resume(&rx->as, recovery.path, recovery.mapped ? &recovery.received : NULL) < 0) {
+                recover_free(&recovery);
+                return -1;
+            }
+            rx->resumed = rx->as.totalFileSize;
+        }
+        recover_free(&recovery);
     }
 
-    printf("Turn on RTS and DTR serial outputs\n");
-    sigs = TIOCM_RTS | TIOCM_DTR;
-    rc = ioctl(fd, TIOCMBIC, &sigs);
-    if (rc < 0) {
-        printf("assert DTR/RTS error=%d %s\n", errno, strerror(errno));
-        return rc;
+    /* Open the capture journal before any data can arrive */
+    if (cfg->journal_path != NULL) {
+        if (journal_open(&rx->journal, rx->journal_path, devname) < 0)
+            return -1;
+        rx->journaling = 1;
     }
 
-    /* set device to blocking mode for reads and writes */
-    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) + ~O_NONBLOCK);
+    /* Preallocate the frame buffers before any data can arrive, with a byte to spot longer frames */
+    if (ring_init(&rx->ring, cfg->ring_slots, cfg->max_frame + 1) < 0)
+        return -1;
+    if (rx->fec_depth > 0 && fec_open(&rx->fec, &rx->ring, &cfg->fec, cfg->framed, nlinks > 1 ? rx->name : NULL) < 0)
+        return -1;
 
-    signal(SIGINT, sigint_handler);
-    siginterrupt(SIGINT, 1);
+    /* Baseline link counters before any data can arrive */
+    if (linkstats_init(&rx->stats, &rx->src, &rx->read, cfg->stats_ms, cfg->stats_every) < 0)
+        return -1;
 
-    /*enable receiver*/
-    int enable = 2;
-    rc = ioctl(fd, MGSL_IOCRXENABLE, enable);
-    
-    /*crc check setup*/
-    rc = ioctl(fd, MGSL_IOCGSTATS, &icount);
-    __u32 crctemp = icount.rxcrc;
-    
-    /* Prepare image buffer/file pointer */
-    fp = openFile(image_path);
-    
-    /*check if xml exists & archive*/
-    struct stat st;
-    if ((int)stat(current_xml, &st) == 0) {
-        
-        time(&current_time);
-        ts = *localtime(&current_time);
-        strftime(timestamp, sizeof(timestamp), "%y%m%d%H%M%S", &ts);
-        
-        sprintf(archive_file, "/media/moses/Data/TM_data/xml_archive/imageindex_%s%s", timestamp, ".xml");
-        rename(current_xml, archive_file);
-        xmlCount = 1;
-        
+    /* The reader's event loop: source, signals, and the link statistics timer */
+    if (events_open(&rx->ev, rx->src.poll_fd) < 0)
+        return -1;
+    if (rx->stats.enabled && rx->stats.period_ms > 0 &&
+            events_timer(&rx->ev, rx->stats.period_ms, linkstats_tick, &rx->stats) < 0)
+        return -1;
+    if (rx->idle_ms > 0 && events_timer(&rx->ev, (rx->idle_ms + 1) / 2, reader_idle, rx) < 0)
+        return -1;
+    return 0;
+}
+
+/* What the assembler had to settle without the terminators it expected */
+static void assembler_summary(const tm_assembler *as, unsigned long idle_marks) {
+    if (as->partial_bytes > 0)
+        printf("partial images: %d bytes kept as partial_*.roe\n", as->partial_bytes);
+    if (as->xml_dropped > 0)
+        printf("incomplete catalog entries: %d bytes dropped\n", as->xml_dropped);
+    if (as->lost_image_terms + as->lost_xml_terms + as->idle_finished > 0)
+        printf("image boundaries: %lu image and %lu catalog terminators lost, %lu settled after %lu idle spells\n",
+                as->lost_image_terms, as->lost_xml_terms, as->idle_finished, idle_marks);
+    if (as->lost_entries > 0)
+        printf("catalog entries: %lu lost, their images saved without one\n", as->lost_entries);
+    if (as->framed)
+        framing_report(&as->framing);
+    if (as->digests + as->digests_lost > 0)
+        printf("image digests: %lu images with a SHA-256 in <image>%s, %lu of them also in the catalog, %lu without (data out of order)\n",
+                as->digests, DIGEST_EXT, as->digests - as->digests_unlisted - as->digest_ready, as->digests_lost);
+}
+
+/* End of pass report of one link */
+static void link_summary(rx_ctx *rx) {
+    if (nlinks > 1)
+        printf("\n%s: %s -> %s\n", rx->name, rx->devname, rx->data_dir);
+    printf("frame ring: %u slots of %zu bytes, high water %u, %lu full stalls\n",
+            rx->ring.nslots, rx->max_frame, rx->ring.high_water, rx->ring.full_stalls);
+    if (rx->truncated > 0 || rx->overflows > 0)
+        printf("oversize frames: %lu truncated, %lu discarded by the driver (max frame %zu bytes)\n",
+                rx->truncated, rx->overflows, rx->max_frame);
+    if (rx->frames > 0 && rx->done_ns > rx->first_ns) {
+        double secs = (double) (rx->done_ns - rx->first_ns) / 1e9;
+        printf("stored %lu frames, %.1f MB in %.2f s (%.0f frames/s, %.1f Mbps)\n",
+                rx->frames, rx->bytes / 1e6, secs, rx->frames / secs, rx->bytes * 8 / secs / 1e6);
     }
-    
-    /* Prepare xml buffer/file pointer */
-    outxml = openFile(current_xml);
-    /* Write XML declaration/header */
-    fprintf(outxml, "<?xml version=\"1.0\" encoding=\"ASCII\" standalone=\"yes\"?>\n");
-    fprintf(outxml, "<CATALOG>\n\n");
-    fprintf(outxml, "</CATALOG>\n");
-    fflush(outxml);
-    /*place cursor right before '/catalog' tag*/
-    if (fseek(outxml, (-11), SEEK_END) < 0) {
-        printf("file seek error=%d %s\n", errno, strerror(errno));
+    if (rx->drain_ns != 0)
+        printf("shutdown: %lu frames received after the stop request, %s\n",
+                rx->read - rx->drain_frames, rx->drain_end != NULL ? rx->drain_end : "stopped");
+    if (rx->crc_frames > 0)
+        printf("CRC errors: %lu frames failed their CRC check, %s\n", rx->crc_frames,
+                rx->fec_depth > 0 ? "stored if FEC corrected them" :
+                mg.enabled ? "replaced from the other link where it had them" : "journaled but not stored");
+    if (rx->crc32c_frames > 0)
+        printf("CRC-32C: %lu frames checked, %lu failed\n", rx->crc32c_frames, rx->crc32c_failed);
+    if (rx->fec_depth > 0)
+        fec_report(&rx->fec);
+    if (rx->out == &rx->as)
+        assembler_summary(&rx->as, rx->idle_marks);
+    rt_latency_report(&rx->latency);
+    printf("event loop: %lu waits for %lu frames\n", rx->ev.waits, rx->read);
+    if (rx->stats.enabled) {
+        printf("link stats: %lu samples for %lu frames (%.3f per frame)\n",
+                rx->stats.ioctls, rx->read, rx->read ? (double) rx->stats.ioctls / rx->read : 0.0);
+        linkstats_report("pass link", &rx->link_pass);
+    }
+}
+
+/* Combined throughput of several links, from the first frame on any of them to the last writer done */
+static void links_summary(void) {
+    unsigned long frames = 0;
+    unsigned long long bytes = 0;
+    __u64 first = 0, done = 0;
+    double secs;
+    int i;
+
+    for (i = 0; i < nlinks; i++) {
+        if (links[i].frames == 0)
+            continue;
+        frames += links[i].frames;
+        bytes += links[i].bytes;
+        if (first == 0 || links[i].first_ns < first)
+            first = links[i].first_ns;
+        if (links[i].done_ns > done)
+            done = links[i].done_ns;
+    }
+    if (frames == 0 || done <= first)
         return;
+    secs = (double) (done - first) / 1e9;
+    printf("\nall %d links: stored %lu frames, %.1f MB in %.2f s (%.0f frames/s, %.1f Mbps)\n",
+            nlinks, frames, bytes / 1e6, secs, frames / secs, bytes * 8 / secs / 1e6);
+}
+
+static void link_close(rx_ctx *rx) {
+    source_close(&rx->src);
+    if (rx->journaling)
+        journal_close(&rx->journal);
+    if (rx->out == &rx->as)
+        assembler_close(&rx->as);
+    if (rx->fec_depth > 0)
+        fec_free(&rx->fec);
+    ring_free(&rx->ring);
+    linkstats_free(&rx->stats);
+    events_close(&rx->ev);
+}
+
+/*
+ * The merged tree of redundant links (-m), once both links are open. Only
+ * the image buffer is recovered: neither link's journal alone says what the
+ * merged image held.
+ */
+static int merged_open(const rx_config *cfg) {
+    frame_ring *rings[MERGE_LINKS];
+    tm_recovery recovery;
+    int l;
+
+    if (recover_image(&recovery, cfg->data_dir, NULL, cfg->framed, cfg->fec.depth, store_pads(cfg->backend)) < 0)
+        return -1;
+    if (assembler_open(&mg.as, cfg->data_dir, cfg->backend, &cfg->policy, 0) < 0)
+        return -1;
+    mg.as.framed = cfg->framed;
+    if (recovery.action == RECOVER_RESUME && assembler_resume(&mg.as, recovery.path, NULL) < 0)
+        return -1;
+    for (l = 0; l < MERGE_LINKS; l++) {
+        links[l].resumed = mg.as.totalFileSize;
+        rings[l] = &links[l].ring;
     }
-    fflush(outxml);
+    mg.idle_ms = cfg->idle_ms;
+    merge_init(&mg.m, rings);
+    mg.m.drop_bad = cfg->framed;        //the header places every other frame
+    return 0;
+}
+
+/* Merger report and the merged tree's */
+static void merged_summary(void) {
+    unsigned long idle_marks = 0;
+    int l;
+
+    for (l = 0; l < nlinks; l++)
+        idle_marks += links[l].idle_marks;
+    printf("\nmerged -> %s\n", links[0].data_dir);
+    merge_report(&mg.m);
+    assembler_summary(&mg.as, idle_marks);
+}
+
+int main(int argc, char* argv[]) {
+/*********************************************************************************                           
+*                                    VARIABLES
+*********************************************************************************/   
+    rx_config cfg;
+    pid_t MTV_child;
+    int opt, i, busy;
+    int launch_mtv     = 1;
+    char *verbose_path = NULL;
+    char *default_dev  = "/dev/ttyUSB0";
+    char **devnames;
+    struct timespec deadline;
+    unsigned long unstored;
+    char *end;
+    sigset_t sigmask;
+
+    memset(&cfg, 0, sizeof (cfg));
+    cfg.data_dir    = TM_DATA_DIR;
+    cfg.backend     = "stdio";
+    cfg.policy.flush_bytes = FLUSH_DEFAULT_BYTES;
+    cfg.policy.flush_ms    = FLUSH_DEFAULT_MS;
+    cfg.ring_slots  = RING_DEFAULT_SLOTS;
+    cfg.max_frame   = FRAME_DEFAULT_MAX;
+    cfg.stats_ms    = LINKSTATS_DEFAULT_MS;
+    cfg.drain_ms    = DRAIN_DEFAULT_MS;
+    cfg.idle_ms     = IDLE_DEFAULT_MS;
+
+    while ((opt = getopt(argc, argv, "D:E:F:HI:M:R:ST:j:mno:r:s:v:w:x:h")) != -1) {
+        switch (opt) {
+            case 'D':
+                cfg.drain_ms = (unsigned int) strtoul(optarg, NULL, 0);
+                break;
+            case 'E':
+                if (fec_parse(&cfg.fec, optarg) < 0)
+                    return 1;
+                break;
+            case 'I':
+                cfg.idle_ms = (unsigned int) strtoul(optarg, NULL, 0);
+                break;
+            case 'H':
+                cfg.framed = 1;
+                break;
+            case 'F':
+                cfg.policy.flush_bytes = strtoul(optarg, NULL, 0);
+                break;
+            case 'M':
+                cfg.max_frame = strtoul(optarg, NULL, 0);
+                if (cfg.max_frame <= TERM_IMAGE_LEN || cfg.max_frame > HDLC_MAX_FRAME_SIZE) {
+                    printf("max frame must be %d to %d bytes\n", TERM_IMAGE_LEN + 1, HDLC_MAX_FRAME_SIZE);
+                    return 1;
+                }
+                break;
+            case 'R':
+                if (rt_parse(&cfg.rt, optarg) < 0)
+                    return 1;
+                break;
+            case 'S':
+                cfg.policy.sync_image = 1;
+                break;
+            case 'T':
+                cfg.policy.flush_ms = (unsigned int) strtoul(optarg, NULL, 0);
+                break;
+            case 'j':
+                cfg.journal_path = optarg;
+                break;
+            case 'm':
+                mg.enabled = 1;
+                break;
+            case 'n':
+                launch_mtv = 0;
+                break;
+            case 'o':
+                cfg.data_dir = optarg;
+                break;
+            case 'r':
+                cfg.ring_slots = (unsigned int) strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                cfg.stats_ms = (unsigned int) strtoul(optarg, &end, 0);
+                if (*end == 'f') {
+                    cfg.stats_every = cfg.stats_ms;
+                    cfg.stats_ms = 0;
+                }
+                break;
+            case 'v':
+                verbose_path = optarg;
+                break;
+            case 'w':
+                cfg.backend = optarg;
+                break;
+            case 'x':
+                cfg.speed = atof(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    /* Run device with arguments to force device selection; each one is a link of its own */
+    if (optind < argc) {
+        devnames = argv + optind;
+        nlinks = argc - optind;
+    } else {
+        devnames = &default_dev;
+        nlinks = 1;
+    }
+    if (mg.enabled && nlinks != MERGE_LINKS) {
+        printf("-m merges %d sources, %d given\n", MERGE_LINKS, nlinks);
+        return 1;
+    }
+    links = calloc(nlinks, sizeof (rx_ctx));
+    if (links == NULL) {
+        printf("link alloc error=%d %s\n", errno, strerror(errno));
+        return 1;
+    }
+
+    /* Keep every other thread off the readers' cores, before any is created */
+    cfg.rt.readers = nlinks;
+    if (rt_setup(&cfg.rt) < 0)
+        return 1;
+
+/*********************************************************************************                           
+*                              FRAME SOURCE INITIALIZATION
+*********************************************************************************/   
+
+    if (log_open(verbose_path) < 0)
+        return 1;
+
+    /* CRC-32C and SHA-256 kernels, before a recovered image is read back */
+    if (cfg.framed)
+        printf("CRC-32C: %s\n", crc32c_init());
+    printf("image digests: SHA-256 (%s)\n", sha256_setup());
+    if (cfg.fec.depth > 0)
+        printf("FEC: RS(255,223) depth %d, %d decoder threads per source (%s)\n",
+                cfg.fec.depth, cfg.fec.workers, rs_init());
+
+    for (i = 0; i < nlinks; i++) {
+        links[i].id = i;
+        if (link_open(&links[i], devnames[i], &cfg) < 0)
+            return errno ? errno : 1;
+    }
+    if (mg.enabled && merged_open(&cfg) < 0)
+        return 1;
+
+    /*
+     * SIGINT and SIGTERM are taken by the readers' signalfds from here on;
+     * every thread created later inherits the mask. Not before the sources
+     * are open: a FIFO waits in open() for its writer, and Ctrl-C has to
+     * stop that.
+     */
+    sigemptyset(&sigmask);
+    sigaddset(&sigmask, SIGINT);
+    sigaddset(&sigmask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sigmask, NULL);
+
+    /* Every buffer exists now: lock and pre-fault them */
+    rt_lock_memory(&cfg.rt);
     
     /*Fork process to startup MOSES_TV*/
-    MTV_child = fork();
+    MTV_child = launch_mtv ? fork() : 1;
     if (MTV_child < 0) {
         /* fork error */
         printf("fork error=%d %s\n", errno, strerror(errno));
-        return;
+        return 1;
     }
     else if (MTV_child == 0) {          
+        pthread_sigmask(SIG_UNBLOCK, &sigmask, NULL);   //the mask would pass through exec to MOSES_TV
         system("sudo gnome-terminal -x mtv_egse &");
     }
     else {
-        system("clear");
+        if (launch_mtv)
+            system("clear");
         printf("**************************************************\n");
         printf("*                    receiveTM                   *\n");
         printf("**************************************************\n\n");
@@ -253,156 +1332,58 @@ int main(int argc, char* argv[]) {
         /*********************************************************************************                           
         *                              MAIN TELEMETRY LOOP
         *********************************************************************************/   
-        for (;;) {
-            /* check crc */
-            rc = ioctl(fd, MGSL_IOCGSTATS, &icount);
-            if (crctemp != icount.rxcrc) {
-                printf("    CRC Failed!\n");
+        if (log_start(status_line, NULL) < 0)
+            return 1;
+        for (i = 0; i < nlinks; i++) {
+            if (links[i].fec_depth > 0 && fec_start(&links[i].fec) < 0)
+                return 1;
+            if (pthread_create(&links[i].reader, NULL, reader_main, &links[i]) != 0 ||
+                    (!mg.enabled && pthread_create(&links[i].writer, NULL, writer_main, &links[i]) != 0)) {
+                printf("pthread_create error=%d %s\n", errno, strerror(errno));
+                return 1;
             }
-            crctemp = icount.rxcrc;
-
-            /* wait for and receive data from serial device */
-            memset(buf, 0, BUFSIZ);
-            rc = read(fd, buf, size);
+        }
+        if (mg.enabled && pthread_create(&mg.thread, NULL, merger_main, NULL) != 0) {
+            printf("pthread_create error=%d %s\n", errno, strerror(errno));
+            return 1;
+        }
 
-            /* Check received packet size for expected values */
-            if (rc < 0) {
-                /* read error */
-                if (errno == 4) {
-                    printf("\nreceiveTM interrupted\n");
-                    break;
-                }
-                else {
-                    printf("read error=%d %s\n", errno, strerror(errno));
-                    break;
-                }
-            } else if (rc == 0) {
-                /* Incorrect synclink settings - set NONBLOCK mode */
-                gettimeofday(&runtime_end, NULL);
-                runtime_elapsed = 1000000 * ((long) (runtime_end.tv_sec) - (long) (runtime_begin.tv_sec)) + (long) (runtime_end.tv_usec) - (long) (runtime_begin.tv_usec);
-                printf("program ran for %-3.2f seconds before failing\n", (float) runtime_elapsed / (float) 1000000);
-                printf("read returned with no data - set NONBLOCK mode to continue\n");
-                break;
-            } else if (rc == 16) {
-                /* Terminating characters for image */
-                printf("received %d bytes       %d       [ TERM ]\n", rc, index);
-                printf("%d total bytes received for file: %s\n", totalFileSize, buf);
-                printf("creating new image buffer\n");
-
-                /* Flush the stream, save the image, free up the buffer*/
-                fflush(fp);
-                fclose(fp);
-                sprintf(archive_file, "/media/moses/Data/TM_data/%s", buf);
-                rename(image_path, archive_file);
-
-                fp = openFile(image_path);
-
-                xml_check = 1; // next image will be an xml
-                totalFileSize = 0;
-                index = 0;
-            } else if (rc == 14) {
-                /* Terminating characters for xml */
-                printf("received %d bytes       %d       [ TERM ]\n", rc, index);
-                printf("%d total bytes received for updating xml\n", totalFileSize);
-
-                /* Include footer in xml */
-                fprintf(outxml, "</CATALOG>\n");
-
-                fflush(outxml);
-                fclose(outxml);
-                xml_check = 0; //next packet will be an image
-                totalFileSize = 0;
-                index = 0;
-            } else {
-                /* data packet */
-                if (xml_check == 1) {
-                    /* check if the first few characters look like an xml */
-                    strncpy(xml_header, buf, (strlen("<ROEIMAGE>")));
-                    int cmp = strncmp(xml_header, "<ROEIMAGE>", 10 * sizeof (char));
-                    if (cmp == 0) {
-                        /* header matches xml format */
-                        printf("xml_header = %s\n", xml_header);
-                        printf("packet is an xml \n");
-
-                        /*if not the first, archive current xml*/
-                        if (xmlCount > 0) {
-                            time(&current_time);
-                            ts = *localtime(&current_time);
-                            strftime(timestamp, sizeof (timestamp), "%y%m%d%H%M%S", &ts);
-
-                            sprintf(archive_file, "/media/moses/Data/TM_data/xml_archive/imageindex_%s%s", timestamp, ".xml");
-                            rename(current_xml, archive_file);
-
-                            outxml = openFile(current_xml);
-
-                            /* Write XML declaration/header */
-                            fprintf(outxml, "<?xml version=\"1.0\" encoding=\"ASCII\" standalone=\"yes\"?>\n");
-                            fprintf(outxml, "<CATALOG>\n\n");
-                            fprintf(outxml, "</CATALOG>\n");
-                            fflush(outxml);
-                            
-                            /*place cursor right before '/catalog' tag*/
-                            if (fseek(outxml, (-11), SEEK_END) < 0) {
-                                printf("file seek error=%d %s\n", errno, strerror(errno));
-                                return;
-                            }
-                            fflush(outxml);
-                            
-                        }
-
-                        xmlCount = 1;
-                        xml_check = 2; //start saving xml data
-                    } else xml_check = 0; // mistake: this file is not xml
+        for (i = 0; i < nlinks; i++)
+            pthread_join(links[i].reader, NULL);
 
-                }
-                if (xml_check == 2) { //start saving xml data
-                    printf("received %d bytes       %d       [ XML ]\n", rc, index);
-                    
-                    /* write new received xml to disk */
-                    count = fwrite(buf, sizeof (char), rc, outxml);
-                    if (count != rc) {
-                        printf("fwrite error=%d %s\n", errno, strerror(errno));
-                        break;
-                    }
-                    if (fflush(fp) != 0) {
-                        printf("fflush error=%d %s\n", errno, strerror(errno));
-                        return errno;
-                    }
-
-                    fprintf(outxml, "\n");
-                    totalFileSize += count;
-                    index++;
-                } else {
-                    /* image packet */
-                    /* save received data to image file */
-                    printf("received %d bytes       %d\n", rc, index);
-                    count = fwrite(buf, sizeof (char), rc, fp);
-                    if (count != rc) {
-                        printf("fwrite error=%d %s\n", errno, strerror(errno));
-                        break;
-                    }
-                    if (fflush(fp) != 0) {
-                        printf("fflush error=%d %s\n", errno, strerror(errno));
-                        return errno;
-                    }
-
-                    totalFileSize += count;
-                    index++;
-                }
+        /* the writers only have their rings left to store; a hung disk must not hold up the exit */
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += WRITER_DEADLINE_MS / 1000;
+        busy = 0;
+        unstored = 0;
+        for (i = 0; i < nlinks; i++) {
+            if (mg.enabled ? (i == 0 ? pthread_timedjoin_np(mg.thread, NULL, &deadline) != 0 : busy > 0) :
+                    pthread_timedjoin_np(links[i].writer, NULL, &deadline) != 0) {
+                busy++;
+                unstored += links[i].read - __atomic_load_n(&links[i].frames, __ATOMIC_RELAXED);
             }
         }
-    
-        /* Exit protocol; shouldn't reach here until interrupted with Ctrl-C*/
-        printf("Turn off RTS and DTR serial outputs\n");
-        sigs = TIOCM_RTS + TIOCM_DTR;
-        rc = ioctl(fd, TIOCMBIC, &sigs);
-        if (rc < 0) {
-            printf("negate DTR/RTS error=%d %s\n", errno, strerror(errno));
-            return rc;
+        for (i = 0; i < nlinks; i++)
+            fec_stop(&links[i].fec);
+        log_stop();
+        if (busy > 0) {
+            printf("storage still busy %d s after the readers stopped: %lu frames not stored, files left as they are\n",
+                    WRITER_DEADLINE_MS / 1000, unstored);
+            return 1;
         }
 
-        close(fd);
-        fclose(fp);
+        /* Exit protocol; shouldn't reach here until interrupted with Ctrl-C*/
+        for (i = 0; i < nlinks; i++) {
+            link_summary(&links[i]);
+            link_close(&links[i]);      //reports the source and storage totals of the link
+        }
+        if (mg.enabled) {
+            merged_summary();
+            assembler_close(&mg.as);
+        }
+        if (nlinks > 1)
+            links_summary();
+        free(links);
     }
     
     /*Child and parent join and return*/
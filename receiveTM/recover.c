@@ -0,0 +1,487 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : recover.c
+ * Header(s)     : recover.h
+ * Description   : Start-up recovery of a leftover image_buf.tmp. The
+ *                 leftover is first moved to image_buf.resume so the storage
+ *                 back-end cannot truncate it; a recovery that crashes in
+ *                 turn finds it there next time.
+ *
+ *                 The journal is read backwards in growing windows, starting
+ *                 with a little more than the leftover itself, until the
+ *                 window holds the XML terminator that started the image.
+ *                 A window starts at the first offset where three records
+ *                 chain; damaged bytes inside it are skipped the way
+ *                 file:<journal> replay does.
+ *
+ *                 Frames with a framing header (-H) are classified by its
+ *                 type and written back at its byte offset, so frames lost
+ *                 from the journal leave holes rather than shift the image.
+ * Function(s)   : int recover_image(tm_recovery*, const char*, const char*, int, int, int)
+ *                                                  - Resume, name or keep the leftover
+ *                 void recover_free(tm_recovery*)
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+
+#include "recover.h"
+#include "assembler.h"
+#include "journal.h"
+#include "synclink.h"
+#include "rs.h"
+
+/* The image the journal tail ends in */
+typedef struct journal_tail {
+    unsigned char *buf;                 //window read from the journal
+    size_t         n;
+    int            start;               //the window holds the start of the image
+    int            ended;               //...and its image terminator
+    char           name[TERM_IMAGE_LEN + 1];
+    size_t         bytes;               //image data journaled, up to the end of the last frame
+    size_t        *off;                 //offset of each image frame payload in buf
+    __u32         *len;
+    size_t        *pos;                 //where it goes in the image
+    size_t         frames;
+    size_t         cap;
+    time_t         mtime;               //of the journal
+    int            framed;              //frames carry a framing header
+    int            fec;                 //...and are Reed-Solomon coded at this depth
+    unsigned char *code;                //a record decoded, before it replaces the coded one
+    size_t         code_cap;
+} journal_tail;
+
+static unsigned long long now_ms(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int rec_at(const journal_tail *t, size_t off, journal_rec_hdr *rec) {
+    if (off + sizeof (*rec) > t->n)
+        return 0;
+    memcpy(rec, t->buf + off, sizeof (*rec));
+    return rec->sync == JOURNAL_REC_SYNC && rec->len <= HDLC_MAX_FRAME_SIZE;
+}
+
+/* A record boundary: a header followed by two more, or by the end of the window */
+static int rec_chain(const journal_tail *t, size_t off) {
+    journal_rec_hdr rec;
+    int i;
+
+    for (i = 0; i < 3 && off < t->n; i++) {
+        if (!rec_at(t, off, &rec))
+            return 0;
+        off += sizeof (rec) + JOURNAL_REC_ALIGN(rec.len);
+        if (off > t->n)
+            return i > 0;               //torn last record
+    }
+    return 1;
+}
+
+static int tail_frame(journal_tail *t, size_t off, __u32 len, size_t pos) {
+    size_t cap = t->cap ? t->cap * 2 : 4096;
+    size_t *o, *p;
+    __u32 *l;
+
+    if (t->frames == t->cap) {
+        o = realloc(t->off, cap * sizeof (*o));
+        l = realloc(t->len, cap * sizeof (*l));
+        p = realloc(t->pos, cap * sizeof (*p));
+        if (o != NULL)
+            t->off = o;
+        if (l != NULL)
+            t->len = l;
+        if (p != NULL)
+            t->pos = p;
+        if (o == NULL || l == NULL || p == NULL) {
+            printf("recovery alloc error=%d %s\n", errno, strerror(errno));
+            return -1;
+        }
+        t->cap = cap;
+    }
+    t->off[t->frames] = off;
+    t->len[t->frames] = len;
+    t->pos[t->frames] = pos;
+    t->frames++;
+    if (pos + len > t->bytes)
+        t->bytes = pos + len;
+    return 0;
+}
+
+/*
+ * What a journaled frame is, by its framing header when frames carry one,
+ * else by length; -1 for a framed record without a valid header. Image data
+ * also gets its payload and position.
+ */
+static int tail_kind(const journal_tail *t, size_t off, __u32 len, size_t *data, __u32 *data_len, size_t *pos) {
+    frame_hdr h;
+    int payload;
+
+    *data = off;
+    *data_len = len;
+    *pos = t->bytes;
+    if (!t->framed)
+        return len == TERM_XML_LEN ? FRAMING_TERM_XML : len == TERM_IMAGE_LEN ? FRAMING_TERM_IMAGE : FRAMING_DATA;
+    payload = framing_parse(&h, t->buf + off, len);
+    if (payload < 0)
+        return -1;
+    *data = off + FRAMING_HDR_LEN;
+    *data_len = payload;
+    *pos = h.offset;
+    return h.type;
+}
+
+/*
+ * Decode a coded record in place in the window; its length once decoded, or
+ * -1 if it is not stored. The writer stores a frame that failed the link CRC
+ * if it decodes, and the CRC-32C of a framed one is only good after decoding.
+ */
+static int tail_decode(journal_tail *t, size_t off, const journal_rec_hdr *rec) {
+    unsigned char *code;
+    rs_stats st;
+    int len;
+
+    if (rec->flags & JOURNAL_REC_TRUNC)
+        return -1;
+    if (t->code_cap < rec->len) {
+        code = realloc(t->code, rec->len);
+        if (code == NULL) {
+            printf("recovery alloc error=%d %s\n", errno, strerror(errno));
+            return -1;
+        }
+        t->code = code;
+        t->code_cap = rec->len;
+    }
+    memset(&st, 0, sizeof (st));
+    len = rs_decode(t->buf + off, rec->len, t->code, t->fec, &st);
+    if (len < 0)
+        return -1;
+    memcpy(t->buf + off, t->code, len);
+    if (t->framed && framing_check(t->buf + off, len) < 0)
+        return -1;
+    return len;
+}
+
+/* Follow the records of the window; at_hdr if it starts right after the file header */
+static int tail_parse(journal_tail *t, int at_hdr) {
+    journal_rec_hdr rec;
+    size_t off = 0;
+    size_t data, pos;
+    __u32 data_len;
+    int len;
+
+    while (off < t->n && !rec_chain(t, off))
+        off += 4;
+
+    /* the first image of a journal has no XML terminator before it */
+    t->start = at_hdr;
+    t->ended = 0;
+    t->bytes = 0;
+    t->frames = 0;
+    while (off + sizeof (rec) <= t->n) {
+        if (!rec_at(t, off, &rec)) {
+            off += 4;                   //damaged: resync
+            continue;
+        }
+        if (off + sizeof (rec) + rec.len > t->n)
+            break;                      //torn by the crash
+
+        /* the frame the writer stored, if it stored one: len -1 otherwise */
+        len = -1;
+        if (rec.flags & JOURNAL_REC_CLOSE) {
+            t->start = 1;               //clean exit: nothing in progress
+            t->ended = 0;
+            t->bytes = 0;
+            t->frames = 0;
+        } else if (rec.flags & JOURNAL_REC_STATS) {
+            /* a statistics sample, not a frame */
+        } else if (t->fec > 0) {
+            len = tail_decode(t, off + sizeof (rec), &rec);
+        } else if (!(rec.flags & JOURNAL_REC_CRC)) {
+            len = rec.len;              //the writer drops CRC errors too
+        }
+
+        if (len >= 0) {
+            switch (tail_kind(t, off + sizeof (rec), len, &data, &data_len, &pos)) {
+                case FRAMING_TERM_XML:
+                    t->start = 1;
+                    t->ended = 0;
+                    t->bytes = 0;
+                    t->frames = 0;
+                    break;
+                case FRAMING_TERM_IMAGE:
+                    t->ended = 1;
+                    snprintf(t->name, sizeof (t->name), "%.*s", (int) data_len, t->buf + data);
+                    break;
+                case FRAMING_DATA:
+                    if (t->start && !t->ended && tail_frame(t, data, data_len, pos) < 0)
+                        return -1;
+                    break;
+            }
+        }
+        off += sizeof (rec) + JOURNAL_REC_ALIGN(rec.len);
+    }
+    return 0;
+}
+
+/* Read windows off the end of the journal until one holds the start of the last image */
+static int tail_scan(journal_tail *t, const char *path, size_t leftover) {
+    journal_file_hdr hdr;
+    struct stat st;
+    size_t want = leftover + leftover / 16 + (1 << 20);
+    off_t from;
+    ssize_t rc;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;                      //no journal yet
+    if (fstat(fd, &st) < 0 || pread(fd, &hdr, sizeof (hdr), 0) != sizeof (hdr) ||
+            memcmp(hdr.magic, JOURNAL_MAGIC, sizeof (hdr.magic)) != 0 || hdr.hdr_size > st.st_size) {
+        printf("recovery: %s is not a capture journal\n", path);
+        close(fd);
+        return -1;
+    }
+    t->mtime = st.st_mtime;
+
+    for (;;) {
+        from = st.st_size - hdr.hdr_size > (off_t) want ? st.st_size - (off_t) want : (off_t) hdr.hdr_size;
+        free(t->buf);
+        t->n = st.st_size - from;
+        t->buf = malloc(t->n + 1);
+        if (t->buf == NULL) {
+            printf("recovery alloc error=%d %s\n", errno, strerror(errno));
+            break;
+        }
+        rc = pread(fd, t->buf, t->n, from);
+        if (rc < 0) {
+            printf("recovery read error=%d %s\n", errno, strerror(errno));
+            break;
+        }
+        t->n = rc;
+        if (tail_parse(t, from == (off_t) hdr.hdr_size) < 0)
+            break;
+        if (t->start || from == (off_t) hdr.hdr_size || want >= RECOVER_SCAN_MAX) {
+            close(fd);
+            return 0;
+        }
+        want *= 2;
+    }
+    close(fd);
+    return -1;
+}
+
+/* Write the image data the journal holds past the first 'have' bytes, each frame at its position */
+static int tail_append(const journal_tail *t, const char *path, size_t have) {
+    size_t skip;
+    size_t i;
+    int fd;
+
+    fd = open(path, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        printf("recovery open error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    for (i = 0; i < t->frames; i++) {
+        skip = have > t->pos[i] ? have - t->pos[i] : 0;
+        if (skip >= t->len[i])
+            continue;
+        if (pwrite(fd, t->buf + t->off[i] + skip, t->len[i] - skip, t->pos[i] + skip) !=
+                (ssize_t) (t->len[i] - skip)) {
+            printf("recovery write error=%d %s\n", errno, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+    close(fd);
+    return 0;
+}
+
+/*
+ * The leftover can end in zeros that are not image data: it carries the tag
+ * of a back-end that preallocates or pads it, or the filesystem keeps no
+ * xattrs and this pass's back-end is one of those (pads).
+ */
+static int leftover_padded(int fd, int pads) {
+    if (fgetxattr(fd, STORE_PADDED_XATTR, NULL, 0) >= 0)
+        return 1;
+    return errno == ENOTSUP && pads;
+}
+
+/*
+ * Bytes of image data in a padded leftover: trailing zeros are taken for
+ * space the back-end had not reached; raw CCD data does not end in a run of
+ * zero pixels. Any other leftover ends where its data does.
+ */
+static size_t leftover_data(int fd, size_t size) {
+    unsigned char buf[65536];
+    size_t chunk;
+    size_t i;
+
+    while (size > 0) {
+        chunk = size < sizeof (buf) ? size : sizeof (buf);
+        if (pread(fd, buf, chunk, size - chunk) != (ssize_t) chunk)
+            return size;
+        for (i = chunk; i > 0; i--)
+            if (buf[i - 1] != 0)
+                return size - chunk + i;
+        size -= chunk;
+    }
+    return 0;
+}
+
+/* Move the leftover to 'name' in data_dir, unless something is there already */
+static int keep_as(tm_recovery *rec, const char *from, const char *data_dir, const char *name) {
+    struct stat st;
+
+    snprintf(rec->path, sizeof (rec->path), "%s/%s", data_dir, name);
+    if (stat(rec->path, &st) == 0 || rename(from, rec->path) < 0) {
+        printf("recovery: cannot rename %s to %s\n", from, rec->path);
+        return -1;
+    }
+    return 0;
+}
+
+int recover_image(tm_recovery *rec, const char *data_dir, const char *journal_path, int framed, int fec, int pads) {
+    char tmp[TM_PATH_LEN];
+    char res[TM_PATH_LEN];
+    char name[TM_PATH_LEN];
+    unsigned long long begin = now_ms();
+    journal_tail t;
+    struct stat st;
+    size_t have = 0;
+    size_t i;
+    time_t mtime = 0;
+    char *p;
+    int fd;
+
+    memset(rec, 0, sizeof (*rec));
+    memset(&t, 0, sizeof (t));
+    t.framed = framed;
+    t.fec = fec;
+    snprintf(tmp, sizeof (tmp), "%s/image_buf.tmp", data_dir);
+    snprintf(res, sizeof (res), "%s/image_buf.resume", data_dir);
+
+    /* a recovery cut short leaves its file under the resume name */
+    if ((stat(res, &st) == 0 && st.st_size > 0) ||
+            (stat(tmp, &st) == 0 && st.st_size > 0 && rename(tmp, res) == 0)) {
+        fd = open(res, O_RDWR);
+        if (fd < 0) {
+            printf("recovery open error=%d %s\n", errno, strerror(errno));
+            return -1;
+        }
+        have = leftover_padded(fd, pads) ? leftover_data(fd, st.st_size) : (size_t) st.st_size;
+        if (have < (size_t) st.st_size && ftruncate(fd, have) < 0)
+            printf("recovery truncate error=%d %s\n", errno, strerror(errno));
+        close(fd);
+        mtime = st.st_mtime;
+        printf("recovery: %zu bytes left in image_buf.tmp\n", have);
+    } else if (journal_path == NULL) {
+        return 0;
+    }
+    rec->bytes = have;
+
+    if (journal_path != NULL && tail_scan(&t, journal_path, have) == 0 && t.start) {
+        /* only the journal knows of an image whose data never reached the file */
+        if (have == 0) {
+            if (t.bytes == 0 || time(NULL) - t.mtime > RECOVER_RESUME_S)
+                goto done;
+            printf("recovery: journal ends inside an image\n");
+            mtime = t.mtime;
+        }
+
+        /* the journal only lags the file by what it had not written yet */
+        if (t.bytes > have) {
+            if (tail_append(&t, res, have) < 0)
+                goto fail;
+            rec->from_journal = t.bytes - have;
+            rec->bytes = t.bytes;
+        }
+        if (t.ended && t.bytes >= have && t.name[0] != 0) {
+            for (p = t.name; *p != 0; p++)
+                if (*p == '/')
+                    *p = '_';
+            if (keep_as(rec, res, data_dir, t.name) < 0)
+                goto fail;
+            rec->action = RECOVER_NAMED;
+        }
+        if (!t.ended && time(NULL) - mtime <= RECOVER_RESUME_S)
+            rec->action = RECOVER_RESUME;
+
+        /* framed frames sit at their offsets: the journal says which bytes are in, unless the file is ahead of it */
+        if (rec->action == RECOVER_RESUME && framed && t.bytes >= have) {
+            for (i = 0; i < t.frames; i++)
+                if (image_map_add(&rec->received, t.pos[i], t.len[i]) < 0)
+                    goto fail;
+            rec->mapped = 1;
+        }
+    } else if (have == 0) {
+        goto done;
+    } else if (time(NULL) - mtime <= RECOVER_RESUME_S) {
+        rec->action = RECOVER_RESUME;
+    }
+    if (rec->action == RECOVER_RESUME)
+        snprintf(rec->path, sizeof (rec->path), "%s", res);
+
+    /* not the image in progress, or too old to be: keep it aside */
+    if (rec->action == RECOVER_NONE) {
+        strcpy(name, "recovered_");
+        name_timestamp(name + strlen(name), sizeof (name) - strlen(name));
+        strcat(name, ".roe");
+        if (keep_as(rec, res, data_dir, name) < 0)
+            goto fail;
+        rec->action = RECOVER_SALVAGE;
+    }
+    rec->ms = now_ms() - begin;
+
+    switch (rec->action) {
+        case RECOVER_RESUME:
+            printf("recovery: resuming the image at %zu bytes (%zu from the journal) in %u ms\n",
+                    rec->bytes, rec->from_journal, rec->ms);
+            break;
+        case RECOVER_NAMED:
+            printf("recovery: image complete in the journal, %zu bytes (%zu from the journal) saved as %s in %u ms\n",
+                    rec->bytes, rec->from_journal, rec->path, rec->ms);
+            break;
+        default:
+            printf("recovery: not the image in progress, %zu bytes kept as %s in %u ms\n",
+                    rec->bytes, rec->path, rec->ms);
+            break;
+    }
+
+done:
+    free(t.buf);
+    free(t.off);
+    free(t.len);
+    free(t.pos);
+    free(t.code);
+    return 0;
+
+fail:
+    image_map_free(&rec->received);
+    free(t.buf);
+    free(t.off);
+    free(t.len);
+    free(t.pos);
+    free(t.code);
+    return -1;
+}
+
+void recover_free(tm_recovery *rec) {
+    image_map_free(&rec->received);
+}
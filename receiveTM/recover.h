@@ -0,0 +1,67 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : recover.h
+ * Source(s)     : recover.c
+ * Description   : Start-up recovery of an image_buf.tmp left by a receiver
+ *                 that died mid-image. It runs before the storage back-end
+ *                 opens (and truncates) image_buf.tmp.
+ *
+ *                 The tail of the capture journal, if there is one, is
+ *                 scanned back to the last terminator to learn what the
+ *                 leftover is:
+ *                     image in progress  - the frames the journal holds past
+ *                                          the end of the file are appended
+ *                                          and reception resumes the image
+ *                     image terminated   - completed from the journal and
+ *                                          renamed to the terminator's name
+ *                     anything else      - kept as recovered_<time>.roe
+ *                 With no journal a recent leftover is resumed and an old
+ *                 one is kept. Trailing zeros are only trimmed from a
+ *                 leftover the back-end padded (STORE_PADDED_XATTR). A
+ *                 framed image is resumed with the byte ranges its
+ *                 journaled frames cover; without them its holes are
+ *                 unknown. Only the tail of the journal is read, so a
+ *                 restart during a pass costs milliseconds. framed says the
+ *                 journaled frames carry a framing header (-H), fec that
+ *                 they are Reed-Solomon coded at that depth (-E), and are
+ *                 decoded as they are read back; pads that this pass's
+ *                 back-end pads image_buf.tmp, for a filesystem without
+ *                 xattrs.
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef RECOVER_H
+#define RECOVER_H
+
+#include <stddef.h>
+
+#include "storage.h"
+#include "imagemap.h"
+
+#define RECOVER_RESUME_S 120            //a leftover this recent is resumed without a journal to confirm it
+#define RECOVER_SCAN_MAX (256 << 20)    //journal tail read looking for the last terminator
+
+#define RECOVER_NONE    0
+#define RECOVER_RESUME  1               //path is appended to the image being received
+#define RECOVER_NAMED   2               //path is the finished image
+#define RECOVER_SALVAGE 3               //path is the kept leftover
+
+typedef struct tm_recovery {
+    int          action;
+    char         path[TM_PATH_LEN];
+    size_t       bytes;                 //image bytes in path
+    size_t       from_journal;          //of those, appended from the capture journal
+    image_map    received;              //framed (-H) image bytes the journal holds...
+    int          mapped;                //...if it says which were received
+    unsigned int ms;                    //time the recovery took
+} tm_recovery;
+
+int  recover_image(tm_recovery *rec, const char *data_dir, const char *journal_path, int framed, int fec, int pads);
+void recover_free(tm_recovery *rec);
+
+#endif /* RECOVER_H */
@@ -0,0 +1,338 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : ring.c
+ * Header(s)     : ring.h
+ * Description   : SPSC frame ring shared by the reader and writer threads.
+ *                 head is only written by the producer and tail only by the
+ *                 consumer; each side publishes its index with a release store
+ *                 and the other side picks it up with an acquire load. When a
+ *                 side has to wait it raises its *_waiting flag and sleeps on
+ *                 the other side's index with FUTEX_WAIT, so the fast path is
+ *                 free of syscalls and locks.
+ *
+ *                 With a stage, the consumer's side of the ring ends at
+ *                 ready rather than head. Stage threads take slots from
+ *                 claim with a compare-and-swap, mark each one done with its
+ *                 index, and whichever finds the slot at ready done moves
+ *                 ready past it, so slots are handed on in order however the
+ *                 threads finish.
+ * Function(s)   : int ring_init(frame_ring*, unsigned int, size_t)
+ *                 void ring_free(frame_ring*)
+ *                 frame_slot* ring_reserve(frame_ring*)  - producer
+ *                 void ring_publish(frame_ring*)         - producer
+ *                 frame_slot* ring_peek(frame_ring*)     - consumer
+ *                 frame_slot* ring_peek_timed(frame_ring*, unsigned int) - consumer
+ *                 frame_slot* ring_peek_at(frame_ring*, unsigned int)   - consumer
+ *                 int ring_wait(frame_ring*, unsigned int, unsigned int) - consumer
+ *                 void ring_release(frame_ring*)         - consumer
+ *                 void ring_stage(frame_ring*)           - before any thread starts
+ *                 frame_slot* ring_stage_claim(frame_ring*, unsigned int*) - stage
+ *                 void ring_stage_done(frame_ring*, unsigned int)          - stage
+ *                 void ring_close(frame_ring*)           - either side
+ *                 int ring_done(frame_ring*)
+ *                 int ring_closed(frame_ring*)
+ *                 unsigned int ring_fill(frame_ring*)
+ *                 unsigned int ring_staged(frame_ring*)
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "ring.h"
+
+#define RING_SPINS 64
+
+/* bounded sleep so a ring_close() racing with a waiter is noticed promptly */
+static void futex_wait(unsigned int *addr, unsigned int val, unsigned int timeout_ms) {
+    struct timespec timeout = {0, 100000000};
+
+    if (timeout_ms > 0 && timeout_ms < 100)
+        timeout.tv_nsec = timeout_ms * 1000000L;
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, &timeout, NULL, 0);
+}
+
+static unsigned long long now_ms(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void futex_wake(unsigned int *addr, int n) {
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+/* The end of the consumer's side: what the producer published, or what the stage is done with */
+static unsigned int *ring_front(frame_ring *ring) {
+    return ring->staged ? &ring->ready : &ring->head;
+}
+
+/* Allocate nslots (rounded up to a power of two) slots of slot_size bytes */
+int ring_init(frame_ring *ring, unsigned int nslots, size_t slot_size) {
+    unsigned int n = 1;
+    unsigned int i;
+
+    while (n < nslots)
+        n <<= 1;
+
+    memset(ring, 0, sizeof (*ring));
+    ring->nslots    = n;
+    ring->mask      = n - 1;
+    ring->slot_size = slot_size;
+    ring->slots     = calloc(n, sizeof (frame_slot));
+    ring->pool      = malloc((size_t) n * (slot_size + 1));
+    if (ring->slots == NULL || ring->pool == NULL) {
+        printf("ring alloc error=%d %s\n", errno, strerror(errno));
+        ring_free(ring);
+        return -1;
+    }
+
+    /* touch every slot now so the reader never takes a page fault mid-pass */
+    memset(ring->pool, 0, (size_t) n * (slot_size + 1));
+    for (i = 0; i < n; i++)
+        ring->slots[i].data = ring->pool + (size_t) i * (slot_size + 1);
+
+    return 0;
+}
+
+void ring_free(frame_ring *ring) {
+    free(ring->slots);
+    free(ring->pool);
+    ring->slots = NULL;
+    ring->pool  = NULL;
+}
+
+/* Wait for a free slot; returns NULL once the ring has been closed */
+frame_slot * ring_reserve(frame_ring *ring) {
+    unsigned int head = ring->head;
+    unsigned int tail;
+    int spins = 0;
+
+    for (;;) {
+        if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE))
+            return NULL;
+        tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (head - tail < ring->nslots)
+            return &ring->slots[head & ring->mask];
+
+        if (spins++ < RING_SPINS)
+            continue;
+        if (spins == RING_SPINS + 1)
+            ring->full_stalls++;
+
+        /* ring full: storage is behind, sleep until the consumer frees a slot */
+        __atomic_store_n(&ring->prod_waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST) == tail &&
+                !__atomic_load_n(&ring->closed, __ATOMIC_SEQ_CST))
+            futex_wait(&ring->tail, tail, 0);
+    }
+}
+
+/* Hand the reserved slot over to the consumer */
+void ring_publish(frame_ring *ring) {
+    unsigned int head = ring->head + 1;
+    unsigned int fill;
+
+    __atomic_store_n(&ring->head, head, __ATOMIC_SEQ_CST);
+
+    fill = head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (fill > ring->high_water)
+        __atomic_store_n(&ring->high_water, fill, __ATOMIC_RELAXED);
+
+    if (ring->staged) {
+        if (__atomic_load_n(&ring->stage_waiting, __ATOMIC_SEQ_CST)) {
+            __atomic_store_n(&ring->stage_waiting, 0, __ATOMIC_RELAXED);
+            futex_wake(&ring->head, INT_MAX);
+        }
+    } else if (__atomic_load_n(&ring->cons_waiting, __ATOMIC_SEQ_CST)) {
+        __atomic_store_n(&ring->cons_waiting, 0, __ATOMIC_RELAXED);
+        futex_wake(&ring->head, 1);
+    }
+}
+
+/* Wait for the oldest filled slot; returns NULL once closed and drained */
+frame_slot * ring_peek(frame_ring *ring) {
+    return ring_peek_timed(ring, 0);
+}
+
+/* 
+ * As ring_peek(), but also returns NULL after timeout_ms (0 = forever) with
+ * nothing to read, so the consumer can do periodic work on an idle link.
+ * ring_done() tells the two NULL cases apart.
+ */
+frame_slot * ring_peek_timed(frame_ring *ring, unsigned int timeout_ms) {
+    unsigned int *front = ring_front(ring);
+    unsigned int tail = ring->tail;
+    unsigned int head;
+    unsigned long long deadline = 0;
+    int spins = 0;
+
+    for (;;) {
+        head = __atomic_load_n(front, __ATOMIC_ACQUIRE);
+        if (head != tail)
+            return &ring->slots[tail & ring->mask];
+        if (ring_closed(ring))
+            return NULL;
+
+        if (spins++ < RING_SPINS)
+            continue;
+
+        if (timeout_ms > 0) {
+            if (deadline == 0)
+                deadline = now_ms() + timeout_ms;
+            else if (now_ms() >= deadline)
+                return NULL;
+        }
+
+        /* ring empty: wait for the reader to publish a frame */
+        __atomic_store_n(&ring->cons_waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(front, __ATOMIC_SEQ_CST) == head && !ring_closed(ring))
+            futex_wait(front, head, timeout_ms);
+    }
+}
+
+/* The i-th queued frame, 0 being the one ring_peek() returns; NULL if not there yet, never waits */
+frame_slot * ring_peek_at(frame_ring *ring, unsigned int i) {
+    unsigned int head = __atomic_load_n(ring_front(ring), __ATOMIC_ACQUIRE);
+
+    if (head - ring->tail <= i)
+        return NULL;
+    return &ring->slots[(ring->tail + i) & ring->mask];
+}
+
+/*
+ * Wait until more than fill frames are queued, for a consumer that looks
+ * ahead with ring_peek_at(). Returns 1 when they are, 0 on timeout or once
+ * the ring is closed.
+ */
+int ring_wait(frame_ring *ring, unsigned int fill, unsigned int timeout_ms) {
+    unsigned int *front = ring_front(ring);
+    unsigned long long deadline = now_ms() + timeout_ms;
+    unsigned int head;
+
+    for (;;) {
+        head = __atomic_load_n(front, __ATOMIC_ACQUIRE);
+        if (head - ring->tail > fill)
+            return 1;
+        if (ring_closed(ring) || now_ms() >= deadline)
+            return 0;
+        __atomic_store_n(&ring->cons_waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(front, __ATOMIC_SEQ_CST) == head && !ring_closed(ring))
+            futex_wait(front, head, timeout_ms);
+    }
+}
+
+/* Return the slot from ring_peek() to the producer */
+void ring_release(frame_ring *ring) {
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&ring->prod_waiting, __ATOMIC_SEQ_CST)) {
+        __atomic_store_n(&ring->prod_waiting, 0, __ATOMIC_RELAXED);
+        futex_wake(&ring->tail, 1);
+    }
+}
+
+/* Put stage threads between producer and consumer; before either starts */
+void ring_stage(frame_ring *ring) {
+    ring->staged = 1;
+}
+
+/*
+ * Stage thread: the oldest published slot no stage thread has taken yet,
+ * and its ring index for ring_stage_done(). Waits for one; returns NULL once
+ * the ring is closed and every slot has been taken.
+ */
+frame_slot * ring_stage_claim(frame_ring *ring, unsigned int *index) {
+    unsigned int claim, head;
+    int spins = 0;
+
+    for (;;) {
+        claim = __atomic_load_n(&ring->claim, __ATOMIC_ACQUIRE);
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (claim != head) {
+            if (__atomic_compare_exchange_n(&ring->claim, &claim, claim + 1, 0,
+                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                *index = claim;
+                return &ring->slots[claim & ring->mask];
+            }
+            continue;
+        }
+        if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE))
+            return NULL;
+
+        if (spins++ < RING_SPINS)
+            continue;
+
+        /* nothing to take: wait for the reader to publish a frame */
+        __atomic_store_n(&ring->stage_waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) == head &&
+                !__atomic_load_n(&ring->closed, __ATOMIC_SEQ_CST))
+            futex_wait(&ring->head, head, 0);
+    }
+}
+
+/* Stage thread: done with the slot at index; hands it and any done after it to the consumer */
+void ring_stage_done(frame_ring *ring, unsigned int index) {
+    unsigned int ready;
+    int moved = 0;
+
+    __atomic_store_n(&ring->slots[index & ring->mask].staged, index + 1, __ATOMIC_SEQ_CST);
+    for (;;) {
+        ready = __atomic_load_n(&ring->ready, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ring->slots[ready & ring->mask].staged, __ATOMIC_SEQ_CST) != ready + 1)
+            break;
+        if (__atomic_compare_exchange_n(&ring->ready, &ready, ready + 1, 0,
+                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+            moved = 1;
+    }
+
+    if (moved && __atomic_load_n(&ring->cons_waiting, __ATOMIC_SEQ_CST)) {
+        __atomic_store_n(&ring->cons_waiting, 0, __ATOMIC_RELAXED);
+        futex_wake(&ring->ready, 1);
+    }
+}
+
+/* Stop the producer and let the consumer drain what is left */
+void ring_close(frame_ring *ring) {
+    __atomic_store_n(&ring->closed, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&ring->head, INT_MAX);
+    futex_wake(&ring->tail, 1);
+    futex_wake(&ring->ready, 1);
+}
+
+/* Closed by the producer and fully drained */
+int ring_done(frame_ring *ring) {
+    return __atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+
+/* Closed by the producer: no frame beyond those queued will come, nor the stage hand on */
+int ring_closed(frame_ring *ring) {
+    return __atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(ring_front(ring), __ATOMIC_ACQUIRE) == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+}
+
+/* Frames the consumer can take */
+unsigned int ring_fill(frame_ring *ring) {
+    return __atomic_load_n(ring_front(ring), __ATOMIC_ACQUIRE) -
+            __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+
+/* Frames published that the stage has yet to hand on to the consumer, 0 without a stage */
+unsigned int ring_staged(frame_ring *ring) {
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) -
+            __atomic_load_n(ring_front(ring), __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,107 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : ring.h
+ * Source(s)     : ring.c
+ * Description   : Lock-free single-producer/single-consumer ring of
+ *                 preallocated HDLC frame slots. The reader thread fills
+ *                 slots straight from read() and the writer thread drains
+ *                 them to disk, so a storage stall never blocks the Synclink
+ *                 receive path until the whole ring is full.
+ *
+ *                 Only the producer may call ring_reserve()/ring_publish()
+ *                 and only the consumer may call ring_peek()/ring_release()
+ *                 and the look-ahead calls ring_peek_at()/ring_wait().
+ *                 Both sides sleep on a futex when there is nothing to do.
+ *
+ *                 A ring with a stage (ring_stage()) has a pool of stage
+ *                 threads between the two sides, e.g. FEC decoding (fec.c):
+ *                 they take published slots in any order with
+ *                 ring_stage_claim() and hand them back with
+ *                 ring_stage_done(), and the consumer sees them in order,
+ *                 once every slot before them is done too.
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef RING_H
+#define RING_H
+
+#include <stddef.h>
+#include <linux/types.h>
+
+#define RING_DEFAULT_SLOTS 1024         //must be a power of two
+
+#define FRAME_TRUNCATED    0x1          //frame_slot.flags: longer than the configured max frame
+#define FRAME_IDLE         0x2          //no frame: the link has been idle, see the -I timeout
+#define FRAME_CRC_ERROR    0x4          //the frame failed its CRC check
+#define FRAME_RECOVERED    0x8          //...of the link, but FEC corrected it (-E)
+
+/* One received HDLC frame */
+typedef struct frame_slot {
+    int            len;                 //bytes returned by read(), at most the max frame
+    unsigned int   flags;               //FRAME_TRUNCATED, FRAME_IDLE, FRAME_CRC_ERROR, FRAME_RECOVERED
+    unsigned long  num;                 //frame number on the link, from 1
+    __u64          mono_ns;             //CLOCK_MONOTONIC when read() returned
+    __u64          rx_ns;               //CLOCK_MONOTONIC the link received it: mono_ns, or the recorded time of a replayed frame
+    __u64          wall_ns;             //CLOCK_REALTIME when read() returned
+    unsigned char *data;                //slot_size + 1 bytes, NUL terminated at len
+    unsigned char *zc;                  //frame read in place into the image mapping, else NULL
+    unsigned char *raw;                 //the frame as read when a stage replaced data, else NULL
+    int            raw_len;
+    unsigned char *spare;               //the stage's output buffer, traded with data
+    unsigned int   staged;              //ring index + 1 once the stage is done with it
+} frame_slot;
+
+typedef struct frame_ring {
+    frame_slot    *slots;
+    unsigned char *pool;
+    unsigned int   nslots;
+    unsigned int   mask;
+    size_t         slot_size;
+
+    /* producer side, kept on its own cache line */
+    unsigned int   head __attribute__((aligned(64)));
+    unsigned int   high_water;          //largest fill level seen by producer
+    unsigned long  full_stalls;         //times the producer waited for space
+    int            prod_waiting;
+
+    /* consumer side */
+    unsigned int   tail __attribute__((aligned(64)));
+    int            cons_waiting;
+
+    /* stage threads: slots before ready are done, claim is the next to take */
+    unsigned int   ready __attribute__((aligned(64)));
+    unsigned int   claim;
+    int            stage_waiting;
+    int            staged;              //the ring has a stage
+
+    int            closed __attribute__((aligned(64)));
+} frame_ring;
+
+int          ring_init(frame_ring *ring, unsigned int nslots, size_t slot_size);
+void         ring_free(frame_ring *ring);
+
+frame_slot * ring_reserve(frame_ring *ring);
+void         ring_publish(frame_ring *ring);
+
+frame_slot * ring_peek(frame_ring *ring);
+frame_slot * ring_peek_timed(frame_ring *ring, unsigned int timeout_ms);
+frame_slot * ring_peek_at(frame_ring *ring, unsigned int i);
+int          ring_wait(frame_ring *ring, unsigned int fill, unsigned int timeout_ms);
+void         ring_release(frame_ring *ring);
+
+void         ring_stage(frame_ring *ring);
+frame_slot * ring_stage_claim(frame_ring *ring, unsigned int *index);
+void         ring_stage_done(frame_ring *ring, unsigned int index);
+
+void         ring_close(frame_ring *ring);
+int          ring_done(frame_ring *ring);
+int          ring_closed(frame_ring *ring);
+unsigned int ring_fill(frame_ring *ring);
+unsigned int ring_staged(frame_ring *ring);
+
+#endif /* RING_H */
@@ -0,0 +1,332 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : rs.c
+ * Header(s)     : rs.h
+ * Description   : CCSDS Reed-Solomon (255,223) encoder and decoder for
+ *                 interleaved, shortened codeblocks. Shared by receiveTM and
+ *                 tmgen.
+ * Function(s)   : const char* rs_init(void)         - Tables, returns the kernel name
+ *                 int rs_encoded_len(int, int)      - Bytes on the wire for a frame
+ *                 int rs_decoded_len(int, int)      - Frame bytes in a wire frame, or -1
+ *                 int rs_encode(const unsigned char*, int, unsigned char*, int)
+ *                 int rs_decode(const unsigned char*, int, unsigned char*, int, rs_stats*)
+ *                                                   - Frame out of a wire frame, corrected
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+#include "rs.h"
+
+#define RS_POLY 0x187                   //x^8+x^7+x^2+x+1
+#define RS_FCR  112                     //first root alpha^(11 x 112)
+#define RS_PRIM 11
+#define RS_FCR1 ((1 + RS_N - RS_FCR) % RS_N)    //exponent 1 - fcr of an error locator, for Forney
+
+static unsigned char gf_exp[2 * RS_N];  //alpha^i, twice over so a sum of two logs needs no modulo
+static unsigned char gf_log[256];
+static unsigned char tal[256];          //conventional to dual basis
+static unsigned char tal1[256];         //dual to conventional
+
+/* rem_tab[fb] is fb times the generator's coefficients of x^31 .. x^0 */
+static unsigned char rem_tab[256][RS_PARITY] __attribute__((aligned(16)));
+
+static unsigned char gf_mul(unsigned char a, unsigned char b) {
+    if (a == 0 || b == 0)
+        return 0;
+    return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+/* a times alpha^e, e < 255 */
+static unsigned char gf_mul_exp(unsigned char a, int e) {
+    if (a == 0)
+        return 0;
+    return gf_exp[gf_log[a] + e];
+}
+
+/*
+ * The encoder's shift register over n data symbols, stride bytes apart:
+ * rem is the data times x^32 modulo the generator, x^31 first, in the
+ * conventional basis. A whole row of the table is the feedback symbol times
+ * every generator coefficient, so each symbol is one row, a shift and an XOR.
+ */
+#if defined(__x86_64__)
+static const char rs_kernel[] = "sse2";
+
+static void rs_rem(const unsigned char *p, int n, int stride, unsigned char rem[RS_PARITY]) {
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    const __m128i *row;
+    unsigned int fb;
+
+    for (; n > 0; n--, p += stride) {
+        fb = tal1[*p] ^ (_mm_cvtsi128_si32(lo) & 0xff);
+        row = (const __m128i *) rem_tab[fb];
+        lo = _mm_or_si128(_mm_srli_si128(lo, 1), _mm_slli_si128(hi, 15));
+        hi = _mm_srli_si128(hi, 1);
+        lo = _mm_xor_si128(lo, _mm_load_si128(row));
+        hi = _mm_xor_si128(hi, _mm_load_si128(row + 1));
+    }
+    _mm_storeu_si128((__m128i *) rem, lo);
+    _mm_storeu_si128((__m128i *) (rem + 16), hi);
+}
+#else
+static const char rs_kernel[] = "c";
+
+static void rs_rem(const unsigned char *p, int n, int stride, unsigned char rem[RS_PARITY]) {
+    unsigned int fb;
+    int m;
+
+    memset(rem, 0, RS_PARITY);
+    for (; n > 0; n--, p += stride) {
+        fb = tal1[*p] ^ rem[0];
+        memmove(rem, rem + 1, RS_PARITY - 1);
+        rem[RS_PARITY - 1] = 0;
+        for (m = 0; m < RS_PARITY; m++)
+            rem[m] ^= rem_tab[fb][m];
+    }
+}
+#endif
+
+const char *rs_init(void) {
+    static const unsigned char tal_rows[8] = { 0x8d, 0xef, 0xec, 0x86, 0xfa, 0x99, 0xaf, 0x7b };
+    unsigned char g[RS_PARITY + 1];     //generator, g[k] the coefficient of x^k
+    unsigned int x = 1;
+    int i, j, m;
+
+    for (i = 0; i < RS_N; i++) {
+        gf_exp[i] = gf_exp[i + RS_N] = x;
+        gf_log[x] = i;
+        x <<= 1;
+        if (x & 0x100)
+            x ^= RS_POLY;
+    }
+
+    memset(g, 0, sizeof (g));
+    g[0] = 1;
+    for (i = 0; i < RS_PARITY; i++) {
+        x = gf_exp[(RS_PRIM * (RS_FCR + i)) % RS_N];
+        for (j = i + 1; j > 0; j--)
+            g[j] = g[j - 1] ^ gf_mul(g[j], x);
+        g[0] = gf_mul(g[0], x);
+    }
+    for (i = 0; i < 256; i++)
+        for (m = 0; m < RS_PARITY; m++)
+            rem_tab[i][m] = gf_mul(i, g[RS_PARITY - 1 - m]);
+
+    /* CCSDS 131.0-B annex: the dual basis is a fixed linear map of the conventional one */
+    for (i = 0; i < 256; i++) {
+        tal[i] = 0;
+        for (j = 0; j < 8; j++)
+            if (i & (1 << j))
+                tal[i] ^= tal_rows[7 - j];
+        tal1[tal[i]] = i;
+    }
+    return rs_kernel;
+}
+
+/*
+ * Errors in a codeword of n symbols whose first k are data, given the
+ * remainder of the received word: Berlekamp-Massey for the error locator,
+ * Chien search for the positions and Forney for the values. Corrects the
+ * data symbols in o; returns the symbols corrected, or -1 if there are more
+ * than 16 errors (nothing is changed then).
+ */
+static int rs_correct(const unsigned char rem[RS_PARITY], int n, unsigned char *o, int k, int stride) {
+    unsigned char s[RS_PARITY];         //syndromes
+    unsigned char lambda[RS_PARITY + 1], b[RS_PARITY + 1], t[RS_PARITY + 1];
+    unsigned char omega[RS_PARITY];
+    unsigned char val[RS_PARITY / 2];
+    int loc[RS_PARITY / 2];
+    unsigned char d, bd = 1, coef, sum, num, den;
+    int i, j, e, l = 0, shift = 1, found = 0;
+    int xi;
+
+    /* the received word and its remainder agree at the generator's roots */
+    for (i = 0; i < RS_PARITY; i++) {
+        e = (RS_PRIM * (RS_FCR + i)) % RS_N;
+        for (sum = 0, j = 0; j < RS_PARITY; j++)
+            sum = gf_mul_exp(sum, e) ^ rem[j];
+        s[i] = sum;
+    }
+
+    memset(lambda, 0, sizeof (lambda));
+    memset(b, 0, sizeof (b));
+    lambda[0] = b[0] = 1;
+    for (i = 0; i < RS_PARITY; i++) {
+        d = s[i];
+        for (j = 1; j <= l; j++)
+            d ^= gf_mul(lambda[j], s[i - j]);
+        if (d == 0) {
+            shift++;
+            continue;
+        }
+        memcpy(t, lambda, sizeof (t));
+        coef = gf_exp[gf_log[d] + RS_N - gf_log[bd]];
+        for (j = 0; j + shift <= RS_PARITY; j++)
+            lambda[j + shift] ^= gf_mul(coef, b[j]);
+        if (2 * l <= i) {
+            l = i + 1 - l;
+            memcpy(b, t, sizeof (b));
+            bd = d;
+            shift = 1;
+        } else {
+            shift++;
+        }
+    }
+    if (l > RS_PARITY / 2)
+        return -1;
+
+    for (i = 0; i < RS_PARITY; i++)
+        for (omega[i] = 0, j = 0; j <= i && j <= l; j++)
+            omega[i] ^= gf_mul(lambda[j], s[i - j]);
+
+    /* an error at x^e has locator beta^e, beta = alpha^11 */
+    for (e = 0; e < n && found <= l; e++) {
+        xi = (RS_N - (RS_PRIM * e) % RS_N) % RS_N;     //log of its inverse
+        for (sum = 1, j = 1; j <= l; j++)
+            sum ^= gf_mul_exp(lambda[j], (xi * j) % RS_N);
+        if (sum != 0)
+            continue;
+        if (found == l)
+            return -1;
+        for (num = 0, j = 0; j < RS_PARITY; j++)
+            num ^= gf_mul_exp(omega[j], (xi * j) % RS_N);
+        for (den = 0, j = 1; j <= l; j += 2)
+            den ^= gf_mul_exp(lambda[j], (xi * (j - 1)) % RS_N);
+        if (den == 0)
+            return -1;
+        num = gf_mul_exp(num, (RS_PRIM * e % RS_N) * RS_FCR1 % RS_N);
+        loc[found] = n - 1 - e;
+        val[found] = num == 0 ? 0 : gf_exp[gf_log[num] + RS_N - gf_log[den]];
+        found++;
+    }
+    if (found != l)
+        return -1;
+
+    for (i = 0; i < found; i++)
+        if (loc[i] < k)
+            o[loc[i] * stride] = tal[tal1[o[loc[i] * stride]] ^ val[i]];
+    return found;
+}
+
+/* One codeword: k data symbols at p, its check symbols at q; corrections go to o. 0 clean, errors, or -1 */
+static int rs_codeword(const unsigned char *p, int k, const unsigned char *q, unsigned char *o, int stride) {
+    unsigned char rem[RS_PARITY];
+    unsigned char bad = 0;
+    int i;
+
+    rs_rem(p, k, stride, rem);
+    for (i = 0; i < RS_PARITY; i++) {
+        rem[i] ^= tal1[q[i * stride]];
+        bad |= rem[i];
+    }
+    if (bad == 0)
+        return 0;
+    return rs_correct(rem, k + RS_PARITY, o, k, stride);
+}
+
+/* A frame of len bytes as codeblocks of depth codewords */
+int rs_encoded_len(int len, int depth) {
+    int blk = depth * RS_K;
+
+    if (len <= 0)
+        return 0;
+    return len + (len + blk - 1) / blk * RS_PARITY * depth;
+}
+
+/* The frame a wire frame of this length holds, -1 if no frame is coded to it */
+int rs_decoded_len(int wire, int depth) {
+    int blk = depth * RS_N;
+    int nb;
+
+    if (wire <= 0)
+        return -1;
+    nb = (wire + blk - 1) / blk;
+    if (wire - (nb - 1) * blk <= RS_PARITY * depth)
+        return -1;
+    return wire - nb * RS_PARITY * depth;
+}
+
+/* Encode a frame; out holds rs_encoded_len() bytes, which are returned */
+int rs_encode(const unsigned char *in, int len, unsigned char *out, int depth) {
+    unsigned char rem[RS_PARITY];
+    int d, v, k, c, i, first, n;
+    int ib = 0, ob = 0;
+
+    while (ib < len) {
+        d = len - ib < depth * RS_K ? len - ib : depth * RS_K;
+        memcpy(out + ob, in + ib, d);
+
+        /* codeword c holds bytes c, c + depth, ... of the block after v bytes of virtual fill */
+        v = (depth - d % depth) % depth;
+        k = (d + v) / depth;
+        for (c = 0; c < depth; c++) {
+            first = c - v;
+            n = k;
+            if (first < 0) {
+                first += depth;
+                n--;
+            }
+            rs_rem(in + ib + first, n, depth, rem);
+            for (i = 0; i < RS_PARITY; i++)
+                out[ob + d + i * depth + c] = tal[rem[i]];
+        }
+        ib += d;
+        ob += d + RS_PARITY * depth;
+    }
+    return ob;
+}
+
+/*
+ * Decode a wire frame into out, which may not overlap it; returns the frame
+ * length, or -1 if a codeword had more errors than it can correct or the
+ * length is not that of a coded frame. Every codeword is counted in st. A
+ * frame of a valid length is written out either way, its uncorrectable
+ * codewords as they were received.
+ */
+int rs_decode(const unsigned char *in, int wire, unsigned char *out, int depth, rs_stats *st) {
+    int len = rs_decoded_len(wire, depth);
+    int d, v, k, c, first, n, rc;
+    int ib = 0, ob = 0;
+
+    if (len < 0)
+        return -1;
+    while (ib < wire) {
+        d = wire - ib < depth * RS_N ? wire - ib - RS_PARITY * depth : depth * RS_K;
+        memcpy(out + ob, in + ib, d);
+
+        v = (depth - d % depth) % depth;
+        k = (d + v) / depth;
+        for (c = 0; c < depth; c++) {
+            first = c - v;
+            n = k;
+            if (first < 0) {
+                first += depth;
+                n--;
+            }
+            rc = rs_codeword(in + ib + first, n, in + ib + d + c, out + ob + first, depth);
+            st->codewords++;
+            if (rc != 0)
+                st->bad++;
+            if (rc < 0) {
+                st->failed++;
+                len = -1;
+            } else {
+                st->symbols += rc;
+            }
+        }
+        ib += d + RS_PARITY * depth;
+        ob += d;
+    }
+    return len;
+}
@@ -0,0 +1,53 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : rs.h
+ * Source(s)     : rs.c
+ * Description   : The CCSDS Reed-Solomon (255,223) code (CCSDS 131.0-B):
+ *                 GF(2^8) over x^8+x^7+x^2+x+1, generator roots
+ *                 alpha^(11 j), j = 112..143, symbols in the dual
+ *                 (Berlekamp) basis on the wire. Each codeword corrects up
+ *                 to 16 symbol errors.
+ *
+ *                 A frame is sent as codeblocks of depth I codewords
+ *                 interleaved symbol by symbol: I x 223 data bytes, unchanged
+ *                 and in order, then the I x 32 check bytes. The last
+ *                 codeblock is shortened to what is left of the frame, with
+ *                 virtual fill at its start. A burst of up to 16 x I bytes is
+ *                 spread over the I codewords and corrected.
+ *
+ *                 rs_init() builds the tables and must run before any
+ *                 thread codes. A clean codeword costs one 32-byte table row
+ *                 and a shift per symbol (the encoder's remainder, compared
+ *                 to the check bytes received); the Berlekamp-Massey decoder
+ *                 only runs on a codeword that has errors. See tmgen -b.
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef RS_H
+#define RS_H
+
+#define RS_N         255                //codeword symbols
+#define RS_K         223                //...of which data
+#define RS_PARITY    (RS_N - RS_K)      //check symbols, corrects half as many errors
+#define RS_DEPTH_MAX 8                  //interleaving depth I: CCSDS uses 1-5 and 8
+
+/* Decoder totals, added to by rs_decode() */
+typedef struct rs_stats {
+    unsigned long  codewords;
+    unsigned long  bad;                 //codewords with errors...
+    unsigned long  symbols;             //...symbols corrected in them
+    unsigned long  failed;              //...codewords beyond 16 errors
+} rs_stats;
+
+const char *rs_init(void);
+int rs_encoded_len(int len, int depth);
+int rs_decoded_len(int wire, int depth);
+int rs_encode(const unsigned char *in, int len, unsigned char *out, int depth);
+int rs_decode(const unsigned char *in, int wire, unsigned char *out, int depth, rs_stats *st);
+
+#endif /* RS_H */
@@ -0,0 +1,187 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : rt.c
+ * Header(s)     : rt.h
+ * Description   : CPU placement, SCHED_FIFO, memory locking and the
+ *                 scheduling latency histogram of the real-time ingest mode.
+ *                 A step that is refused (no CAP_SYS_NICE, RLIMIT_MEMLOCK)
+ *                 is reported and reception goes ahead without it: there is
+ *                 only one chance at the data of a pass.
+ * Function(s)   : int rt_parse(rt_config*, const char*) - "auto" or "cpu[:prio]"
+ *                 int rt_setup(rt_config*)         - Keep this thread and its children off the reader cores
+ *                 int rt_lock_memory(rt_config*)   - mlockall once the buffers exist
+ *                 int rt_reader(rt_config*)        - Pin and raise the calling (reader) thread
+ *                 void rt_latency_add(rt_latency*, __u64, unsigned long)
+ *                 void rt_latency_report(const rt_latency*)
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE                     //CPU_SET, pthread_setaffinity_np
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "rt.h"
+
+/* First core listed in /sys/devices/system/cpu/isolated (isolcpus=), or -1 */
+static int isolated_cpu(void) {
+    FILE *fp = fopen("/sys/devices/system/cpu/isolated", "r");
+    int cpu = -1;
+
+    if (fp == NULL)
+        return -1;
+    if (fscanf(fp, "%d", &cpu) != 1)
+        cpu = -1;
+    fclose(fp);
+    return cpu;
+}
+
+int rt_parse(rt_config *rt, const char *arg) {
+    char *end;
+
+    rt->enabled = 1;
+    rt->prio = RT_DEFAULT_PRIO;
+    rt->readers = 1;
+    if (strncmp(arg, "auto", 4) == 0) {
+        rt->auto_cpu = 1;
+        rt->cpu = isolated_cpu();
+        if (rt->cpu < 0)
+            rt->cpu = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+        end = (char *) arg + 4;
+    } else {
+        rt->cpu = (int) strtol(arg, &end, 0);
+    }
+    if (*end == ':')
+        rt->prio = (int) strtol(end + 1, &end, 0);
+    if (*end != 0 || rt->cpu < 0 || rt->prio < sched_get_priority_min(SCHED_FIFO) ||
+            rt->prio > sched_get_priority_max(SCHED_FIFO)) {
+        printf("real-time: bad -R argument %s, expected auto or cpu[:prio]\n", arg);
+        return -1;
+    }
+    return 0;
+}
+
+/* Called from main() before any thread is created; they all inherit the mask */
+int rt_setup(rt_config *rt) {
+    cpu_set_t set;
+    int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int i;
+
+    if (!rt->enabled)
+        return 0;
+    if (rt->readers < 1)
+        rt->readers = 1;
+    /* auto: the last cores, so there is room for every reader */
+    if (rt->auto_cpu && rt->cpu + rt->readers > cpus && cpus > rt->readers)
+        rt->cpu = cpus - rt->readers;
+    if (rt->readers == 1)
+        printf("real-time: reader on cpu %d (%s), SCHED_FIFO priority %d\n", rt->cpu,
+                rt->cpu == isolated_cpu() ? "isolated" : "not isolated", rt->prio);
+    else
+        printf("real-time: %d readers on cpus %d-%d, SCHED_FIFO priority %d\n", rt->readers,
+                rt->cpu, rt->cpu + rt->readers - 1, rt->prio);
+    if (rt->cpu + rt->readers > cpus) {
+        printf("real-time: cpu %d is not online (%d cpus)\n", rt->cpu + rt->readers - 1, cpus);
+        return -1;
+    }
+    if (cpus == rt->readers) {
+        printf("real-time: only %d cpu%s, the readers share them\n", cpus, cpus > 1 ? "s" : "");
+        return 0;
+    }
+
+    CPU_ZERO(&set);
+    for (i = 0; i < cpus; i++)
+        if (i < rt->cpu || i >= rt->cpu + rt->readers)
+            CPU_SET(i, &set);
+    if (sched_setaffinity(0, sizeof (set), &set) < 0) {
+        printf("real-time: sched_setaffinity error=%d %s\n", errno, strerror(errno));
+        return 0;
+    }
+    return 0;
+}
+
+/* Lock everything allocated so far and whatever is mapped later (thread stacks, image mappings) */
+int rt_lock_memory(rt_config *rt) {
+    if (!rt->enabled)
+        return 0;
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        printf("real-time: mlockall error=%d %s, memory is not locked\n", errno, strerror(errno));
+        return 0;
+    }
+    printf("real-time: memory locked\n");
+    return 0;
+}
+
+/* Called by the reader thread itself */
+int rt_reader(rt_config *rt) {
+    volatile unsigned char stack[RT_STACK_PREFAULT];
+    struct sched_param param;
+    cpu_set_t set;
+    int rc;
+
+    if (!rt->enabled)
+        return 0;
+
+    CPU_ZERO(&set);
+    CPU_SET(rt->cpu, &set);
+    rc = pthread_setaffinity_np(pthread_self(), sizeof (set), &set);
+    if (rc != 0)
+        printf("real-time: pin to cpu %d error=%d %s\n", rt->cpu, rc, strerror(rc));
+
+    memset(&param, 0, sizeof (param));
+    param.sched_priority = rt->prio;
+    rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (rc != 0)
+        printf("real-time: SCHED_FIFO error=%d %s\n", rc, strerror(rc));
+
+    /* fault in the stack the read path will use */
+    memset((unsigned char *) stack, 0, sizeof (stack));
+    return 0;
+}
+
+void rt_latency_add(rt_latency *lat, __u64 ns, unsigned long frame) {
+    __u64 us = ns / 1000;
+    int b = 0;
+
+    while (b < RT_HIST - 1 && us >= (1ull << b))
+        b++;
+    lat->hist[b]++;
+    lat->n++;
+    lat->sum_ns += ns;
+    if (ns > lat->max_ns) {
+        lat->max_ns = ns;
+        lat->max_frame = frame;
+    }
+}
+
+void rt_latency_report(const rt_latency *lat) {
+    unsigned long below = 0;
+    int b;
+
+    if (lat->n == 0)
+        return;
+    printf("read latency: %lu frames, mean %.1f us, max %.1f us (frame %lu)\n",
+            lat->n, lat->sum_ns / 1e3 / lat->n, lat->max_ns / 1e3, lat->max_frame);
+    for (b = 0; b < RT_HIST; b++) {
+        if (lat->hist[b] == 0)
+            continue;
+        below += lat->hist[b];
+        if (b < RT_HIST - 1)
+            printf("    < %6llu us %10lu  %6.2f%%\n", 1ull << b, lat->hist[b], 100.0 * below / lat->n);
+        else
+            printf("   >= %6llu us %10lu  %6.2f%%\n", 1ull << (b - 1), lat->hist[b], 100.0 * below / lat->n);
+    }
+}
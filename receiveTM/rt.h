@@ -0,0 +1,56 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : rt.h
+ * Source(s)     : rt.c
+ * Description   : Real-time ingest mode (-R). The reader thread is pinned to
+ *                 one core and raised to SCHED_FIFO; every other thread is
+ *                 kept off that core; all memory is locked and pre-faulted
+ *                 once the buffers are allocated so a page fault can never
+ *                 delay a read().
+ *
+ *                 Scheduling latency is measured per frame as the time from
+ *                 the frame becoming available (the kernel receive timestamp
+ *                 of a datagram, or the due time of a paced journal record)
+ *                 to read() returning it to the reader, and reported as a
+ *                 histogram with the worst case.
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef RT_H
+#define RT_H
+
+#include <linux/types.h>
+
+#define RT_DEFAULT_PRIO 40              //below threaded IRQ handlers (50), so the adapter's USB IRQ still runs
+#define RT_STACK_PREFAULT (256 << 10)   //stack touched by each real-time thread
+#define RT_HIST 16                      //latency buckets: < 1 us, < 2 us, ... < 16 ms, more
+
+typedef struct rt_config {
+    int            enabled;
+    int            cpu;                 //reader core, the first of readers
+    int            prio;                //SCHED_FIFO priority of the reader
+    int            readers;             //reader threads, on consecutive cores from cpu
+    int            auto_cpu;            //cpu was picked by "auto"
+} rt_config;
+
+typedef struct rt_latency {
+    unsigned long  n;
+    __u64          sum_ns;
+    __u64          max_ns;
+    unsigned long  max_frame;           //frame that saw max_ns
+    unsigned long  hist[RT_HIST];
+} rt_latency;
+
+int  rt_parse(rt_config *rt, const char *arg);
+int  rt_setup(rt_config *rt);
+int  rt_lock_memory(rt_config *rt);
+int  rt_reader(rt_config *rt);
+void rt_latency_add(rt_latency *lat, __u64 ns, unsigned long frame);
+void rt_latency_report(const rt_latency *lat);
+
+#endif /* RT_H */
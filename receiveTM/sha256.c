@@ -0,0 +1,210 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : sha256.c
+ * Header(s)     : sha256.h
+ * Description   : Incremental SHA-256 of received images, on the x86 SHA
+ *                 extensions when the CPU has them, else portable C.
+ * Function(s)   : const char* sha256_setup(void)        - Pick the kernel, returns its name
+ *                 void sha256_init(sha256_ctx*)
+ *                 void sha256_update(sha256_ctx*, const void*, size_t) - Hash more bytes
+ *                 void sha256_zeros(sha256_ctx*, size_t)    - Hash a run of zero bytes
+ *                 void sha256_final(sha256_ctx*, unsigned char*) - Pad and give the digest
+ *                 void sha256_hex(const unsigned char*, char*)   - Digest as lowercase hex
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "sha256.h"
+
+static const __u32 K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROR(x, n) ((x) >> (n) | (x) << (32 - (n)))
+
+static void sha256_blocks_sw(__u32 h[8], const unsigned char *p, size_t n);
+static void (*sha256_blocks)(__u32 h[8], const unsigned char *p, size_t n) = sha256_blocks_sw;
+static const char *sha256_kernel = "c";
+
+static void sha256_block(__u32 h[8], const unsigned char *p) {
+    __u32 w[64];
+    __u32 a, b, c, d, e, f, g, k, t1, t2;
+    int i;
+
+    for (i = 0; i < 16; i++)
+        w[i] = (__u32) p[4 * i] << 24 | (__u32) p[4 * i + 1] << 16 | (__u32) p[4 * i + 2] << 8 | p[4 * i + 3];
+    for (; i < 64; i++)
+        w[i] = w[i - 16] + (ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ (w[i - 15] >> 3)) +
+                w[i - 7] + (ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ (w[i - 2] >> 10));
+
+    a = h[0]; b = h[1]; c = h[2]; d = h[3];
+    e = h[4]; f = h[5]; g = h[6]; k = h[7];
+    for (i = 0; i < 64; i++) {
+        t1 = k + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+static void sha256_blocks_sw(__u32 h[8], const unsigned char *p, size_t n) {
+    for (; n > 0; n--, p += 64)
+        sha256_block(h, p);
+}
+
+#if defined(__x86_64__)
+/*
+ * Four rounds per pair of sha256rnds2; the message schedule runs three
+ * groups ahead in m[], as in Intel's reference code. Unrolled, m[] stays in
+ * registers, which more than doubles the rate.
+ */
+__attribute__((target("sha,ssse3,sse4.1")))
+static void sha256_blocks_ni(__u32 h[8], const unsigned char *p, size_t n) {
+    const __m128i swap = _mm_set_epi64x(0x0c0d0e0f08090a0bll, 0x0405060700010203ll);
+    __m128i st0, st1, save0, save1, msg, tmp;
+    __m128i m[4];
+    int i;
+
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &h[0]), 0xb1);   //CDAB
+    st1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &h[4]), 0x1b);   //EFGH
+    st0 = _mm_alignr_epi8(tmp, st1, 8);                                         //ABEF
+    st1 = _mm_blend_epi16(st1, tmp, 0xf0);                                      //CDGH
+
+    for (; n > 0; n--, p += 64) {
+        save0 = st0;
+        save1 = st1;
+#pragma GCC unroll 16
+        for (i = 0; i < 16; i++) {
+            if (i < 4)
+                m[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (p + 16 * i)), swap);
+            msg = _mm_add_epi32(m[i & 3], _mm_loadu_si128((const __m128i *) &K[4 * i]));
+            st1 = _mm_sha256rnds2_epu32(st1, st0, msg);
+            if (i >= 3 && i <= 14) {
+                tmp = _mm_alignr_epi8(m[i & 3], m[(i - 1) & 3], 4);
+                m[(i + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(m[(i + 1) & 3], tmp), m[i & 3]);
+            }
+            st0 = _mm_sha256rnds2_epu32(st0, st1, _mm_shuffle_epi32(msg, 0x0e));
+            if (i >= 1 && i <= 12)
+                m[(i - 1) & 3] = _mm_sha256msg1_epu32(m[(i - 1) & 3], m[i & 3]);
+        }
+        st0 = _mm_add_epi32(st0, save0);
+        st1 = _mm_add_epi32(st1, save1);
+    }
+
+    tmp = _mm_shuffle_epi32(st0, 0x1b);                                         //FEBA
+    st1 = _mm_shuffle_epi32(st1, 0xb1);                                         //DCHG
+    _mm_storeu_si128((__m128i *) &h[0], _mm_blend_epi16(tmp, st1, 0xf0));      //DCBA
+    _mm_storeu_si128((__m128i *) &h[4], _mm_alignr_epi8(st1, tmp, 8));         //HGFE
+}
+#endif
+
+/* Call once before any thread hashes */
+const char *sha256_setup(void) {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1")) {
+        sha256_blocks = sha256_blocks_ni;
+        sha256_kernel = "sha-ni";
+    }
+#endif
+    return sha256_kernel;
+}
+
+void sha256_init(sha256_ctx *c) {
+    static const __u32 h0[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    memcpy(c->h, h0, sizeof (c->h));
+    c->bytes = 0;
+    c->used = 0;
+}
+
+void sha256_update(sha256_ctx *c, const void *buf, size_t len) {
+    const unsigned char *p = buf;
+    size_t n;
+
+    c->bytes += len;
+    if (c->used > 0) {
+        n = sizeof (c->block) - c->used;
+        if (n > len)
+            n = len;
+        memcpy(c->block + c->used, p, n);
+        c->used += n;
+        p += n;
+        len -= n;
+        if (c->used < sizeof (c->block))
+            return;
+        sha256_blocks(c->h, c->block, 1);
+        c->used = 0;
+    }
+    n = len / sizeof (c->block);
+    sha256_blocks(c->h, p, n);
+    p += n * sizeof (c->block);
+    len -= n * sizeof (c->block);
+    memcpy(c->block, p, len);
+    c->used = len;
+}
+
+/* A hole in an image reads as zeros */
+void sha256_zeros(sha256_ctx *c, size_t len) {
+    static const unsigned char zeros[4096];
+    size_t n;
+
+    while (len > 0) {
+        n = len < sizeof (zeros) ? len : sizeof (zeros);
+        sha256_update(c, zeros, n);
+        len -= n;
+    }
+}
+
+void sha256_final(sha256_ctx *c, unsigned char out[SHA256_LEN]) {
+    __u64 bits = c->bytes * 8;
+    int i;
+
+    c->block[c->used++] = 0x80;
+    if (c->used > 56) {
+        memset(c->block + c->used, 0, sizeof (c->block) - c->used);
+        sha256_blocks(c->h, c->block, 1);
+        c->used = 0;
+    }
+    memset(c->block + c->used, 0, 56 - c->used);
+    for (i = 0; i < 8; i++)
+        c->block[56 + i] = bits >> (56 - 8 * i);
+    sha256_blocks(c->h, c->block, 1);
+    for (i = 0; i < 8; i++) {
+        out[4 * i]     = c->h[i] >> 24;
+        out[4 * i + 1] = c->h[i] >> 16;
+        out[4 * i + 2] = c->h[i] >> 8;
+        out[4 * i + 3] = c->h[i];
+    }
+}
+
+void sha256_hex(const unsigned char digest[SHA256_LEN], char out[SHA256_HEX]) {
+    static const char hex[] = "0123456789abcdef";
+    int i;
+
+    for (i = 0; i < SHA256_LEN; i++) {
+        out[2 * i]     = hex[digest[i] >> 4];
+        out[2 * i + 1] = hex[digest[i] & 0xf];
+    }
+    out[2 * SHA256_LEN] = 0;
+}
@@ -0,0 +1,43 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : sha256.h
+ * Source(s)     : sha256.c
+ * Description   : SHA-256 (FIPS 180-4), fed incrementally as image data is
+ *                 written so every image has its digest the moment it is
+ *                 saved (assembler.c). The digest goes into the image's
+ *                 catalog entry and a <image>.sha256 file that coreutils'
+ *                 sha256sum -c checks, so an archive audit or a copy to
+ *                 removable media never needs the receiver to read the image
+ *                 back.
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <linux/types.h>
+
+#define SHA256_LEN 32
+#define SHA256_HEX (2 * SHA256_LEN + 1)
+
+typedef struct sha256_ctx {
+    __u32         h[8];
+    __u64         bytes;                //message length so far
+    unsigned char block[64];            //partial block...
+    size_t        used;                 //...bytes of it
+} sha256_ctx;
+
+const char *sha256_setup(void);
+void sha256_init(sha256_ctx *c);
+void sha256_update(sha256_ctx *c, const void *buf, size_t len);
+void sha256_zeros(sha256_ctx *c, size_t len);
+void sha256_final(sha256_ctx *c, unsigned char out[SHA256_LEN]);
+void sha256_hex(const unsigned char digest[SHA256_LEN], char out[SHA256_HEX]);
+
+#endif /* SHA256_H */
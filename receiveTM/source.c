@@ -0,0 +1,597 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : source.c
+ * Header(s)     : source.h, synclink.h
+ * Description   : Frame source back-ends. The Synclink back-end carries the
+ *                 device setup that used to live in main() (N_HDLC line
+ *                 discipline, MGSL_PARAMS, RTS/DTR, receiver enable). The
+ *                 others let the receive/assemble/index pipeline run and be
+ *                 load tested without the USB adapter attached.
+ * Function(s)   : int source_open(frame_source*, const char*) - Parse spec and open back-end
+ *                 void source_set_speed(frame_source*, double) - Journal replay rate
+ *                 void source_close(frame_source*)            - Close back-end
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "source.h"
+
+#ifndef N_HDLC
+#define N_HDLC 13
+#endif
+
+/*********************************************************************************
+*                                    SYNCLINK
+*********************************************************************************/
+
+/* HDLC_CRC_RETURN_EX: the driver appends a status byte, RX_OK or RX_CRC_ERROR, to each frame */
+static int synclink_read(frame_source *src, unsigned char *buf, size_t size) {
+    int rc;
+
+    do {
+        rc = read(src->fd, buf, size);
+    } while (rc == 1);                  //a status byte alone: nothing to keep
+    if (rc <= 0)
+        return rc;
+    src->crc_error = (buf[rc - 1] != RX_OK);
+    return rc - 1;
+}
+
+static int synclink_stats(frame_source *src, struct mgsl_icount *icount) {
+    return ioctl(src->fd, MGSL_IOCGSTATS, icount);
+}
+
+static void synclink_close(frame_source *src) {
+    int sigs, rc;
+
+    printf("Turn off RTS and DTR serial outputs\n");
+    sigs = TIOCM_RTS + TIOCM_DTR;
+    rc = ioctl(src->fd, TIOCMBIC, &sigs);
+    if (rc < 0) {
+        printf("negate DTR/RTS error=%d %s\n", errno, strerror(errno));
+    }
+    close(src->fd);
+}
+
+static int synclink_open(frame_source *src) {
+    MGSL_PARAMS params;
+    int ldisc = N_HDLC;
+    int sigs, rc;
+
+    printf("receive HDLC data on device: %s\n", src->path);
+
+    /* open serial device with O_NONBLOCK to ignore DCD input */
+    src->fd = open(src->path, O_RDWR | O_NONBLOCK, 0);
+    if (src->fd < 0) {
+        printf("open error=%d %s\n", errno, strerror(errno));
+        return -1;
+    } else printf("%s port opened\n", src->path);
+
+    /*
+     * set N_HDLC line discipline
+     *
+     * A line discipline is a software layer between a tty device driver
+     * and user application that performs intermediate processing,
+     * formatting, and buffering of data.
+     */
+    rc = ioctl(src->fd, TIOCSETD, &ldisc);
+    if (rc < 0) {
+        printf("set line discipline error=%d %s\n",
+                errno, strerror(errno));
+        return -1;
+    }
+
+    /* get current device parameters */
+    rc = ioctl(src->fd, MGSL_IOCGPARAMS, &params);
+    if (rc < 0) {
+        printf("ioctl(MGSL_IOCGPARAMS) error=%d %s\n",
+                errno, strerror(errno));
+        return -1;
+    }
+
+    /*
+     * modify device parameters
+     *
+     * HDLC/SDLC mode, loopback disabled, NRZ encoding
+     * Data clocks sourced from clock input pins
+     * Output 9600bps clock on auxclk output
+     * Hardware generation/checking of CCITT (ITU) CRC 16, frames that fail
+     * it still returned with a status byte
+     */
+    params.mode            = MGSL_MODE_HDLC;
+    params.loopback        = 0;
+    params.flags           = HDLC_FLAG_RXC_RXCPIN + HDLC_FLAG_TXC_TXCPIN;
+    params.encoding        = HDLC_ENCODING_NRZ;
+    params.clock_speed     = HDLC_FLAG_TXC_BRG;
+    params.crc_type        = HDLC_CRC_16_CCITT | HDLC_CRC_RETURN_EX;
+    params.preamble        = HDLC_PREAMBLE_PATTERN_ONES;
+    params.preamble_length = HDLC_PREAMBLE_LENGTH_16BITS;
+
+    /* set current device parameters */
+    rc = ioctl(src->fd, MGSL_IOCSPARAMS, &params);
+    if (rc < 0) {
+        printf("ioctl(MGSL_IOCSPARAMS) error=%d %s\n",
+                errno, strerror(errno));
+        return -1;
+    }
+
+    printf("Turn on RTS and DTR serial outputs\n");
+    sigs = TIOCM_RTS | TIOCM_DTR;
+    rc = ioctl(src->fd, TIOCMBIC, &sigs);
+    if (rc < 0) {
+        printf("assert DTR/RTS error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+
+    /* reads stay non-blocking: the reader waits for frames in epoll */
+
+    /*enable receiver*/
+    int enable = 2;
+    rc = ioctl(src->fd, MGSL_IOCRXENABLE, enable);
+
+    src->read_frame = synclink_read;
+    src->get_stats  = synclink_stats;
+    src->close      = synclink_close;
+    return 0;
+}
+
+/*********************************************************************************
+*                         LENGTH-PREFIXED BYTE STREAMS
+*********************************************************************************/
+
+/* Make at least need bytes available in sbuf; returns 0 on EOF, < 0 on error */
+static int stream_fill(frame_source *src, size_t need) {
+    int rc;
+
+    while (src->slen - src->spos < need) {
+        if (src->spos > 0) {
+            memmove(src->sbuf, src->sbuf + src->spos, src->slen - src->spos);
+            src->slen -= src->spos;
+            src->spos = 0;
+        }
+        rc = read(src->fd, src->sbuf + src->slen, SOURCE_STREAM_BUF - src->slen);
+        if (rc <= 0)
+            return rc;
+        src->slen += rc;
+    }
+    return 1;
+}
+
+/* Copy a len byte payload out of the stream; longer than size is truncated like N_HDLC */
+static int stream_payload(frame_source *src, unsigned char *buf, size_t size, size_t len) {
+    size_t chunk, copied = 0;
+    int rc;
+
+    while (len > 0) {
+        rc = stream_fill(src, 1);
+        if (rc <= 0)
+            return rc;
+        chunk = src->slen - src->spos;
+        if (chunk > len)
+            chunk = len;
+        if (copied < size)
+            memcpy(buf + copied, src->sbuf + src->spos, (copied + chunk > size) ? size - copied : chunk);
+        copied += chunk;
+        src->spos += chunk;
+        len -= chunk;
+    }
+    return (copied > size) ? (int) size : (int) copied;
+}
+
+/*
+ * One frame per length prefix. Nothing is consumed until the whole frame is
+ * buffered, so an EAGAIN part way through leaves the stream intact.
+ */
+static int stream_read(frame_source *src, unsigned char *buf, size_t size) {
+    unsigned char *p;
+    size_t len;
+    int rc;
+
+    rc = stream_fill(src, 4);
+    if (rc <= 0)
+        return rc;
+    p = src->sbuf + src->spos;
+    len = (size_t) p[0] | (size_t) p[1] << 8 | (size_t) p[2] << 16 | (size_t) p[3] << 24;
+    if (len + 4 <= SOURCE_STREAM_BUF) {
+        rc = stream_fill(src, len + 4);
+        if (rc <= 0)
+            return rc;
+    }
+    src->spos += 4;
+
+    return stream_payload(src, buf, size, len);
+}
+
+/* Next record header of a capture journal, skipping damaged bytes if needed */
+static int journal_next(frame_source *src, journal_rec_hdr *rec) {
+    int rc;
+
+    for (;;) {
+        rc = stream_fill(src, sizeof (*rec));
+        if (rc <= 0)
+            return rc;
+        memcpy(rec, src->sbuf + src->spos, sizeof (*rec));
+        if (rec->sync == JOURNAL_REC_SYNC && rec->len <= HDLC_MAX_FRAME_SIZE)
+            return 1;
+        if (src->resyncs++ == 0)
+            printf("capture journal damaged, resyncing\n");
+        src->spos++;
+    }
+}
+
+static __u64 mono_now(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (__u64) now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/* Hold a record back until its recorded arrival time, scaled by src->speed; EAGAIN until then */
+static int journal_pace(frame_source *src) {
+    struct timespec due;
+    __u64 now = mono_now();
+    __u64 when;
+
+    if (src->frames == 0) {
+        src->rec_t0  = src->rec.mono_ns;
+        src->play_t0 = now;
+    }
+    if (src->speed <= 0)
+        return 0;
+
+    when = src->play_t0 + (__u64) ((double) (src->rec.mono_ns - src->rec_t0) / src->speed);
+    clock_gettime(CLOCK_REALTIME, &due);
+    src->ready_ns = when + ((__u64) due.tv_sec * 1000000000ull + due.tv_nsec - now);
+    if (now >= when) {
+        if (now - when > src->max_lag_ns)
+            src->max_lag_ns = now - when;
+        return 0;
+    }
+    src->due_ns = when;
+    errno = EAGAIN;
+    return -1;
+}
+
+/* Replayed link counters, for the next sample the reader's stats timer (or -s Nf) takes */
+static void journal_set_stats(frame_source *src, const struct mgsl_icount *icount, __u32 crc_errs) {
+    if (icount != NULL)
+        src->icount = *icount;
+    src->icount.rxcrc += crc_errs;
+}
+
+/* Statistics sample record: replay its counters, it is not a frame */
+static int journal_sample(frame_source *src) {
+    journal_stats_rec stats;
+    size_t len = JOURNAL_REC_ALIGN(src->rec.len);
+    int rc;
+
+    rc = stream_fill(src, len);
+    if (rc <= 0)
+        return rc;
+    if (src->rec.len >= sizeof (stats)) {
+        memcpy(&stats, src->sbuf + src->spos, sizeof (stats));
+        journal_set_stats(src, &stats.icount, 0);
+    }
+    src->spos += len;
+    return 1;
+}
+
+/* One frame per journal record, timestamps kept in src->rec */
+static int journal_read(frame_source *src, unsigned char *buf, size_t size) {
+    int rc;
+
+    for (;;) {
+        rc = journal_next(src, &src->rec);
+        if (rc <= 0)
+            return rc;
+        if (!(src->rec.flags & (JOURNAL_REC_STATS | JOURNAL_REC_CLOSE)))
+            break;
+        src->spos += sizeof (src->rec);
+        if (src->rec.flags & JOURNAL_REC_CLOSE)
+            continue;                   //a restarted receiver appended after this
+        rc = journal_sample(src);
+        if (rc <= 0)
+            return rc;
+    }
+
+    /* not due yet: leave the record in the buffer for the next call */
+    if (journal_pace(src) < 0)
+        return -1;
+    src->spos += sizeof (src->rec);
+
+    /* journals without sample records count CRC errors per frame */
+    if (src->rec.crc_errs != 0)
+        journal_set_stats(src, NULL, src->rec.crc_errs);
+    src->frames++;
+    src->bytes += src->rec.len;
+    src->frame_ns = src->rec.mono_ns;
+    src->crc_error = (src->rec.flags & JOURNAL_REC_CRC) != 0;
+
+    rc = stream_payload(src, buf, size, src->rec.len);
+    if (rc <= 0)
+        return rc;
+    if (stream_fill(src, JOURNAL_REC_ALIGN(src->rec.len) - src->rec.len) > 0)
+        src->spos += JOURNAL_REC_ALIGN(src->rec.len) - src->rec.len;
+    return rc;
+}
+
+/* Counters replayed so far; sampled by the reader between reads, like the SyncLink's ioctl */
+static int journal_stats(frame_source *src, struct mgsl_icount *icount) {
+    *icount = src->icount;
+    return 0;
+}
+
+static void stream_close(frame_source *src) {
+    close(src->fd);
+    free(src->sbuf);
+    src->sbuf = NULL;
+}
+
+/* Replay throughput: with speed 0 this is the receiver's sustainable rate */
+static void replay_close(frame_source *src) {
+    double secs = (double) (mono_now() - src->play_t0) / 1e9;
+
+    if (src->frames > 0 && secs > 0) {
+        printf("replay: %lu frames, %.1f MB in %.2f s = %.0f frames/s, %.1f Mbps",
+                src->frames, src->bytes / 1e6, secs, src->frames / secs, src->bytes * 8 / secs / 1e6);
+        if (src->speed > 0)
+            printf(", speed %gx, max lag %.1f ms", src->speed, src->max_lag_ns / 1e6);
+        printf("\n");
+    }
+    if (src->resyncs > 0)
+        printf("replay: %lu damaged bytes skipped\n", src->resyncs);
+    stream_close(src);
+}
+
+static int stream_setup(frame_source *src) {
+    src->sbuf = malloc(SOURCE_STREAM_BUF);
+    if (src->sbuf == NULL) {
+        printf("stream buffer alloc error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    src->slen       = 0;
+    src->spos       = 0;
+    src->eof_ok     = 1;
+    src->read_frame = stream_read;
+    src->close      = stream_close;
+    return 0;
+}
+
+/* Pseudo-terminal in raw mode; a generator writes framed data to the slave */
+static int pty_open(frame_source *src) {
+    struct termios tio;
+    int slave;
+
+    src->fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (src->fd < 0 || grantpt(src->fd) < 0 || unlockpt(src->fd) < 0) {
+        printf("pty open error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    snprintf(src->path, sizeof (src->path), "%s", ptsname(src->fd));
+
+    /* keep the slave open in raw mode so the master never sees EIO between writers */
+    slave = open(src->path, O_RDWR | O_NOCTTY);
+    if (slave < 0 || tcgetattr(slave, &tio) < 0) {
+        printf("pty slave error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    printf("receive framed data on pty slave: %s\n", src->path);
+    return stream_setup(src);
+}
+
+/* Named pipe, created if it does not exist yet */
+static int fifo_open(frame_source *src) {
+    if (mkfifo(src->path, 0666) < 0 && errno != EEXIST) {
+        printf("mkfifo error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    printf("waiting for a writer on fifo: %s\n", src->path);
+    src->fd = open(src->path, O_RDONLY);
+    if (src->fd < 0) {
+        printf("fifo open error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    fcntl(src->fd, F_SETPIPE_SZ, SOURCE_STREAM_BUF);
+    return stream_setup(src);
+}
+
+/* Recorded capture file: a capture journal, or a plain length-prefixed stream */
+static int file_open(frame_source *src) {
+    journal_file_hdr hdr;
+
+    src->fd = open(src->path, O_RDONLY);
+    if (src->fd < 0) {
+        printf("capture open error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    posix_fadvise(src->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    printf("replaying capture file: %s\n", src->path);
+    if (stream_setup(src) < 0)
+        return -1;
+
+    if (stream_fill(src, sizeof (hdr)) > 0 &&
+            memcmp(src->sbuf, JOURNAL_MAGIC, strlen(JOURNAL_MAGIC)) == 0) {
+        memcpy(&hdr, src->sbuf, sizeof (hdr));
+        printf("capture journal v%u recorded from %.96s\n", hdr.version, hdr.source);
+        if (stream_fill(src, hdr.hdr_size) <= 0)
+            return -1;
+        src->spos += hdr.hdr_size;
+        src->read_frame = journal_read;
+        src->get_stats  = journal_stats;
+        src->close      = replay_close;
+    }
+    return 0;
+}
+
+/*********************************************************************************
+*                                      UDP
+*********************************************************************************/
+
+/* One datagram, with its kernel receive timestamp in src->ready_ns */
+static int udp_read(frame_source *src, unsigned char *buf, size_t size) {
+    char control[CMSG_SPACE(sizeof (struct timespec))];
+    struct iovec iov = {buf, size};
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct timespec ts;
+    int rc;
+
+    memset(&msg, 0, sizeof (msg));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof (control);
+    rc = recvmsg(src->fd, &msg, 0);
+
+    src->ready_ns = 0;
+    for (cmsg = CMSG_FIRSTHDR(&msg); rc > 0 && cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof (ts));
+            src->ready_ns = (__u64) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+        }
+    }
+    return rc;
+}
+
+static void udp_close(frame_source *src) {
+    close(src->fd);
+}
+
+/* Bind [addr:]port, loopback by default */
+static int udp_open(frame_source *src) {
+    struct sockaddr_in addr;
+    char host[256] = "127.0.0.1";
+    char *port = strrchr(src->path, ':');
+    int rcvbuf = 8 << 20;
+    int on = 1;
+
+    if (port != NULL) {
+        snprintf(host, sizeof (host), "%.*s", (int) (port - src->path), src->path);
+        port++;
+    } else port = src->path;
+
+    memset(&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons((unsigned short) atoi(port));
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        printf("udp address error: %s\n", src->path);
+        return -1;
+    }
+
+    src->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (src->fd < 0) {
+        printf("socket error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    setsockopt(src->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof (rcvbuf));
+    setsockopt(src->fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof (on));       //read latency, see rt.c
+    if (bind(src->fd, (struct sockaddr *) &addr, sizeof (addr)) < 0) {
+        printf("bind error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    printf("receive datagrams on udp %s:%s\n", host, port);
+
+    src->eof_ok     = 1;
+    src->read_frame = udp_read;
+    src->close      = udp_close;
+    return 0;
+}
+
+/*********************************************************************************
+*                                   DISPATCH
+*********************************************************************************/
+
+static const struct {
+    const char *type;
+    int (*open)(frame_source *src);
+} backends[] = {
+    {"synclink", synclink_open},
+    {"pty",      pty_open},
+    {"fifo",     fifo_open},
+    {"udp",      udp_open},
+    {"file",     file_open},
+};
+
+/* Everything but a regular file is read non-blocking and waited on in epoll */
+static int source_nonblock(frame_source *src) {
+    struct stat st;
+
+    src->poll_fd = -1;
+    if (fstat(src->fd, &st) < 0 || S_ISREG(st.st_mode))
+        return 0;
+    if (fcntl(src->fd, F_SETFL, fcntl(src->fd, F_GETFL) | O_NONBLOCK) < 0) {
+        printf("fcntl error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    src->poll_fd = src->fd;
+    return 0;
+}
+
+int source_open(frame_source *src, const char *spec) {
+    const char *colon = strchr(spec, ':');
+    size_t i;
+    int rc;
+
+    memset(src, 0, sizeof (*src));
+    src->fd = -1;
+    src->poll_fd = -1;
+
+    /* bare path: Synclink device */
+    src->type = "synclink";
+    snprintf(src->path, sizeof (src->path), "%s", spec);
+    rc = -2;
+
+    for (i = 0; i < sizeof (backends) / sizeof (backends[0]); i++) {
+        size_t n = strlen(backends[i].type);
+        if (colon != NULL && (size_t) (colon - spec) == n && strncmp(spec, backends[i].type, n) == 0) {
+            src->type = backends[i].type;
+            snprintf(src->path, sizeof (src->path), "%s", colon + 1);
+            rc = backends[i].open(src);
+            break;
+        }
+    }
+    if (rc == -2)
+        rc = synclink_open(src);
+    if (rc < 0)
+        return rc;
+    return source_nonblock(src);
+}
+
+void source_set_speed(frame_source *src, double speed) {
+    if (speed > 0 && src->read_frame != journal_read) {
+        printf("%s:%s has no timestamps, replay speed ignored\n", src->type, src->path);
+        return;
+    }
+    src->speed = speed;
+}
+
+void source_close(frame_source *src) {
+    if (src->close != NULL)
+        src->close(src);
+    src->close = NULL;
+}
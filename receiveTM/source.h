@@ -0,0 +1,91 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : source.h
+ * Source(s)     : source.c
+ * Description   : Frame sources feeding the reader thread. A source is
+ *                 selected with a "type:argument" spec:
+ *                     synclink:/dev/ttyUSB0  Microgate adapter, N_HDLC (default)
+ *                     pty:                   pseudo-terminal, slave name printed
+ *                     fifo:/path             named pipe, created if missing
+ *                     udp:[addr:]port        one datagram = one frame
+ *                     file:/path             capture journal or framed stream
+ *                 A spec without a type prefix is a Synclink device path so
+ *                 the old "receivetm /dev/ttyUSB1" invocation keeps working.
+ *
+ *                 Byte-stream sources (pty, fifo, file) carry frames as a
+ *                 4 byte little-endian length followed by the payload, see
+ *                 tools/tmgen.c for a generator. A zero length frame (or
+ *                 datagram) marks the end of the pass, like read() == 0.
+ *
+ *                 Capture journals replay as fast as possible by default, or
+ *                 paced from their recorded timestamps at a multiple of the
+ *                 original rate with source_set_speed().
+ *
+ *                 The Synclink device delivers frames that fail their CRC
+ *                 check too (HDLC_CRC_RETURN_EX), flagged in crc_error, so
+ *                 a redundant link can replace them (merge.c); journals
+ *                 record and replay the flag.
+ *
+ *                 Sources are non-blocking: read_frame() fails with EAGAIN
+ *                 when no whole frame is available, or, for a paced replay,
+ *                 until due_ns. The reader then waits on poll_fd or due_ns
+ *                 in its event loop (events.c).
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stddef.h>
+
+#include "synclink.h"
+#include "journal.h"
+
+#define SOURCE_STREAM_BUF (1 << 20)
+
+typedef struct frame_source frame_source;
+
+struct frame_source {
+    const char    *type;                //backend name, e.g. "synclink"
+    char           path[256];           //device, pipe, file or address
+    int            fd;
+    int            poll_fd;             //fd to wait on, -1 if always readable (regular file)
+    __u64          due_ns;              //CLOCK_MONOTONIC the next paced frame is due, after EAGAIN
+    int            eof_ok;              //read_frame() == 0 is a normal end of pass
+    __u64          ready_ns;            //CLOCK_REALTIME the last frame became available, 0 if unknown
+    __u64          frame_ns;            //CLOCK_MONOTONIC the last frame was received, if earlier than read() (replay), else 0
+    int            crc_error;           //the last frame failed its CRC check
+
+    /* returns frame length, 0 at end of input, < 0 with errno set on error */
+    int          (*read_frame)(frame_source *src, unsigned char *buf, size_t size);
+    /* link statistics, returns < 0 if the backend has none */
+    int          (*get_stats)(frame_source *src, struct mgsl_icount *icount);
+    void         (*close)(frame_source *src);
+
+    /* length-prefixed stream state */
+    unsigned char *sbuf;
+    size_t         slen;
+    size_t         spos;
+
+    /* capture journal replay state */
+    journal_rec_hdr rec;                //header of the last frame returned
+    struct mgsl_icount icount;          //link counters rebuilt from the journal
+    unsigned long  resyncs;             //damaged records skipped
+    double         speed;               //0 as fast as possible, 1 original timing, n times faster
+    __u64          rec_t0;              //mono_ns of the first replayed record
+    __u64          play_t0;             //CLOCK_MONOTONIC when it was replayed
+    __u64          max_lag_ns;          //worst lateness against the replay schedule
+    unsigned long  frames;
+    unsigned long long bytes;
+};
+
+int  source_open(frame_source *src, const char *spec);
+void source_set_speed(frame_source *src, double speed);
+void source_close(frame_source *src);
+
+#endif /* SOURCE_H */
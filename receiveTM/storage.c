@@ -0,0 +1,550 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : storage.c
+ * Header(s)     : storage.h
+ * Description   : Group-commit bookkeeping shared by all storage back-ends,
+ *                 and the stdio back-end. stdio gets a buffer larger than
+ *                 flush_bytes plus one frame so it never writes on its own;
+ *                 only the flush policy decides when fflush() hits the disk.
+ * Function(s)   : FILE* openFile(char*)                - Opens file streams/handles errors
+ *                 int store_open(tm_store*, ...)       - Select back-end, open image_buf.tmp
+ *                 int store_image_prepare(tm_store*)    - Set up the next image early
+ *                 int store_image_write(tm_store*, const unsigned char*, size_t)
+ *                 int store_image_write_at(tm_store*, const unsigned char*, size_t, size_t)
+ *                                                      - Image data at its offset
+ *                 int store_image_finish(tm_store*, const char*) - Complete and rename image
+ *                 int store_sidecar_write(tm_store*, const char*, const char*, size_t)
+ *                                                      - Small file beside an image
+ *                 int store_idle(tm_store*)            - Flush on the time limit
+ *                 int store_drain(tm_store*)           - Flush and wait for I/O in flight
+ *                 void store_expect(tm_store*, size_t) - Size hint for the next image
+ *                 unsigned char* store_landing_get(tm_store*, unsigned long, size_t, size_t)
+ *                                                      - Zero-copy target for the reader
+ *                 void store_close(tm_store*)
+ *                 int store_pads(const char*)          - Back-end leaves zeros past the data
+ *                 void store_mark_padded(tm_store*, int) - Tag image_buf.tmp for recovery
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+
+#include "storage.h"
+#include "logger.h"
+#include "synclink.h"
+
+/* Handles stream opens and errors*/
+FILE * openFile(char* name) {
+
+    FILE *file;
+    file = fopen(name, "a+");
+    if (file != NULL)
+        fclose(file);
+    file = fopen(name, "r+");
+    if (file == NULL) {
+        printf("fopen error = %d %s\n", errno, strerror(errno));
+    }
+    return file;
+}
+
+unsigned long long store_now_ms(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+void store_count_image(tm_store *st) {
+    st->pass.writes   += st->img.writes;
+    st->pass.syncs    += st->img.syncs;
+    st->pass.meta     += st->img.meta;
+    st->pass.syscalls += st->img.syscalls;
+    st->pass.waits    += st->img.waits;
+    st->pass.bytes    += st->img.bytes;
+    st->pass.ms       += st->img.ms;
+    st->pass.pages    += st->img.pages;
+    st->pass.cached   += st->img.cached;
+    memset(&st->img, 0, sizeof (st->img));
+}
+
+/* The back-end preallocates (mmap) or pads (direct) image_buf.tmp past the data written */
+int store_pads(const char *backend) {
+    return backend != NULL && (strcmp(backend, "mmap") == 0 || strcmp(backend, "direct") == 0);
+}
+
+/*
+ * Tag a freshly created image_buf.tmp of such a back-end, so recovery knows
+ * its trailing zeros may be padding; best effort, not every filesystem
+ * keeps user xattrs
+ */
+void store_mark_padded(tm_store *st, int fd) {
+    fsetxattr(fd, STORE_PADDED_XATTR, st->ops->name, strlen(st->ops->name), 0);
+    st->img.syscalls++;
+}
+
+/* Page-cache footprint of a finished image, from mincore() on a read-only mapping */
+static int cached_pages(const char *path, unsigned long *pages, unsigned long *cached) {
+    struct stat sb;
+    unsigned char *vec;
+    void *map;
+    long page = sysconf(_SC_PAGESIZE);
+    unsigned long i;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &sb) < 0 || sb.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+
+    *pages = (sb.st_size + page - 1) / page;
+    *cached = 0;
+    vec = malloc(*pages);
+    if (vec != NULL && mincore(map, sb.st_size, vec) == 0) {
+        for (i = 0; i < *pages; i++)
+            *cached += vec[i] & 1;
+    }
+    free(vec);
+    munmap(map, sb.st_size);
+    return 0;
+}
+
+/*********************************************************************************
+*                                     STDIO
+*********************************************************************************/
+
+/* Open image_buf.tmp with a stdio buffer big enough that only we decide when to write */
+static int stdio_open_image(tm_store *st) {
+    st->fp = openFile(st->image_path);
+    if (st->fp == NULL)
+        return -1;
+    setvbuf(st->fp, st->iobuf, _IOFBF, st->iobuf_size);
+    st->img.meta     += 3;              //openFile() opens, closes and reopens
+    st->img.syscalls += 3;
+    return 0;
+}
+
+static int stdio_image_write(tm_store *st, const unsigned char *buf, size_t len) {
+    if (fwrite(buf, sizeof (char), len, st->fp) != len) {
+        printf("fwrite error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * The stream is flushed: past the end, seek and carry on buffering from
+ * there, which leaves a hole; behind it, pwrite() into the hole.
+ */
+static int stdio_image_write_at(tm_store *st, const unsigned char *buf, size_t len, size_t off) {
+    if (off >= st->img_end) {
+        if (fseek(st->fp, off, SEEK_SET) < 0) {
+            printf("file seek error=%d %s\n", errno, strerror(errno));
+            return -1;
+        }
+        st->img.syscalls++;
+        return stdio_image_write(st, buf, len);
+    }
+    if (pwrite(fileno(st->fp), buf, len, off) != (ssize_t) len) {
+        printf("pwrite error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    st->img.writes++;
+    st->img.syscalls++;
+    return 0;
+}
+
+static int stdio_image_flush(tm_store *st) {
+    if (fflush(st->fp) != 0) {
+        printf("fflush error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    st->img.writes++;
+    st->img.syscalls++;
+    return 0;
+}
+
+static int stdio_image_finish(tm_store *st, const char *final_path) {
+    if (st->pending > 0 && stdio_image_flush(st) < 0)
+        return -1;
+    if (st->policy.sync_image) {
+        fdatasync(fileno(st->fp));
+        st->img.syncs++;
+        st->img.syscalls++;
+    }
+    fclose(st->fp);
+    rename(st->image_path, final_path);
+    st->img.meta     += 2;
+    st->img.syscalls += 2;
+    return 0;
+}
+
+/* Start a fresh catalog and leave the cursor right before '</CATALOG>' */
+int stdio_catalog_open(tm_store *st) {
+    st->outxml = openFile(st->current_xml);
+    if (st->outxml == NULL)
+        return -1;
+
+    /* Write XML declaration/header */
+    fprintf(st->outxml, "<?xml version=\"1.0\" encoding=\"ASCII\" standalone=\"yes\"?>\n");
+    fprintf(st->outxml, "<CATALOG>\n\n");
+    fprintf(st->outxml, "</CATALOG>\n");
+    fflush(st->outxml);
+
+    /*place cursor right before '/catalog' tag*/
+    if (fseek(st->outxml, (-11), SEEK_END) < 0) {
+        printf("file seek error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    fflush(st->outxml);
+    st->pass.meta     += 3;
+    st->pass.syscalls += 5;
+    return 0;
+}
+
+/* catalog entries are small; they are flushed with the footer */
+int stdio_catalog_write(tm_store *st, const char *buf, size_t len) {
+    if (fwrite(buf, sizeof (char), len, st->outxml) != len) {
+        printf("fwrite error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* An entry cut short at shutdown: back up over it so the footer replaces it */
+int stdio_catalog_discard(tm_store *st, size_t len) {
+    if (fflush(st->outxml) != 0 || fseek(st->outxml, -(long) len, SEEK_CUR) < 0 ||
+            ftruncate(fileno(st->outxml), ftell(st->outxml)) < 0) {
+        printf("catalog discard error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    st->pass.syscalls += 3;
+    return 0;
+}
+
+int stdio_catalog_close(tm_store *st) {
+    if (st->outxml == NULL)
+        return 0;                       //no catalog open: closed already
+
+    /* Include footer in xml */
+    fprintf(st->outxml, "</CATALOG>\n");
+
+    fflush(st->outxml);
+    st->pass.syscalls++;
+    if (st->policy.sync_image) {
+        fdatasync(fileno(st->outxml));
+        st->pass.syncs++;
+        st->pass.syscalls++;
+    }
+    fclose(st->outxml);
+    st->outxml = NULL;
+    st->pass.meta++;
+    st->pass.syscalls++;
+    return 0;
+}
+
+int stdio_catalog_archive(tm_store *st, const char *archive_path) {
+    rename(st->current_xml, archive_path);
+    st->pass.meta++;
+    st->pass.syscalls++;
+    return 0;
+}
+
+/* A small file beside an image (its digest), as durable as the image under -S */
+int stdio_sidecar_write(tm_store *st, const char *path, const char *buf, size_t len) {
+    FILE *fp;
+    int rc = 0;
+
+    fp = fopen(path, "w");
+    if (fp == NULL) {
+        printf("fopen %s error=%d %s\n", path, errno, strerror(errno));
+        return -1;
+    }
+    if (fwrite(buf, sizeof (char), len, fp) != len || fflush(fp) != 0) {
+        printf("fwrite %s error=%d %s\n", path, errno, strerror(errno));
+        rc = -1;
+    }
+    if (rc == 0 && st->policy.sync_image) {
+        fdatasync(fileno(fp));
+        st->pass.syncs++;
+        st->pass.syscalls++;
+    }
+    fclose(fp);
+    st->pass.meta     += 2;
+    st->pass.syscalls += 3;
+    return rc;
+}
+
+static void stdio_close(tm_store *st) {
+    if (st->fp != NULL) {
+        if (st->pending > 0)
+            stdio_image_flush(st);
+        fclose(st->fp);
+    }
+    st->fp = NULL;
+    if (st->outxml != NULL)
+        fclose(st->outxml);
+    st->outxml = NULL;
+    free(st->iobuf);
+    st->iobuf = NULL;
+}
+
+static const store_ops stdio_ops = {
+    "stdio",
+    NULL,
+    stdio_image_write,
+    stdio_image_write_at,
+    stdio_image_flush,
+    stdio_image_finish,
+    stdio_sidecar_write,
+    stdio_catalog_open,
+    stdio_catalog_write,
+    stdio_catalog_discard,
+    stdio_catalog_close,
+    stdio_catalog_archive,
+    NULL,                               //nothing in flight once fflush() returns
+    stdio_close,
+};
+
+static int stdio_open(tm_store *st) {
+    /* room for flush_bytes plus the frame that crosses it, so stdio never flushes on its own */
+    st->iobuf_size = st->policy.flush_bytes + HDLC_MAX_FRAME_SIZE + 1;
+    st->iobuf = malloc(st->iobuf_size);
+    if (st->iobuf == NULL) {
+        printf("image buffer alloc error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    st->ops = &stdio_ops;
+    return stdio_open_image(st);
+}
+
+/*********************************************************************************
+*                                  GROUP COMMIT
+*********************************************************************************/
+
+int store_open(tm_store *st, const char *backend, const char *image_path,
+               const char *current_xml, const flush_policy *policy) {
+    memset(st, 0, sizeof (*st));
+    st->policy = *policy;
+    snprintf(st->image_path, sizeof (st->image_path), "%s", image_path);
+    snprintf(st->current_xml, sizeof (st->current_xml), "%s", current_xml);
+
+    if (backend == NULL || strcmp(backend, "stdio") == 0)
+        return stdio_open(st);
+    if (strcmp(backend, "uring") == 0)
+        return store_uring_open(st);
+    if (strcmp(backend, "direct") == 0)
+        return store_direct_open(st);
+    if (strcmp(backend, "mmap") == 0)
+        return store_mmap_open(st);
+
+    printf("unknown storage back-end: %s\n", backend);
+    return -1;
+}
+
+/* Push buffered image data to the disk */
+static int store_flush(tm_store *st) {
+    if (st->pending == 0)
+        return 0;
+    if (st->ops->image_flush(st) < 0)
+        return -1;
+    st->pending = 0;
+    return 0;
+}
+
+/* Let the back-end set up the next image before its first frame, once its size is known */
+int store_image_prepare(tm_store *st) {
+    if (st->ops->image_prepare == NULL)
+        return 0;
+    return st->ops->image_prepare(st);
+}
+
+int store_image_write(tm_store *st, const unsigned char *buf, size_t len) {
+    if (st->img.bytes == 0)
+        st->img_start_ms = store_now_ms();
+    if (st->ops->image_write(st, buf, len) < 0)
+        return -1;
+    st->img.bytes += len;
+    st->img_end += len;
+
+    /* group commit: flush once enough bytes or time have built up */
+    if (st->pending == 0)
+        st->pending_ms = store_now_ms();
+    st->pending += len;
+    if (st->pending >= st->policy.flush_bytes && store_flush(st) < 0)
+        return -1;
+    return store_idle(st);
+}
+
+/*
+ * Image data at byte off of the image: appended when it continues the image,
+ * otherwise the back-end places it once what is buffered is written out.
+ */
+int store_image_write_at(tm_store *st, const unsigned char *buf, size_t len, size_t off) {
+    if (off == st->img_end)
+        return store_image_write(st, buf, len);
+    if (st->img.bytes == 0)
+        st->img_start_ms = store_now_ms();
+    if (store_flush(st) < 0 || st->ops->image_write_at(st, buf, len, off) < 0)
+        return -1;
+    st->img.bytes += len;
+    if (off + len > st->img_end)
+        st->img_end = off + len;
+
+    /* a back-end may have buffered it */
+    st->pending_ms = store_now_ms();
+    st->pending = len;
+    if (st->pending >= st->policy.flush_bytes && store_flush(st) < 0)
+        return -1;
+    return store_idle(st);
+}
+
+int store_image_finish(tm_store *st, const char *final_path) {
+    if (st->ops->image_finish(st, final_path) < 0)
+        return -1;
+    st->pending = 0;
+    st->img_end = 0;
+    if (st->img.bytes > 0)
+        st->img.ms = store_now_ms() - st->img_start_ms;
+
+    /* an asynchronous rename may not have happened yet; it is the same inode */
+    if (cached_pages(final_path, &st->img.pages, &st->img.cached) < 0)
+        cached_pages(st->image_path, &st->img.pages, &st->img.cached);
+
+    log_msg("image storage [%s]: %lu writes, %lu fdatasync, %lu open/close/rename, %lu syscalls, %lu waits\n",
+            st->ops->name, st->img.writes, st->img.syncs, st->img.meta, st->img.syscalls, st->img.waits);
+    log_msg("image storage [%s]: %.1f MB in %llu ms (%.1f MB/s), %lu of %lu pages in page cache\n",
+            st->ops->name, st->img.bytes / 1e6, st->img.ms,
+            st->img.ms ? st->img.bytes / 1e3 / st->img.ms : 0.0, st->img.cached, st->img.pages);
+    store_count_image(st);
+    st->images++;
+    st->no_landing = 0;
+
+    /* the stdio back-end reopens here; others open lazily */
+    if (st->ops == &stdio_ops)
+        return stdio_open_image(st);
+    return 0;
+}
+
+/* After store_image_finish(): its I/O is counted with the pass, like the catalog's */
+int store_sidecar_write(tm_store *st, const char *path, const char *buf, size_t len) {
+    return st->ops->sidecar_write(st, path, buf, len);
+}
+
+/* Flush image data that has waited longer than flush_ms */
+int store_idle(tm_store *st) {
+    if (st->pending == 0 || st->policy.flush_ms == 0)
+        return 0;
+    if (store_now_ms() - st->pending_ms < st->policy.flush_ms)
+        return 0;
+    return store_flush(st);
+}
+
+/* Size hint for the next image, from the catalog geometry */
+void store_expect(tm_store *st, size_t bytes) {
+    st->expect = bytes;
+}
+
+/* Publish the mapping of the image being assembled for in-place reads */
+void store_landing_set(tm_store *st, unsigned char *map, size_t cap) {
+    store_landing *l = &st->landing;
+    unsigned int seq = l->seq;
+
+    if (st->no_landing)
+        return;
+    __atomic_store_n(&l->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&l->map, map, __ATOMIC_RELAXED);
+    __atomic_store_n(&l->cap, cap, __ATOMIC_RELAXED);
+    __atomic_store_n(&l->image, st->images, __ATOMIC_RELAXED);
+    __atomic_store_n(&l->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void store_landing_clear(tm_store *st) {
+    store_landing *l = &st->landing;
+    unsigned int seq = l->seq;
+
+    __atomic_store_n(&l->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&l->map, NULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&l->cap, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&l->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/*
+ * Reader side: where len bytes at offset off of image number 'image' may be
+ * read, or NULL if that image is not mapped (yet) or the frame may not fit.
+ */
+unsigned char * store_landing_get(tm_store *st, unsigned long image, size_t off, size_t len) {
+    store_landing *l = &st->landing;
+    unsigned int seq = __atomic_load_n(&l->seq, __ATOMIC_ACQUIRE);
+    unsigned char *map;
+    size_t cap;
+
+    if (seq & 1)
+        return NULL;
+    map = __atomic_load_n(&l->map, __ATOMIC_RELAXED);
+    cap = __atomic_load_n(&l->cap, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&l->image, __ATOMIC_RELAXED) != image)
+        map = NULL;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&l->seq, __ATOMIC_RELAXED) != seq)
+        return NULL;
+    if (map == NULL || off + len > cap)
+        return NULL;
+    return map + off;
+}
+
+/*
+ * The current image did not start right after an XML terminator, so the reader
+ * (which only counts image bytes from there) cannot know its offsets.
+ */
+void store_no_landing(tm_store *st) {
+    st->no_landing = 1;
+    store_landing_clear(st);
+}
+
+/* Write out buffered image data and wait until the back-end has nothing in flight */
+int store_drain(tm_store *st) {
+    if (store_flush(st) < 0)
+        return -1;
+    if (st->ops->drain == NULL)
+        return 0;
+    return st->ops->drain(st);
+}
+
+void store_close(tm_store *st) {
+    if (st->ops == NULL)
+        return;
+    st->ops->close(st);
+    st->img.bytes = 0;                  //only completed images count toward the rate
+    store_count_image(st);
+    if (st->images > 0)
+        printf("storage [%s]: %lu images, %.1f writes/image, %.1f syscalls/image, %lu fdatasync, %lu waits\n",
+                st->ops->name, st->images, (double) st->pass.writes / st->images,
+                (double) st->pass.syscalls / st->images, st->pass.syncs, st->pass.waits);
+    if (st->pass.pages > 0)
+        printf("storage [%s]: %.1f MB/s while assembling images, %.1f%% of image pages left in page cache\n",
+                st->ops->name, st->pass.ms ? st->pass.bytes / 1e3 / st->pass.ms : 0.0,
+                100.0 * st->pass.cached / st->pass.pages);
+    st->ops = NULL;
+}
@@ -0,0 +1,164 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : storage.h
+ * Source(s)     : storage.c, storage_uring.c, storage_direct.c,
+ *                 storage_mmap.c
+ * Description   : Storage back-ends for received images and the XML catalog.
+ *                 The assembler decides what goes where; a back-end decides
+ *                 how bytes reach the disk:
+ *                     stdio  buffered FILE* streams (default)
+ *                     uring  io_uring with registered buffers, asynchronous
+ *                            writes, fdatasync, rename and close
+ *                     direct O_DIRECT through two aligned buffers, keeps
+ *                            images out of the page cache
+ *                     mmap   image preallocated from the catalog geometry and
+ *                            assembled in a shared mapping
+ *
+ *                 Image data is group-committed: it collects in the back-end
+ *                 and is written every flush_bytes or flush_ms, whichever
+ *                 comes first, which bounds what a crash can lose.
+ *
+ *                 mmap preallocates image_buf.tmp and direct pads its last
+ *                 block, so either file can end in zeros that are not image
+ *                 data. They tag it with STORE_PADDED_XATTR, and start-up
+ *                 recovery only trims trailing zeros from a tagged leftover.
+ *
+ *                 Framed image data (-H) is addressed by its byte offset.
+ *                 Data at the end of the image is appended as above; data
+ *                 past it leaves a hole, and data for a hole behind it is
+ *                 written in place without touching the rest of the file.
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define TM_PATH_LEN  512
+
+#define STORE_PADDED_XATTR "user.receivetm.padded"   //image_buf.tmp may end in zeros the image does not have
+
+#define FLUSH_DEFAULT_BYTES (1 << 20)
+#define FLUSH_DEFAULT_MS    250
+
+/* When buffered image data must reach the kernel */
+typedef struct flush_policy {
+    size_t       flush_bytes;           //0 flushes after every frame
+    unsigned int flush_ms;              //0 disables the time limit
+    int          sync_image;            //fdatasync each image before rename
+} flush_policy;
+
+/* Storage operations and the syscalls they cost, per image and per pass */
+typedef struct io_counters {
+    unsigned long writes;               //image data writes issued
+    unsigned long syncs;                //fdatasync
+    unsigned long meta;                 //open/close/rename
+    unsigned long syscalls;             //system calls actually made for the above
+    unsigned long waits;                //times the writer blocked on a completion
+    unsigned long long bytes;           //image bytes stored
+    unsigned long long ms;              //first write to finished image
+    unsigned long pages;                //pages in finished images
+    unsigned long cached;               //of those, resident in the page cache
+} io_counters;
+
+/*
+ * Where the reader thread may read() image data in place, published by the
+ * writer thread under a sequence lock. Only valid for the image numbered
+ * 'image' (count of images finished before it).
+ */
+typedef struct store_landing {
+    unsigned int   seq;                 //odd while being updated
+    unsigned char *map;
+    size_t         cap;
+    unsigned long  image;
+} store_landing;
+
+typedef struct tm_store tm_store;
+
+typedef struct store_ops {
+    const char *name;
+    int  (*image_prepare)(tm_store *st);                        //set up the next image early, may be NULL
+    int  (*image_write)(tm_store *st, const unsigned char *buf, size_t len);
+    int  (*image_write_at)(tm_store *st, const unsigned char *buf, size_t len, size_t off); //buffered data is flushed
+    int  (*image_flush)(tm_store *st);                          //write out buffered data
+    int  (*image_finish)(tm_store *st, const char *final_path); //flush, sync, rename, reopen
+    int  (*sidecar_write)(tm_store *st, const char *path, const char *buf, size_t len); //small file beside an image, synced like it
+    int  (*catalog_open)(tm_store *st);                         //header, cursor before </CATALOG>
+    int  (*catalog_write)(tm_store *st, const char *buf, size_t len);
+    int  (*catalog_discard)(tm_store *st, size_t len);          //drop the last len bytes written
+    int  (*catalog_close)(tm_store *st);                        //footer, sync, close
+    int  (*catalog_archive)(tm_store *st, const char *archive_path); //rename closed catalog
+    int  (*drain)(tm_store *st);                                //wait for I/O in flight, may be NULL
+    void (*close)(tm_store *st);
+} store_ops;
+
+struct tm_store {
+    const store_ops *ops;
+    flush_policy  policy;
+    char          image_path[TM_PATH_LEN];  //image_buf.tmp
+    char          current_xml[TM_PATH_LEN]; //imageindex.xml
+    size_t        pending;              //image bytes not yet written
+    size_t        img_end;              //end of the furthest image data, where writes append
+    unsigned long long pending_ms;      //when the oldest of them arrived
+    io_counters   img;
+    io_counters   pass;
+    unsigned long images;
+    unsigned long long img_start_ms;    //first write of the current image
+    size_t        expect;               //expected size of the next image, 0 unknown
+    store_landing landing;              //zero-copy target for the reader thread
+    int           no_landing;           //current image started off-protocol
+
+    /* stdio back-end */
+    FILE         *fp;
+    FILE         *outxml;
+    char         *iobuf;                //stdio buffer for fp, larger than flush_bytes
+    size_t        iobuf_size;
+
+    void         *priv;                 //other back-ends
+};
+
+FILE * openFile(char *name);
+
+int  store_open(tm_store *st, const char *backend, const char *image_path,
+                const char *current_xml, const flush_policy *policy);
+int  store_image_prepare(tm_store *st);
+int  store_image_write(tm_store *st, const unsigned char *buf, size_t len);
+int  store_image_write_at(tm_store *st, const unsigned char *buf, size_t len, size_t off);
+int  store_image_finish(tm_store *st, const char *final_path);
+int  store_sidecar_write(tm_store *st, const char *path, const char *buf, size_t len);
+int  store_idle(tm_store *st);
+int  store_drain(tm_store *st);
+void store_expect(tm_store *st, size_t bytes);
+
+/* zero-copy receive: writer publishes, reader asks for a place to read() into */
+void store_landing_set(tm_store *st, unsigned char *map, size_t cap);
+void store_landing_clear(tm_store *st);
+unsigned char * store_landing_get(tm_store *st, unsigned long image, size_t off, size_t len);
+void store_no_landing(tm_store *st);
+void store_close(tm_store *st);
+
+unsigned long long store_now_ms(void);
+void store_count_image(tm_store *st);
+int  store_pads(const char *backend);
+void store_mark_padded(tm_store *st, int fd);
+
+/* catalog and sidecars on stdio streams, shared by back-ends that only change image I/O */
+int  stdio_catalog_open(tm_store *st);
+int  stdio_catalog_write(tm_store *st, const char *buf, size_t len);
+int  stdio_catalog_discard(tm_store *st, size_t len);
+int  stdio_catalog_close(tm_store *st);
+int  stdio_catalog_archive(tm_store *st, const char *archive_path);
+int  stdio_sidecar_write(tm_store *st, const char *path, const char *buf, size_t len);
+
+int  store_uring_open(tm_store *st);
+int  store_direct_open(tm_store *st);
+int  store_mmap_open(tm_store *st);
+
+#endif /* STORAGE_H */
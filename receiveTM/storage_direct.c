@@ -0,0 +1,396 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : storage_direct.c
+ * Header(s)     : storage.h
+ * Description   : O_DIRECT storage back-end. Image frames are coalesced into
+ *                 one of two aligned buffers; each group commit hands the
+ *                 aligned part of the full buffer to an I/O thread and the
+ *                 unaligned remainder is carried over into the other buffer,
+ *                 so the writer keeps filling while the disk writes. Image
+ *                 data never enters the page cache, which leaves it to
+ *                 MOSES_TV.
+ *
+ *                 At the image terminator the tail is padded to a whole
+ *                 block, written, and the file truncated back to its real
+ *                 length. The catalog stays on stdio.
+ * Function(s)   : int store_direct_open(tm_store*)   - Allocate buffers, start I/O thread
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE                     //O_DIRECT
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "storage.h"
+#include "synclink.h"
+
+#define DIRECT_ALIGN 4096               //covers 512 and 4k logical blocks
+
+typedef struct direct_store {
+    int            fd;                  //image_buf.tmp
+    int            direct;              //O_DIRECT accepted by the filesystem
+    unsigned char *bufs[2];
+    size_t         buf_size;
+    size_t         fill;                //bytes in bufs[cur]
+    int            cur;
+    off_t          off;                 //file offset of bufs[cur][0]
+
+    /* one write handed to the I/O thread at a time */
+    pthread_t      io;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int            busy;
+    int            stop;
+    int            err;                 //errno of a failed write
+    const unsigned char *job_buf;
+    size_t         job_len;
+    off_t          job_off;
+} direct_store;
+
+static size_t align_up(size_t n) {
+    return (n + DIRECT_ALIGN - 1) & ~(size_t) (DIRECT_ALIGN - 1);
+}
+
+/* Write all of buf, retrying short writes */
+static int write_all(int fd, const unsigned char *buf, size_t len, off_t off) {
+    ssize_t rc;
+
+    while (len > 0) {
+        rc = pwrite(fd, buf, len, off);
+        if (rc < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += rc;
+        len -= rc;
+        off += rc;
+    }
+    return 0;
+}
+
+static void * direct_io_main(void *arg) {
+    direct_store *d = arg;
+
+    pthread_mutex_lock(&d->lock);
+    for (;;) {
+        while (!d->busy && !d->stop)
+            pthread_cond_wait(&d->cond, &d->lock);
+        if (!d->busy)
+            break;
+        pthread_mutex_unlock(&d->lock);
+
+        if (write_all(d->fd, d->job_buf, d->job_len, d->job_off) < 0)
+            d->err = errno;
+
+        pthread_mutex_lock(&d->lock);
+        d->busy = 0;
+        pthread_cond_broadcast(&d->cond);
+    }
+    pthread_mutex_unlock(&d->lock);
+    return NULL;
+}
+
+/* Wait for the I/O thread to finish the buffer it was given */
+static int direct_wait(tm_store *st) {
+    direct_store *d = st->priv;
+    int err;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->busy) {
+        st->img.waits++;
+        while (d->busy)
+            pthread_cond_wait(&d->cond, &d->lock);
+    }
+    err = d->err;
+    d->err = 0;
+    pthread_mutex_unlock(&d->lock);
+    if (err) {
+        printf("direct write error=%d %s\n", err, strerror(err));
+        return -1;
+    }
+    return 0;
+}
+
+static int direct_open_image(tm_store *st) {
+    direct_store *d = st->priv;
+
+    d->fd = open(st->image_path, O_RDWR | O_CREAT | O_TRUNC | (d->direct ? O_DIRECT : 0), 0644);  //read back by direct_patch()
+    if (d->fd < 0 && errno == EINVAL && d->direct) {
+        printf("O_DIRECT not supported for %s, using buffered writes\n", st->image_path);
+        d->direct = 0;
+        d->fd = open(st->image_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    }
+    st->img.meta++;
+    st->img.syscalls++;
+    if (d->fd < 0) {
+        printf("open error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    store_mark_padded(st, d->fd);
+    d->off = 0;
+    d->fill = 0;
+    return 0;
+}
+
+static int direct_image_flush(tm_store *st) {
+    direct_store *d = st->priv;
+    size_t len = d->fill & ~(size_t) (DIRECT_ALIGN - 1);
+    size_t tail = d->fill - len;
+    int next = !d->cur;
+
+    if (len == 0)
+        return 0;
+
+    /* the other buffer is free once its write is done */
+    if (direct_wait(st) < 0)
+        return -1;
+    memcpy(d->bufs[next], d->bufs[d->cur] + len, tail);
+
+    pthread_mutex_lock(&d->lock);
+    d->job_buf = d->bufs[d->cur];
+    d->job_len = len;
+    d->job_off = d->off;
+    d->busy = 1;
+    pthread_cond_signal(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+    st->img.writes++;
+    st->img.syscalls++;
+
+    d->off += len;
+    d->cur = next;
+    d->fill = tail;
+    return 0;
+}
+
+static int direct_image_write(tm_store *st, const unsigned char *buf, size_t len) {
+    direct_store *d = st->priv;
+
+    if (d->fill + len > d->buf_size && direct_image_flush(st) < 0)
+        return -1;
+    memcpy(d->bufs[d->cur] + d->fill, buf, len);
+    d->fill += len;
+    return 0;
+}
+
+/* Zeros into the buffers, for a hole O_DIRECT cannot seek over */
+static int direct_zero(tm_store *st, size_t len) {
+    direct_store *d = st->priv;
+    size_t n;
+
+    while (len > 0) {
+        n = len < DIRECT_ALIGN ? len : DIRECT_ALIGN;
+        if (d->fill + n > d->buf_size && direct_image_flush(st) < 0)
+            return -1;
+        memset(d->bufs[d->cur] + d->fill, 0, n);
+        d->fill += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Bytes already handed to the disk: read-modify-write the aligned blocks around them */
+static int direct_patch(tm_store *st, const unsigned char *buf, size_t len, off_t off) {
+    direct_store *d = st->priv;
+    off_t from = off & ~(off_t) (DIRECT_ALIGN - 1);
+    size_t span = align_up(off + len - from);
+    unsigned char *blk;
+    int rc = 0;
+
+    if (direct_wait(st) < 0)
+        return -1;
+    if (posix_memalign((void **) &blk, DIRECT_ALIGN, span) != 0) {
+        printf("direct buffer alloc error=%d %s\n", ENOMEM, strerror(ENOMEM));
+        return -1;
+    }
+    if (pread(d->fd, blk, span, from) != (ssize_t) span) {
+        printf("direct read error=%d %s\n", errno, strerror(errno));
+        rc = -1;
+    } else {
+        memcpy(blk + (off - from), buf, len);
+        if (write_all(d->fd, blk, span, from) < 0) {
+            printf("direct write error=%d %s\n", errno, strerror(errno));
+            rc = -1;
+        }
+    }
+    st->img.writes++;
+    st->img.syscalls += 2;
+    free(blk);
+    return rc;
+}
+
+/*
+ * Framed data off the end of the image. Past it, the hole is zero-filled in
+ * the buffers. Behind it, the part still buffered is patched there and the
+ * part on disk block by block; d->off is aligned, so those never share a block.
+ */
+static int direct_image_write_at(tm_store *st, const unsigned char *buf, size_t len, size_t off) {
+    direct_store *d = st->priv;
+    size_t end = d->off + d->fill;
+    size_t n;
+
+    if (off >= end) {
+        if (direct_zero(st, off - end) < 0)
+            return -1;
+        return direct_image_write(st, buf, len);
+    }
+    if (off < (size_t) d->off) {
+        n = len < d->off - off ? len : d->off - off;
+        if (direct_patch(st, buf, n, off) < 0)
+            return -1;
+        buf += n;
+        off += n;
+        len -= n;
+    }
+    n = len < end - off ? len : end - off;
+    memcpy(d->bufs[d->cur] + (off - d->off), buf, n);
+    if (len > n)
+        return direct_image_write(st, buf + n, len - n);
+    return 0;
+}
+
+/* Pad the unaligned tail to a block, write it, and cut the file back */
+static int direct_write_tail(tm_store *st) {
+    direct_store *d = st->priv;
+    size_t len = align_up(d->fill);
+
+    if (direct_wait(st) < 0)
+        return -1;
+    if (d->fill == 0)
+        return 0;
+    memset(d->bufs[d->cur] + d->fill, 0, len - d->fill);
+    if (write_all(d->fd, d->bufs[d->cur], len, d->off) < 0) {
+        printf("direct write error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    st->img.writes++;
+    st->img.syscalls++;
+    if (len != d->fill) {
+        if (ftruncate(d->fd, d->off + d->fill) < 0) {
+            printf("ftruncate error=%d %s\n", errno, strerror(errno));
+            return -1;
+        }
+        st->img.syscalls++;
+    }
+    d->off += d->fill;
+    d->fill = 0;
+    return 0;
+}
+
+static int direct_image_finish(tm_store *st, const char *final_path) {
+    direct_store *d = st->priv;
+
+    if (direct_image_flush(st) < 0 || direct_write_tail(st) < 0)
+        return -1;
+    if (st->policy.sync_image) {
+        fdatasync(d->fd);               //the truncate is metadata
+        st->img.syncs++;
+        st->img.syscalls++;
+    }
+    close(d->fd);
+    d->fd = -1;
+    rename(st->image_path, final_path);
+    st->img.meta     += 2;
+    st->img.syscalls += 2;
+    return direct_open_image(st);
+}
+
+static int direct_drain(tm_store *st) {
+    return direct_wait(st);
+}
+
+static void direct_close(tm_store *st) {
+    direct_store *d = st->priv;
+
+    if (d == NULL)
+        return;
+    if (d->fd >= 0) {
+        direct_write_tail(st);
+        close(d->fd);
+    }
+    pthread_mutex_lock(&d->lock);
+    d->stop = 1;
+    pthread_cond_signal(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+    pthread_join(d->io, NULL);
+    if (st->outxml != NULL)
+        fclose(st->outxml);
+    st->outxml = NULL;
+
+    free(d->bufs[0]);
+    free(d->bufs[1]);
+    free(d);
+    st->priv = NULL;
+}
+
+static const store_ops direct_ops = {
+    "direct",
+    NULL,
+    direct_image_write,
+    direct_image_write_at,
+    direct_image_flush,
+    direct_image_finish,
+    stdio_sidecar_write,
+    stdio_catalog_open,
+    stdio_catalog_write,
+    stdio_catalog_discard,
+    stdio_catalog_close,
+    stdio_catalog_archive,
+    direct_drain,
+    direct_close,
+};
+
+int store_direct_open(tm_store *st) {
+    direct_store *d;
+    sigset_t all, old;
+    int i;
+
+    d = calloc(1, sizeof (*d));
+    if (d == NULL) {
+        printf("direct alloc error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    d->fd = -1;
+    d->direct = 1;
+    st->priv = d;
+    st->ops = &direct_ops;
+
+    /* a group commit plus the frame that crosses it, plus a carried-over tail */
+    d->buf_size = align_up(st->policy.flush_bytes + HDLC_MAX_FRAME_SIZE + 1) + DIRECT_ALIGN;
+    for (i = 0; i < 2; i++) {
+        if (posix_memalign((void **) &d->bufs[i], DIRECT_ALIGN, d->buf_size) != 0) {
+            printf("direct buffer alloc error=%d %s\n", ENOMEM, strerror(ENOMEM));
+            return -1;
+        }
+        memset(d->bufs[i], 0, d->buf_size);     //pre-fault
+    }
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_cond_init(&d->cond, NULL);
+
+    /* the I/O thread never takes signals; Ctrl-C belongs to the reader */
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    i = pthread_create(&d->io, NULL, direct_io_main, d);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (i != 0) {
+        printf("pthread_create error=%d %s\n", i, strerror(i));
+        return -1;
+    }
+
+    printf("direct storage: 2 x %zu byte buffers, %d byte alignment\n", d->buf_size, DIRECT_ALIGN);
+    return direct_open_image(st);
+}
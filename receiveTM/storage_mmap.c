@@ -0,0 +1,318 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : storage_mmap.c
+ * Header(s)     : storage.h
+ * Description   : Memory-mapped storage back-end. Once the catalog entry of
+ *                 the previous image is in (or at the first frame of an
+ *                 image at the latest), image_buf.tmp is fallocate'd to the size
+ *                 the catalog geometry predicts (store_expect()) and mapped
+ *                 shared; frames are copied straight into the mapping at
+ *                 their offset. There are no write() calls and no per-frame
+ *                 file growth; a group commit costs nothing (with -S it starts
+ *                 writeback of the committed range with sync_file_range()),
+ *                 and completing an image is msync, truncate to the received
+ *                 length and rename.
+ *
+ *                 The mapping is published as a landing zone (store_landing_set())
+ *                 so the reader thread can read() image frames straight into
+ *                 place; such frames are recognised here by their address
+ *                 and cost no copy at all.
+ *
+ *                 An image larger than predicted grows the file and the
+ *                 mapping by half the expected size at a time, which ends
+ *                 in-place reads for that image. The catalog stays on stdio.
+ * Function(s)   : int store_mmap_open(tm_store*)   - Select the mmap back-end
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE                     //fallocate, mremap, sync_file_range
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "storage.h"
+#include "synclink.h"
+#include "logger.h"
+
+#define MMAP_MIN_BYTES (1 << 20)        //when there is no geometry to go on
+
+typedef struct mmap_store {
+    int            fd;                  //image_buf.tmp, -1 until the first frame
+    unsigned char *map;
+    size_t         cap;                 //bytes allocated and mapped
+    size_t         off;                 //bytes received
+    size_t         synced;              //bytes handed to writeback
+    int            grew;                //current image outgrew its prediction
+    unsigned long  grows;               //images that did
+    unsigned long long landed;          //image bytes the reader put in place
+    unsigned long long copied;          //image bytes copied from ring slots
+} mmap_store;
+
+/* Allocate the file blocks for [0, len) and set the file size */
+static int mmap_allocate(mmap_store *m, size_t len) {
+    if (fallocate(m->fd, 0, 0, len) == 0)
+        return 0;
+    if (errno != EOPNOTSUPP) {
+        printf("fallocate error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    /* filesystem without fallocate: a sparse file still avoids per-write growth */
+    if (ftruncate(m->fd, len) < 0) {
+        printf("ftruncate error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* Create image_buf.tmp at the predicted size, plus room for the terminator to land, and map it */
+static int mmap_open_image(tm_store *st) {
+    mmap_store *m = st->priv;
+    long page = sysconf(_SC_PAGESIZE);
+    size_t len = st->expect > MMAP_MIN_BYTES ? st->expect : MMAP_MIN_BYTES;
+
+    len = (len + HDLC_MAX_FRAME_SIZE + page - 1) / page * page;
+
+    m->fd = open(st->image_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    st->img.meta++;
+    st->img.syscalls++;
+    if (m->fd < 0) {
+        printf("open error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    store_mark_padded(st, m->fd);
+    if (mmap_allocate(m, len) < 0)
+        return -1;
+    m->map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m->fd, 0);
+    st->img.syscalls += 2;
+    if (m->map == MAP_FAILED) {
+        printf("mmap error=%d %s\n", errno, strerror(errno));
+        m->map = NULL;
+        return -1;
+    }
+    m->cap = len;
+    m->off = 0;
+    m->synced = 0;
+    m->grew = 0;
+    store_landing_set(st, m->map, m->cap);
+    return 0;
+}
+
+/* The prediction was short: extend the file and the mapping */
+static int mmap_grow(tm_store *st, size_t need) {
+    mmap_store *m = st->priv;
+    size_t step = (st->expect > MMAP_MIN_BYTES ? st->expect : MMAP_MIN_BYTES) / 2;
+    size_t len = m->cap;
+    void *map;
+
+    while (len < need)
+        len += step;
+
+    /* the mapping may move: no more in-place reads for this image */
+    store_landing_clear(st);
+    if (mmap_allocate(m, len) < 0)
+        return -1;
+    map = mremap(m->map, m->cap, len, MREMAP_MAYMOVE);
+    st->img.syscalls += 2;
+    if (map == MAP_FAILED) {
+        printf("mremap error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    if (!m->grew)
+        m->grows++;
+    m->grew = 1;
+    m->map = map;
+    m->cap = len;
+    return 0;
+}
+
+/* Map the next image as soon as its size is known, so the reader can land in it */
+static int mmap_image_prepare(tm_store *st) {
+    mmap_store *m = st->priv;
+
+    if (m->fd >= 0)
+        return 0;
+    return mmap_open_image(st);
+}
+
+static int mmap_image_write(tm_store *st, const unsigned char *buf, size_t len) {
+    mmap_store *m = st->priv;
+
+    if (m->fd < 0 && mmap_open_image(st) < 0)
+        return -1;
+    if (buf == m->map + m->off) {
+        m->off += len;                  //read in place by the reader thread
+        m->landed += len;
+        return 0;
+    }
+    if (buf >= m->map && buf < m->map + m->cap) {
+        /* the reader's offset disagreed with ours; cannot happen within the protocol */
+        log_msg("mmap storage: frame landed at %zu, expected %zu\n", (size_t) (buf - m->map), m->off);
+        if (m->off + len > m->cap)
+            return -1;
+        memmove(m->map + m->off, buf, len);
+        m->off += len;
+        m->copied += len;
+        return 0;
+    }
+    if (m->off + len > m->cap && mmap_grow(st, m->off + len) < 0)
+        return -1;
+    memcpy(m->map + m->off, buf, len);
+    m->off += len;
+    m->copied += len;
+    return 0;
+}
+
+/* Framed data off the end of the image goes straight to its offset; the file is zero where nothing came */
+static int mmap_image_write_at(tm_store *st, const unsigned char *buf, size_t len, size_t off) {
+    mmap_store *m = st->priv;
+
+    if (m->fd < 0 && mmap_open_image(st) < 0)
+        return -1;
+    if (off + len > m->cap && mmap_grow(st, off + len) < 0)
+        return -1;
+    memcpy(m->map + off, buf, len);
+    if (off + len > m->off)
+        m->off = off + len;
+    if (off < m->synced)
+        m->synced = off;                //written behind the last commit: commit it again
+    m->copied += len;
+    return 0;
+}
+
+/*
+ * Data is already in the page cache, so a process crash loses nothing past the
+ * last frame. With -S a commit also starts writeback of the committed range.
+ */
+static int mmap_image_flush(tm_store *st) {
+    mmap_store *m = st->priv;
+
+    if (m->fd < 0 || m->off == m->synced)
+        return 0;
+    if (!st->policy.sync_image) {
+        m->synced = m->off;
+        return 0;
+    }
+    if (sync_file_range(m->fd, m->synced, m->off - m->synced, SYNC_FILE_RANGE_WRITE) < 0) {
+        printf("sync_file_range error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    m->synced = m->off;
+    st->img.writes++;
+    st->img.syscalls++;
+    return 0;
+}
+
+/* msync, cut the preallocation back to what arrived, unmap and close */
+static int mmap_close_image(tm_store *st) {
+    mmap_store *m = st->priv;
+    int rc = 0;
+
+    store_landing_clear(st);
+    if (m->map != NULL) {
+        if (msync(m->map, m->cap, st->policy.sync_image ? MS_SYNC : MS_ASYNC) < 0) {
+            printf("msync error=%d %s\n", errno, strerror(errno));
+            rc = -1;
+        }
+        if (st->policy.sync_image)
+            st->img.syncs++;
+        munmap(m->map, m->cap);
+        st->img.syscalls += 2;
+        m->map = NULL;
+    }
+    if (m->off != m->cap) {
+        if (ftruncate(m->fd, m->off) < 0) {
+            printf("ftruncate error=%d %s\n", errno, strerror(errno));
+            rc = -1;
+        }
+        st->img.syscalls++;
+    }
+    close(m->fd);
+    m->fd = -1;
+    m->cap = 0;
+    st->img.meta++;
+    st->img.syscalls++;
+    return rc;
+}
+
+static int mmap_image_finish(tm_store *st, const char *final_path) {
+    mmap_store *m = st->priv;
+
+    /* a terminator with no data still leaves an (empty) image */
+    if (m->fd < 0) {
+        m->fd = open(st->image_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        st->img.meta++;
+        st->img.syscalls++;
+        if (m->fd < 0) {
+            printf("open error=%d %s\n", errno, strerror(errno));
+            return -1;
+        }
+    }
+    if (mmap_close_image(st) < 0)
+        return -1;
+    rename(st->image_path, final_path);
+    st->img.meta++;
+    st->img.syscalls++;
+    return 0;
+}
+
+static void mmap_close(tm_store *st) {
+    mmap_store *m = st->priv;
+
+    if (m == NULL)
+        return;
+    if (m->fd >= 0)
+        mmap_close_image(st);
+    if (m->grows > 0)
+        printf("mmap storage: %lu images larger than the catalog geometry\n", m->grows);
+    if (m->landed + m->copied > 0)
+        printf("mmap storage: %.1f of %.1f MB read in place, %.1f MB copied\n",
+                m->landed / 1e6, (m->landed + m->copied) / 1e6, m->copied / 1e6);
+    if (st->outxml != NULL)
+        fclose(st->outxml);
+    st->outxml = NULL;
+    free(m);
+    st->priv = NULL;
+}
+
+static const store_ops mmap_ops = {
+    "mmap",
+    mmap_image_prepare,
+    mmap_image_write,
+    mmap_image_write_at,
+    mmap_image_flush,
+    mmap_image_finish,
+    stdio_sidecar_write,
+    stdio_catalog_open,
+    stdio_catalog_write,
+    stdio_catalog_discard,
+    stdio_catalog_close,
+    stdio_catalog_archive,
+    NULL,                               //msync() in image_finish leaves nothing in flight
+    mmap_close,
+};
+
+int store_mmap_open(tm_store *st) {
+    mmap_store *m;
+
+    m = calloc(1, sizeof (*m));
+    if (m == NULL) {
+        printf("mmap alloc error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    m->fd = -1;
+    st->priv = m;
+    st->ops = &mmap_ops;
+    return 0;
+}
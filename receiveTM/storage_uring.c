@@ -0,0 +1,749 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : storage_uring.c
+ * Header(s)     : storage.h
+ * Description   : io_uring storage back-end. Image data is copied into a
+ *                 small pool of registered buffers; each group commit queues
+ *                 a WRITE_FIXED at the image offset and the writer thread
+ *                 moves on without waiting for it. At the image terminator
+ *                 the last write, fdatasync, rename and close are queued as
+ *                 one linked chain, so completing an image costs a single
+ *                 io_uring_enter(). The writer only blocks when every buffer
+ *                 is still in flight, which is counted as a wait.
+ *
+ *                 Catalog entries are staged in memory and written together
+ *                 with the footer, again as a linked write/fdatasync/close.
+ *                 An image's sidecar (its digest) is one more such chain,
+ *                 drained behind the image's own.
+ *
+ *                 Uses the raw syscalls so no liburing is needed; falls back
+ *                 to plain IORING_OP_WRITE if the buffers cannot be
+ *                 registered (RLIMIT_MEMLOCK).
+ * Function(s)   : int store_uring_open(tm_store*)   - Set up the ring and buffers
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include "storage.h"
+#include "synclink.h"
+
+#define URING_ENTRIES 64
+#define URING_BUFS    4                 //image writes in flight
+
+/* user_data: operation in the high bits, buffer index in the low */
+#define UD(op, idx)   (((__u64) (op) << 16) | (idx))
+#define UD_OP(ud)     ((unsigned) ((ud) >> 16))
+#define UD_IDX(ud)    ((unsigned) ((ud) & 0xffff))
+
+enum {
+    OP_WRITE = 1,                       //image data
+    OP_LAST,                            //image data heading a finish chain
+    OP_SYNC,
+    OP_RENAME,
+    OP_CLOSE,
+    OP_CAT_WRITE,
+    OP_CAT_SYNC,
+    OP_CAT_CLOSE,
+    OP_SIDE_WRITE,
+    OP_SIDE_SYNC,
+    OP_SIDE_CLOSE,
+};
+
+static const char *op_names[] = {
+    "", "write", "write", "fdatasync", "rename", "close",
+    "catalog write", "catalog fdatasync", "catalog close",
+    "sidecar write", "sidecar fdatasync", "sidecar close"
+};
+
+static const char catalog_header[] =
+        "<?xml version=\"1.0\" encoding=\"ASCII\" standalone=\"yes\"?>\n"
+        "<CATALOG>\n\n";
+static const char catalog_footer[] = "</CATALOG>\n";
+
+typedef struct uring_buf {
+    size_t fill;                        //bytes copied in
+    size_t done;                        //bytes the kernel has written
+    off_t  off;                         //image offset of the first byte
+    int    busy;                        //write in flight
+} uring_buf;
+
+typedef struct uring_store {
+    int            ring_fd;
+    unsigned       sq_entries;
+    unsigned      *sq_head;
+    unsigned      *sq_tail;
+    unsigned      *sq_mask;
+    unsigned      *sq_array;
+    unsigned      *cq_head;
+    unsigned      *cq_tail;
+    unsigned      *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void          *sq_ptr;
+    void          *cq_ptr;
+    size_t         sq_size;
+    size_t         cq_size;
+    unsigned       to_submit;
+
+    int            fixed;               //buffers registered with the ring
+    unsigned char *pool;
+    size_t         buf_size;
+    uring_buf      bufs[URING_BUFS];
+    int            cur;                 //buffer being filled
+
+    int            fd;                  //image_buf.tmp, -1 until first needed
+    off_t          off;                 //image offset of the current buffer
+    int            chain;               //finish operations in flight
+    char           final_path[TM_PATH_LEN];
+
+    int            cat_fd;
+    char          *cat;                 //staged entries and footer
+    size_t         cat_len;
+    size_t         cat_size;
+    int            cat_busy;            //catalog operations in flight
+
+    char           side[TM_PATH_LEN + 128]; //sidecar contents until written
+    int            side_busy;           //sidecar operations in flight
+
+    int            failed;
+} uring_store;
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static unsigned char * buf_data(uring_store *u, int idx) {
+    return u->pool + (size_t) idx * u->buf_size;
+}
+
+/* Submit queued SQEs, optionally waiting for at least one completion */
+static int uring_enter(tm_store *st, io_counters *c, unsigned min_complete) {
+    uring_store *u = st->priv;
+    int rc;
+
+    do {
+        rc = sys_io_uring_enter(u->ring_fd, u->to_submit, min_complete,
+                min_complete ? IORING_ENTER_GETEVENTS : 0);
+    } while (rc < 0 && errno == EINTR);
+    c->syscalls++;
+    if (min_complete)
+        c->waits++;
+    if (rc < 0) {
+        printf("io_uring_enter error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    u->to_submit -= (unsigned) rc;
+    return 0;
+}
+
+static struct io_uring_sqe * uring_sqe(tm_store *st, io_counters *c) {
+    uring_store *u = st->priv;
+    struct io_uring_sqe *sqe;
+    unsigned tail = *u->sq_tail;
+
+    /* the ring is far bigger than what can be in flight; submit if it ever fills */
+    if (tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries &&
+            uring_enter(st, c, 0) < 0)
+        return NULL;
+
+    sqe = &u->sqes[tail & *u->sq_mask];
+    memset(sqe, 0, sizeof (*sqe));
+    u->sq_array[tail & *u->sq_mask] = tail & *u->sq_mask;
+    __atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    u->to_submit++;
+    return sqe;
+}
+
+/* Queue a write of buffer idx from its first unwritten byte */
+static int queue_write(tm_store *st, io_counters *c, int idx, int op, unsigned flags) {
+    uring_store *u = st->priv;
+    uring_buf *b = &u->bufs[idx];
+    struct io_uring_sqe *sqe = uring_sqe(st, c);
+
+    if (sqe == NULL)
+        return -1;
+    sqe->opcode = u->fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->flags = flags;
+    sqe->fd = u->fd;
+    sqe->off = b->off + b->done;
+    sqe->addr = (__u64) (unsigned long) (buf_data(u, idx) + b->done);
+    sqe->len = b->fill - b->done;
+    sqe->buf_index = idx;
+    sqe->user_data = UD(op, idx);
+    b->busy = 1;
+    return 0;
+}
+
+static void uring_complete(tm_store *st, struct io_uring_cqe *cqe) {
+    uring_store *u = st->priv;
+    unsigned op = UD_OP(cqe->user_data);
+    uring_buf *b;
+
+    if (op == OP_WRITE || op == OP_LAST) {
+        b = &u->bufs[UD_IDX(cqe->user_data)];
+        if (cqe->res >= 0)
+            b->done += cqe->res;
+        if (cqe->res > 0 && b->done < b->fill && op == OP_WRITE &&
+                queue_write(st, &st->img, UD_IDX(cqe->user_data), OP_WRITE, 0) == 0)
+            return;                     //short write, the rest goes out with the next enter
+        if (cqe->res < 0 || b->done < b->fill) {
+            printf("io_uring %s error=%d %s\n", op_names[op], -cqe->res,
+                    strerror(cqe->res < 0 ? -cqe->res : EIO));
+            u->failed = 1;
+        }
+        b->busy = 0;
+        b->fill = 0;
+        b->done = 0;
+        return;
+    }
+
+    if (op >= OP_SIDE_WRITE)
+        u->side_busy--;
+    else if (op >= OP_CAT_WRITE)
+        u->cat_busy--;
+    else
+        u->chain--;
+    if (cqe->res < 0) {
+        printf("io_uring %s error=%d %s\n", op_names[op], -cqe->res, strerror(-cqe->res));
+        u->failed = 1;
+    }
+}
+
+/* Handle every completion already posted, without a syscall */
+static void uring_reap(tm_store *st) {
+    uring_store *u = st->priv;
+    unsigned head = *u->cq_head;
+
+    while (head != __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) {
+        uring_complete(st, &u->cqes[head & *u->cq_mask]);
+        head++;
+        __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    }
+}
+
+/* Reap until *count drops to zero */
+static int uring_wait(tm_store *st, io_counters *c, int *count) {
+    uring_store *u = st->priv;
+
+    uring_reap(st);
+    while (*count > 0) {
+        if (uring_enter(st, c, 1) < 0)
+            return -1;
+        uring_reap(st);
+    }
+    return u->failed ? -1 : 0;
+}
+
+/* Open image_buf.tmp once the previous image has been renamed away from it */
+static int image_fd(tm_store *st) {
+    uring_store *u = st->priv;
+
+    if (u->fd >= 0)
+        return 0;
+    if (uring_wait(st, &st->img, &u->chain) < 0)
+        return -1;
+    u->fd = open(st->image_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    st->img.meta++;
+    st->img.syscalls++;
+    if (u->fd < 0) {
+        printf("open error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    u->off = 0;
+    return 0;
+}
+
+/* Pick a free buffer to fill next, waiting only if all of them are in flight */
+static int next_buf(tm_store *st) {
+    uring_store *u = st->priv;
+    int i;
+
+    for (;;) {
+        uring_reap(st);
+        for (i = 0; i < URING_BUFS; i++) {
+            if (!u->bufs[i].busy) {
+                u->cur = i;
+                u->bufs[i].off = u->off;
+                return u->failed ? -1 : 0;
+            }
+        }
+        if (uring_enter(st, &st->img, 1) < 0)
+            return -1;
+    }
+}
+
+/* Queue the current buffer; flags let it head the finish chain */
+static int submit_buf(tm_store *st, int op, unsigned flags) {
+    uring_store *u = st->priv;
+    uring_buf *b = &u->bufs[u->cur];
+
+    if (image_fd(st) < 0)
+        return -1;
+    b->off = u->off;
+    if (queue_write(st, &st->img, u->cur, op, flags) < 0)
+        return -1;
+    u->off += b->fill;
+    st->img.writes++;
+    return 0;
+}
+
+static int uring_image_flush(tm_store *st) {
+    uring_store *u = st->priv;
+
+    if (u->bufs[u->cur].fill == 0)
+        return 0;
+    if (submit_buf(st, OP_WRITE, 0) < 0 || uring_enter(st, &st->img, 0) < 0)
+        return -1;
+    return next_buf(st);
+}
+
+static int uring_image_write(tm_store *st, const unsigned char *buf, size_t len) {
+    uring_store *u = st->priv;
+    uring_buf *b = &u->bufs[u->cur];
+
+    if (b->fill + len > u->buf_size) {
+        if (uring_image_flush(st) < 0)
+            return -1;
+        b = &u->bufs[u->cur];
+    }
+    memcpy(buf_data(u, u->cur) + b->fill, buf, len);
+    b->fill += len;
+    return u->failed ? -1 : 0;
+}
+
+/*
+ * Framed data off the end of the image; the current buffer is empty. Past the
+ * end the next buffer simply starts further on, leaving a hole. A hole behind
+ * is filled with a plain pwrite(): no write in flight covers it.
+ */
+static int uring_image_write_at(tm_store *st, const unsigned char *buf, size_t len, size_t off) {
+    uring_store *u = st->priv;
+
+    if (off >= st->img_end) {
+        u->off = off;
+        u->bufs[u->cur].off = off;
+        return uring_image_write(st, buf, len);
+    }
+    if (image_fd(st) < 0)
+        return -1;
+    if (pwrite(u->fd, buf, len, off) != (ssize_t) len) {
+        printf("pwrite error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    st->img.writes++;
+    st->img.syscalls++;
+    return 0;
+}
+
+/* Last write, fdatasync, rename and close as one linked chain */
+static int uring_image_finish(tm_store *st, const char *final_path) {
+    uring_store *u = st->priv;
+    struct io_uring_sqe *sqe;
+    unsigned flags = IOSQE_IO_DRAIN;    //first link waits for all earlier writes
+
+    if (image_fd(st) < 0)
+        return -1;
+    snprintf(u->final_path, sizeof (u->final_path), "%s", final_path);
+
+    if (u->bufs[u->cur].fill > 0) {
+        if (submit_buf(st, OP_LAST, flags | IOSQE_IO_LINK) < 0)
+            return -1;
+        flags = 0;
+    }
+    if (st->policy.sync_image) {
+        if ((sqe = uring_sqe(st, &st->img)) == NULL)
+            return -1;
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->flags = flags | IOSQE_IO_LINK;
+        sqe->fd = u->fd;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        sqe->user_data = UD(OP_SYNC, 0);
+        u->chain++;
+        st->img.syncs++;
+        flags = 0;
+    }
+    if ((sqe = uring_sqe(st, &st->img)) == NULL)
+        return -1;
+    sqe->opcode = IORING_OP_RENAMEAT;
+    sqe->flags = flags | IOSQE_IO_LINK;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (__u64) (unsigned long) st->image_path;
+    sqe->len = (__u32) AT_FDCWD;
+    sqe->off = (__u64) (unsigned long) u->final_path;
+    sqe->user_data = UD(OP_RENAME, 0);
+    u->chain++;
+
+    if ((sqe = uring_sqe(st, &st->img)) == NULL)
+        return -1;
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = u->fd;
+    sqe->user_data = UD(OP_CLOSE, 0);
+    u->chain++;
+    st->img.meta += 2;
+
+    u->fd = -1;
+    if (uring_enter(st, &st->img, 0) < 0)
+        return -1;
+    return next_buf(st);
+}
+
+/*
+ * Sidecar write, fdatasync and close as one linked chain, held back until the
+ * image before it is renamed; the open stays synchronous like the catalog's
+ */
+static int uring_sidecar_write(tm_store *st, const char *path, const char *buf, size_t len) {
+    uring_store *u = st->priv;
+    struct io_uring_sqe *sqe;
+    int fd;
+
+    if (len > sizeof (u->side))
+        return stdio_sidecar_write(st, path, buf, len);
+    if (uring_wait(st, &st->pass, &u->side_busy) < 0)
+        return -1;
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    st->pass.meta++;
+    st->pass.syscalls++;
+    if (fd < 0) {
+        printf("open %s error=%d %s\n", path, errno, strerror(errno));
+        return -1;
+    }
+    memcpy(u->side, buf, len);
+
+    if ((sqe = uring_sqe(st, &st->pass)) == NULL)
+        return -1;
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->flags = IOSQE_IO_DRAIN | IOSQE_IO_LINK;
+    sqe->fd = fd;
+    sqe->off = 0;
+    sqe->addr = (__u64) (unsigned long) u->side;
+    sqe->len = len;
+    sqe->user_data = UD(OP_SIDE_WRITE, 0);
+    u->side_busy++;
+
+    if (st->policy.sync_image) {
+        if ((sqe = uring_sqe(st, &st->pass)) == NULL)
+            return -1;
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->flags = IOSQE_IO_LINK;
+        sqe->fd = fd;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        sqe->user_data = UD(OP_SIDE_SYNC, 0);
+        u->side_busy++;
+        st->pass.syncs++;
+    }
+
+    if ((sqe = uring_sqe(st, &st->pass)) == NULL)
+        return -1;
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    sqe->user_data = UD(OP_SIDE_CLOSE, 0);
+    u->side_busy++;
+    st->pass.meta++;
+    return uring_enter(st, &st->pass, 0);
+}
+
+/* Catalog header goes out at once; entries are staged until the footer */
+static int uring_catalog_open(tm_store *st) {
+    uring_store *u = st->priv;
+    struct io_uring_sqe *sqe;
+
+    if (uring_wait(st, &st->pass, &u->cat_busy) < 0)
+        return -1;
+    u->cat_fd = open(st->current_xml, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    st->pass.meta++;
+    st->pass.syscalls++;
+    if (u->cat_fd < 0) {
+        printf("open error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+
+    /* an empty but valid catalog, like the stdio back-end leaves */
+    if ((sqe = uring_sqe(st, &st->pass)) == NULL)
+        return -1;
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = u->cat_fd;
+    sqe->off = 0;
+    sqe->addr = (__u64) (unsigned long) catalog_header;
+    sqe->len = sizeof (catalog_header) - 1 + sizeof (catalog_footer) - 1;
+    sqe->user_data = UD(OP_CAT_WRITE, 0);
+    u->cat_busy++;
+    u->cat_len = 0;
+    return uring_enter(st, &st->pass, 0);
+}
+
+static int uring_catalog_write(tm_store *st, const char *buf, size_t len) {
+    uring_store *u = st->priv;
+    char *cat;
+
+    if (u->cat_len + len > u->cat_size) {
+        cat = realloc(u->cat, (u->cat_len + len) * 2);
+        if (cat == NULL) {
+            printf("catalog alloc error=%d %s\n", errno, strerror(errno));
+            return -1;
+        }
+        u->cat = cat;
+        u->cat_size = (u->cat_len + len) * 2;
+    }
+    memcpy(u->cat + u->cat_len, buf, len);
+    u->cat_len += len;
+    return 0;
+}
+
+/* Entries are only staged until the footer, so dropping one costs nothing */
+static int uring_catalog_discard(tm_store *st, size_t len) {
+    uring_store *u = st->priv;
+
+    u->cat_len = len < u->cat_len ? u->cat_len - len : 0;
+    return 0;
+}
+
+static int uring_catalog_close(tm_store *st) {
+    uring_store *u = st->priv;
+    struct io_uring_sqe *sqe;
+
+    if (u->cat_fd < 0)
+        return 0;
+    if (uring_catalog_write(st, catalog_footer, sizeof (catalog_footer) - 1) < 0)
+        return -1;
+
+    /* entries overwrite the footer written by uring_catalog_open() */
+    if ((sqe = uring_sqe(st, &st->pass)) == NULL)
+        return -1;
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->fd = u->cat_fd;
+    sqe->off = sizeof (catalog_header) - 1;
+    sqe->addr = (__u64) (unsigned long) u->cat;
+    sqe->len = u->cat_len;
+    sqe->user_data = UD(OP_CAT_WRITE, 0);
+    u->cat_busy++;
+
+    if (st->policy.sync_image) {
+        if ((sqe = uring_sqe(st, &st->pass)) == NULL)
+            return -1;
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->flags = IOSQE_IO_LINK;
+        sqe->fd = u->cat_fd;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        sqe->user_data = UD(OP_CAT_SYNC, 0);
+        u->cat_busy++;
+        st->pass.syncs++;
+    }
+
+    if ((sqe = uring_sqe(st, &st->pass)) == NULL)
+        return -1;
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = u->cat_fd;
+    sqe->user_data = UD(OP_CAT_CLOSE, 0);
+    u->cat_busy++;
+    st->pass.meta++;
+
+    u->cat_fd = -1;
+    return uring_enter(st, &st->pass, 0);
+}
+
+/* The next catalog opens right after this, so the rename itself stays synchronous */
+static int uring_catalog_archive(tm_store *st, const char *archive_path) {
+    uring_store *u = st->priv;
+
+    if (uring_wait(st, &st->pass, &u->cat_busy) < 0)
+        return -1;
+    rename(st->current_xml, archive_path);
+    st->pass.meta++;
+    st->pass.syscalls++;
+    return 0;
+}
+
+/*
+ * Wait for everything in flight. Deferred and linked requests are run by the
+ * task that submitted them, so the writer thread must call this before it exits.
+ */
+static int uring_drain(tm_store *st) {
+    uring_store *u = st->priv;
+    int busy;
+    int i;
+
+    if (uring_wait(st, &st->img, &u->chain) < 0 ||
+            uring_wait(st, &st->pass, &u->cat_busy) < 0 ||
+            uring_wait(st, &st->pass, &u->side_busy) < 0)
+        return -1;
+    for (;;) {
+        uring_reap(st);
+        for (busy = 0, i = 0; i < URING_BUFS; i++)
+            busy += u->bufs[i].busy;
+        if (busy == 0)
+            break;
+        if (uring_enter(st, &st->img, 1) < 0)
+            return -1;
+    }
+    return u->failed ? -1 : 0;
+}
+
+static void uring_close(tm_store *st) {
+    uring_store *u = st->priv;
+
+    if (u == NULL)
+        return;
+
+    /* write out what is buffered and wait for everything in flight */
+    uring_image_flush(st);
+    st->pending = 0;
+    if (u->cat_fd >= 0)
+        uring_catalog_close(st);
+    uring_drain(st);
+    if (u->fd >= 0) {
+        close(u->fd);
+        st->img.meta++;
+        st->img.syscalls++;
+    }
+
+    munmap(u->sqes, URING_ENTRIES * sizeof (struct io_uring_sqe));
+    if (u->cq_ptr != u->sq_ptr)
+        munmap(u->cq_ptr, u->cq_size);
+    munmap(u->sq_ptr, u->sq_size);
+    close(u->ring_fd);
+    free(u->pool);
+    free(u->cat);
+    free(u);
+    st->priv = NULL;
+}
+
+static const store_ops uring_ops = {
+    "uring",
+    NULL,
+    uring_image_write,
+    uring_image_write_at,
+    uring_image_flush,
+    uring_image_finish,
+    uring_sidecar_write,
+    uring_catalog_open,
+    uring_catalog_write,
+    uring_catalog_discard,
+    uring_catalog_close,
+    uring_catalog_archive,
+    uring_drain,
+    uring_close,
+};
+
+int store_uring_open(tm_store *st) {
+    struct io_uring_params p;
+    struct iovec iov[URING_BUFS];
+    uring_store *u;
+    unsigned char *sq;
+    unsigned char *cq;
+    int i;
+
+    u = calloc(1, sizeof (*u));
+    if (u == NULL) {
+        printf("io_uring alloc error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    u->fd = -1;
+    u->cat_fd = -1;
+    st->priv = u;
+
+    memset(&p, 0, sizeof (p));
+    u->ring_fd = sys_io_uring_setup(URING_ENTRIES, &p);
+    if (u->ring_fd < 0) {
+        printf("io_uring_setup error=%d %s\n", errno, strerror(errno));
+        free(u);
+        st->priv = NULL;
+        return -1;
+    }
+
+    /* map the submission and completion rings and the SQE array */
+    u->sq_size = p.sq_off.array + p.sq_entries * sizeof (unsigned);
+    u->cq_size = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_size > u->sq_size)
+            u->sq_size = u->cq_size;
+        u->cq_size = u->sq_size;
+    }
+    u->sq_ptr = mmap(NULL, u->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            u->ring_fd, IORING_OFF_SQ_RING);
+    if (u->sq_ptr == MAP_FAILED)
+        goto map_error;
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        u->cq_ptr = u->sq_ptr;
+    else {
+        u->cq_ptr = mmap(NULL, u->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                u->ring_fd, IORING_OFF_CQ_RING);
+        if (u->cq_ptr == MAP_FAILED)
+            goto map_error;
+    }
+    u->sqes = mmap(NULL, p.sq_entries * sizeof (struct io_uring_sqe), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED)
+        goto map_error;
+
+    sq = u->sq_ptr;
+    cq = u->cq_ptr;
+    u->sq_entries = p.sq_entries;
+    u->sq_head  = (unsigned *) (sq + p.sq_off.head);
+    u->sq_tail  = (unsigned *) (sq + p.sq_off.tail);
+    u->sq_mask  = (unsigned *) (sq + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *) (sq + p.sq_off.array);
+    u->cq_head  = (unsigned *) (cq + p.cq_off.head);
+    u->cq_tail  = (unsigned *) (cq + p.cq_off.tail);
+    u->cq_mask  = (unsigned *) (cq + p.cq_off.ring_mask);
+    u->cqes     = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+
+    /* flush_bytes plus the frame that crosses it, pre-faulted */
+    u->buf_size = st->policy.flush_bytes + HDLC_MAX_FRAME_SIZE + 1;
+    u->buf_size = (u->buf_size + 4095) & ~(size_t) 4095;
+    if (posix_memalign((void **) &u->pool, 4096, u->buf_size * URING_BUFS) != 0) {
+        printf("io_uring buffer alloc error=%d %s\n", ENOMEM, strerror(ENOMEM));
+        u->pool = NULL;
+        st->ops = &uring_ops;
+        return -1;
+    }
+    memset(u->pool, 0, u->buf_size * URING_BUFS);
+    for (i = 0; i < URING_BUFS; i++) {
+        iov[i].iov_base = buf_data(u, i);
+        iov[i].iov_len = u->buf_size;
+    }
+    if (sys_io_uring_register(u->ring_fd, IORING_REGISTER_BUFFERS, iov, URING_BUFS) == 0)
+        u->fixed = 1;
+    else
+        printf("io_uring buffer registration error=%d %s, using unregistered buffers\n",
+                errno, strerror(errno));
+
+    st->ops = &uring_ops;
+    printf("io_uring storage: %d x %zu byte %s buffers\n", URING_BUFS, u->buf_size,
+            u->fixed ? "registered" : "unregistered");
+    return 0;
+
+map_error:
+    printf("io_uring mmap error=%d %s\n", errno, strerror(errno));
+    if (u->sq_ptr != NULL && u->sq_ptr != MAP_FAILED)
+        munmap(u->sq_ptr, u->sq_size);
+    if (u->cq_ptr != NULL && u->cq_ptr != MAP_FAILED && u->cq_ptr != u->sq_ptr)
+        munmap(u->cq_ptr, u->cq_size);
+    close(u->ring_fd);
+    free(u);
+    st->priv = NULL;
+    return -1;
+}
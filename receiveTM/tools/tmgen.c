@@ -0,0 +1,652 @@
+/*******************************************************************************
+ *
+ *               MOSES telemetry ground station code
+ *                     Montana State University
+ *
+ *
+ * Filename      : tmgen.c
+ * Header(s)     : journal.h, framing.h, crc32c.h, sha256.h, rs.h
+ * Description   : Synthetic MOSES downlink generator for exercising receiveTM
+ *                 without the Synclink adapter. Sends the same frame sequence
+ *                 as flightSW: image data frames, a 16 byte terminator holding
+ *                 the image file name, one <ROEIMAGE> catalog entry and a
+ *                 14 byte XML terminator, for each image.
+ *
+ *                 Targets match receiveTM frame sources:
+ *                     fifo:/path  pty:/dev/pts/N  file:/path   (length-prefixed)
+ *                     udp:[addr:]port                          (one datagram/frame)
+ *                     tmj:/path                                (capture journal)
+ *                 A capture journal is written as receiveTM -j would have
+ *                 recorded the pass, timestamped at the line rate but
+ *                 without waiting for it.
+ *
+ *                     tmgen -i 5 -m 10 udp:5000     five images at 10 Mbps
+ *                     tmgen -m 0 fifo:/tmp/tm.fifo  as fast as possible
+ *
+ *                 Given several targets, every frame goes to each of them,
+ *                 each paced to the line rate on its own, to load a
+ *                 multi-source receiveTM:
+ *                     tmgen -i 5 udp:5000 udp:5001
+ *
+ *                 -e and -d inject receive errors, drawn independently for
+ *                 each target, so two targets look like two receivers of one
+ *                 downlink. A CRC error is recorded in a journal as a
+ *                 corrupted frame flagged JOURNAL_REC_CRC, and dropped on
+ *                 other targets; a dropped frame is missing everywhere:
+ *                     tmgen -e 200 tmj:/tmp/a.tmj tmj:/tmp/b.tmj
+ *
+ *                 -X N loses the catalog entry frame of every Nth image on
+ *                 every target, its XML terminator still sent: the receiver
+ *                 has to carry on with the catalog it has, on any back-end:
+ *                     tmgen -i 4 -X 2 tmj:/tmp/noentry.tmj
+ *                 -x n sends each entry in frames of n bytes instead, so
+ *                 its tags can be split across frames:
+ *                     tmgen -i 3 -x 216 tmj:/tmp/split.tmj
+ *
+ *                 -H puts receiveTM's framing header (framing.h) in front of
+ *                 every frame, numbered in sequence on stream 0, for
+ *                 receivetm -H:
+ *                     tmgen -H -d 300 tmj:/tmp/framed.tmj
+ *
+ *                 -C adds the CRC-32C trailers (and implies -H). -c N
+ *                 corrupts about one frame in N after its CRC-32C was
+ *                 computed, and the link's CRC-16 passes it: only the
+ *                 CRC-32C catches it. -b times the CRC-32C and SHA-256
+ *                 kernels instead of sending anything:
+ *                     tmgen -C -c 500 tmj:/tmp/crc.tmj
+ *                     tmgen -b
+ *
+ *                 -E I sends every frame as Reed-Solomon codeblocks
+ *                 interleaved I deep (rs.h), for receivetm -E; errors are
+ *                 injected into the coded frame. -B n makes every -e and -c
+ *                 error a burst of n random bytes, which the decoder
+ *                 corrects up to 16 x I bytes. Replaying the journal is the
+ *                 corruption test of the FEC stage, and -b times the
+ *                 decoder on clean frames and on frames with errors:
+ *                     tmgen -E 8 -e 20 -B 100 tmj:/tmp/fec.tmj
+ *                     receivetm -n -E 8 -o /tmp/tm file:/tmp/fec.tmj
+ *                     tmgen -b -E 8
+ *
+ *                 Built alongside receivetm by the project Makefile.
+ * Function(s)   : int main(int, char*)
+ * Authors(s)    : MOSES ground station team
+ * Date          : Created 10/16/26
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../journal.h"
+#include "../framing.h"
+#include "../crc32c.h"
+#include "../sha256.h"
+#include "../rs.h"
+
+#define IMAGE_WIDTH    2048
+#define IMAGE_HEIGHT   1024
+#define IMAGE_CHANNELS 3
+#define IMAGE_SIZE     (IMAGE_WIDTH * IMAGE_HEIGHT * 2 * IMAGE_CHANNELS)
+
+#define TERM_IMAGE_LEN 16
+#define TERM_XML_LEN   14
+#define XML_TERM       "<!--XMLEND-->\n"
+
+#define TARGETS_MAX    16
+
+typedef struct tm_target {
+    int    fd;
+    int    udp;
+    int    tmj;                         //capture journal: records, no pacing
+    double mbps;                        //0 sends as fast as possible
+    double sent_bits;
+    struct timespec start;
+    unsigned int seed;                  //error injection, its own per target
+    unsigned long crc_errs;             //frames sent with a CRC error, or dropped for one
+    unsigned long drops;                //frames not sent at all
+    unsigned long corrupted;            //frames sent corrupted but not flagged
+    __u32  crc_pending;                 //CRC errors not recorded yet, journal frame records carry them
+} tm_target;
+
+static unsigned int crc_every;          //-e: a CRC error in about one frame in N, 0 none
+static unsigned int drop_every;         //-d: a dropped frame in about one in N, 0 none
+static unsigned int lose_entry;         //-X: the catalog entry of every Nth image is lost, 0 none
+static size_t entry_frame;              //-x: catalog entry frame size, 0 one frame
+static unsigned int corrupt_every;      //-c: a corrupted frame the link CRC misses in about one in N
+static double line_bits;                //bits offered to the link, for journal timestamps
+static int framed;                      //-H: a framing header in front of every frame
+static int crc_trailer;                 //-C: ...and a CRC-32C at the end of it
+static int fec_depth;                   //-E: Reed-Solomon codeblocks this deep, 0 none
+static unsigned int burst_len;          //-B: errors are bursts of this many bytes, 0 a bit flip or two
+static __u32 frame_seq;
+static __u32 frame_image;
+
+static int write_all(int fd, const void *buf, size_t len);
+
+/* The journal file header receiveTM writes, see journal.c */
+static int journal_header(tm_target *t) {
+    journal_file_hdr hdr;
+    struct timespec now;
+
+    memset(&hdr, 0, sizeof (hdr));
+    memcpy(hdr.magic, JOURNAL_MAGIC, sizeof (hdr.magic));
+    hdr.version = JOURNAL_VERSION;
+    hdr.hdr_size = sizeof (hdr);
+    clock_gettime(CLOCK_REALTIME, &now);
+    hdr.start_wall_ns = (__u64) now.tv_sec * 1000000000ull + now.tv_nsec;
+    snprintf(hdr.source, sizeof (hdr.source), "tmgen");
+    if (write_all(t->fd, &hdr, sizeof (hdr)) < 0) {
+        printf("write error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int target_open(tm_target *t, const char *spec) {
+    const char *arg = strchr(spec, ':');
+    struct sockaddr_in addr;
+    char host[256] = "127.0.0.1";
+    const char *port;
+
+    if (arg == NULL) {
+        printf("target must be fifo:, pty:, file:, udp: or tmj:\n");
+        return -1;
+    }
+    arg++;
+
+    if (strncmp(spec, "udp:", 4) == 0) {
+        port = strrchr(arg, ':');
+        if (port != NULL) {
+            snprintf(host, sizeof (host), "%.*s", (int) (port - arg), arg);
+            port++;
+        } else port = arg;
+
+        memset(&addr, 0, sizeof (addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port   = htons((unsigned short) atoi(port));
+        inet_pton(AF_INET, host, &addr.sin_addr);
+        t->fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (t->fd < 0 || connect(t->fd, (struct sockaddr *) &addr, sizeof (addr)) < 0) {
+            printf("udp error=%d %s\n", errno, strerror(errno));
+            return -1;
+        }
+        t->udp = 1;
+    } else if (strncmp(spec, "file:", 5) == 0 || strncmp(spec, "tmj:", 4) == 0) {
+        t->fd = open(arg, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        t->tmj = (spec[0] == 't');
+    } else {
+        t->fd = open(arg, O_WRONLY | O_NOCTTY);
+    }
+    if (t->fd < 0) {
+        printf("open error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t->start);
+    if (t->tmj)
+        return journal_header(t);
+    return 0;
+}
+
+static int write_all(int fd, const void *buf, size_t len) {
+    const unsigned char *p = buf;
+    ssize_t rc;
+
+    while (len > 0) {
+        rc = write(fd, p, len);
+        if (rc < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += rc;
+        len -= rc;
+    }
+    return 0;
+}
+
+/* One journal record; ns is the frame's time on the line */
+static int journal_frame(tm_target *t, const unsigned char *buf, size_t len, __u64 ns, __u32 flags) {
+    static const unsigned char pad[8];
+    journal_rec_hdr rec;
+
+    memset(&rec, 0, sizeof (rec));
+    rec.sync = JOURNAL_REC_SYNC;
+    rec.len = len;
+    rec.mono_ns = ns;
+    rec.wall_ns = ns;
+    rec.crc_errs = t->crc_pending;
+    rec.flags = flags;
+    t->crc_pending = 0;
+    if (write_all(t->fd, &rec, sizeof (rec)) < 0 || write_all(t->fd, buf, len) < 0 ||
+            write_all(t->fd, pad, JOURNAL_REC_ALIGN(len) - len) < 0) {
+        printf("write error=%d %s\n", errno, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* Send one frame, pacing to the requested line rate */
+static int send_frame(tm_target *t, const unsigned char *buf, size_t len, __u64 ns, __u32 flags) {
+    unsigned char hdr[4];
+    struct timespec now, ts;
+    double due, elapsed;
+
+    if (t->tmj) {
+        t->sent_bits += 8.0 * len;
+        return journal_frame(t, buf, len, ns, flags);
+    } else if (t->udp) {
+        if (send(t->fd, buf, len, 0) < 0) {
+            printf("send error=%d %s\n", errno, strerror(errno));
+            return -1;
+        }
+    } else {
+        hdr[0] = len & 0xff;
+        hdr[1] = (len >> 8) & 0xff;
+        hdr[2] = (len >> 16) & 0xff;
+        hdr[3] = (len >> 24) & 0xff;
+        if (write_all(t->fd, hdr, 4) < 0 || write_all(t->fd, buf, len) < 0) {
+            printf("write error=%d %s\n", errno, strerror(errno));
+            return -1;
+        }
+    }
+
+    t->sent_bits += 8.0 * len;
+    if (t->mbps > 0) {
+        due = t->sent_bits / (t->mbps * 1e6);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        elapsed = (now.tv_sec - t->start.tv_sec) + (now.tv_nsec - t->start.tv_nsec) / 1e9;
+        if (due > elapsed) {
+            ts.tv_sec  = (time_t) (due - elapsed);
+            ts.tv_nsec = (long) ((due - elapsed - ts.tv_sec) * 1e9);
+            nanosleep(&ts, NULL);
+        }
+    }
+    return 0;
+}
+
+/* A receive error in a copy of the frame: flips bits, or with -B scrambles a run of bytes */
+static void damage(tm_target *t, unsigned char *buf, size_t len, unsigned char bits) {
+    size_t start, n;
+
+    if (burst_len == 0) {
+        buf[rand_r(&t->seed) % len] ^= bits;
+        return;
+    }
+    n = burst_len < len ? burst_len : len;
+    start = rand_r(&t->seed) % (len - n + 1);
+    for (; n > 0; n--, start++)
+        buf[start] ^= 1 + rand_r(&t->seed) % 255;
+}
+
+/* The same frame to every target, each with its own receive errors; len 0 ends the pass */
+static int send_all(tm_target *t, int nt, const unsigned char *buf, size_t len) {
+    static unsigned char bad[1 << 17];
+    static unsigned char coded[1 << 17];
+    struct timespec now;
+    __u64 ns;
+    int i;
+
+    /* errors strike the frame as it is on the line */
+    if (fec_depth > 0 && len > 0) {
+        len = rs_encode(buf, len, coded, fec_depth);
+        buf = coded;
+    }
+
+    /* journal timestamp: when the frame is on the line at the requested rate */
+    if (t[0].mbps > 0) {
+        ns = (__u64) t[0].start.tv_sec * 1000000000ull + t[0].start.tv_nsec +
+                (__u64) (line_bits / t[0].mbps * 1e3);
+    } else {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        ns = (__u64) now.tv_sec * 1000000000ull + now.tv_nsec;
+    }
+    line_bits += 8.0 * len;
+
+    for (i = 0; i < nt; i++) {
+        if (len == 0) {
+            if (!t[i].tmj && send_frame(&t[i], buf, 0, ns, 0) < 0)
+                return -1;
+            continue;
+        }
+        if (drop_every > 0 && rand_r(&t[i].seed) % drop_every == 0) {
+            t[i].drops++;
+            continue;
+        }
+        if (crc_every > 0 && rand_r(&t[i].seed) % crc_every == 0 && len <= sizeof (bad)) {
+            t[i].crc_errs++;
+            t[i].crc_pending++;         //counted in the link statistics of the record that carries it
+            if (!t[i].tmj)
+                continue;               //the driver drops it
+            memcpy(bad, buf, len);
+            damage(&t[i], bad, len, 0x10);
+            if (burst_len == 0)
+                damage(&t[i], bad, len, 0x01);
+            if (send_frame(&t[i], bad, len, ns, JOURNAL_REC_CRC) < 0)
+                return -1;
+            continue;
+        }
+        if (corrupt_every > 0 && rand_r(&t[i].seed) % corrupt_every == 0 && len <= sizeof (bad)) {
+            t[i].corrupted++;
+            memcpy(bad, buf, len);
+            damage(&t[i], bad, len, 0x04);
+            if (send_frame(&t[i], bad, len, ns, 0) < 0)
+                return -1;
+            continue;
+        }
+        if (send_frame(&t[i], buf, len, ns, 0) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*
+ * One frame of the downlink, behind a framing header with -H; offset is where
+ * it goes. With -C an image terminator also carries image_crc.
+ */
+static int send_tm(tm_target *t, int nt, unsigned int type, const unsigned char *buf, size_t len, __u32 offset,
+                   __u32 image_crc) {
+    static unsigned char frame[FRAMING_HDR_LEN + (1 << 16) + 2 * FRAMING_CRC_LEN];
+    frame_hdr h;
+
+    if (!framed)
+        return send_all(t, nt, buf, len);
+    h.type = type;
+    h.stream = 0;
+    h.image = frame_image;
+    h.seq = frame_seq++;
+    h.offset = offset;
+    h.crc = crc_trailer;
+    h.image_crc = image_crc;
+    framing_put(frame, &h);
+    memcpy(frame + FRAMING_HDR_LEN, buf, len);
+    return send_all(t, nt, frame, framing_seal(frame, FRAMING_HDR_LEN + len, &h));
+}
+
+/* Image data (or a -x catalog entry) in frame_size pieces; never lets one look like a terminator */
+static int send_image(tm_target *t, int nt, unsigned int type, unsigned char *image, size_t size,
+                      size_t frame_size) {
+    size_t off = 0, len;
+
+    while (off < size) {
+        len = size - off;
+        if (len > frame_size)
+            len = frame_size;
+        if (off + len < size && (size - off - len == TERM_IMAGE_LEN || size - off - len == TERM_XML_LEN))
+            len -= 8;
+        if (len == TERM_IMAGE_LEN || len == TERM_XML_LEN)
+            len = size - off;
+        if (send_tm(t, nt, type, image + off, len, off, 0) < 0)
+            return -1;
+        off += len;
+    }
+    return 0;
+}
+
+/*
+ * -b -E: Reed-Solomon decoding of a data frame coded depth deep, clean and
+ * with about 8 symbol errors in every codeword (half what the code corrects), and
+ * the share of one core receivetm -E needs for it at 10 Mbps.
+ */
+static int rs_bench(const unsigned char *buf, size_t frame_size, int depth) {
+    const char *kernel = rs_init();
+    int wire = rs_encoded_len(frame_size, depth);
+    unsigned char *coded = malloc(wire);
+    unsigned char *bad = malloc(wire);
+    unsigned char *out = malloc(frame_size);
+    struct timespec start, now;
+    unsigned long frames;
+    double secs;
+    rs_stats st;
+    int failed = 0;
+    int k, n, i;
+
+    if (coded == NULL || bad == NULL || out == NULL) {
+        free(coded);
+        free(bad);
+        free(out);
+        return -1;
+    }
+    rs_encode(buf, frame_size, coded, depth);
+    memcpy(bad, coded, wire);
+    for (i = 0; i < wire; i++)            //one symbol in 32 of each interleaved codeword
+        if (i / depth % 32 == 0)
+            bad[i] ^= 0x5a;
+    for (k = 0; k < 2 && !failed; k++) {
+        memset(&st, 0, sizeof (st));
+        frames = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        do {
+            for (n = 0; n < 100 && !failed; n++)
+                failed = rs_decode(k == 0 ? coded : bad, wire, out, depth, &st) != (int) frame_size ||
+                        memcmp(out, buf, frame_size) != 0;
+            frames += n;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            secs = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+        } while (!failed && secs < 0.5);
+        if (failed) {
+            printf("RS(255,223) decoding a %s frame failed\n", k == 0 ? "clean" : "damaged");
+            break;
+        }
+        printf("RS(255,223) %-6s I=%d %zu byte frames %s: %8.0f MB/s, %.3f us per frame, %.2f%% of a core at 10 Mbps\n",
+                kernel, depth, frame_size, k == 0 ? "clean      " : "with errors", frames * frame_size / secs / 1e6,
+                secs / frames * 1e6, 10e6 / 8 / wire * (secs / frames) * 100);
+        if (k == 1)
+            printf("RS(255,223) %lu codewords with errors per frame, %lu symbols corrected\n",
+                    st.bad / frames, st.symbols / frames);
+    }
+    free(coded);
+    free(bad);
+    free(out);
+    return failed ? -1 : 0;
+}
+
+/*
+ * -b: CRC-32C throughput of each kernel on data frames, and what it costs
+ * receivetm -H at the 10 Mbps line rate, which runs it over every image
+ * byte twice (the frame's CRC and the image's); then the same for the
+ * SHA-256 of every image, and Reed-Solomon decoding with -E.
+ */
+static int crc_bench(size_t frame_size) {
+    const char *kernel = crc32c_init();
+    unsigned char *buf = malloc(frame_size);
+    unsigned char digest[SHA256_LEN];
+    struct timespec start, now;
+    unsigned long frames;
+    double secs, bytes_s;
+    sha256_ctx sha;
+    __u32 crc = 0;
+    size_t i;
+    int k, n;
+
+    if (buf == NULL)
+        return -1;
+    for (i = 0; i < frame_size; i++)
+        buf[i] = i * 7;
+    for (k = 0; k < 2; k++) {
+        if (k == 1 && strcmp(kernel, "slice-by-8") == 0)
+            break;
+        frames = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        do {
+            for (n = 0; n < 1000; n++)
+                crc = k == 0 ? crc32c(crc, buf, frame_size) : crc32c_sw(crc, buf, frame_size);
+            frames += n;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            secs = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+        } while (secs < 0.5);
+        bytes_s = frames * frame_size / secs;
+        printf("CRC-32C %-10s %zu byte frames: %8.0f MB/s, %.3f us per frame, %.4f%% of a core at 10 Mbps\n",
+                k == 0 ? kernel : "slice-by-8", frame_size, bytes_s / 1e6, secs / frames * 1e6,
+                2 * 10e6 / 8 / bytes_s * 100);
+    }
+
+    kernel = sha256_setup();
+    sha256_init(&sha);
+    frames = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        for (n = 0; n < 100; n++)
+            sha256_update(&sha, buf, frame_size);
+        frames += n;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        secs = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+    } while (secs < 0.5);
+    sha256_final(&sha, digest);
+    bytes_s = frames * frame_size / secs;
+    printf("SHA-256 %-10s %zu byte frames: %8.0f MB/s, %.3f us per frame, %.4f%% of a core at 10 Mbps\n",
+            kernel, frame_size, bytes_s / 1e6, secs / frames * 1e6, 10e6 / 8 / bytes_s * 100);
+    if (fec_depth > 0 && rs_bench(buf, frame_size, fec_depth) < 0) {
+        free(buf);
+        return -1;
+    }
+    free(buf);
+    return 0;
+}
+
+static void usage(char *prog) {
+    printf("usage: %s [-bCH] [-E depth] [-i images] [-s image_bytes] [-f frame_bytes] [-m Mbps] [-e N] [-d N] [-c N]\n"
+           "          [-B bytes] [-X N] [-x bytes] target...\n", prog);
+    printf("    -b              time the CRC-32C and SHA-256 kernels (and RS decoding with -E) on frame_bytes\n"
+           "                    frames, send nothing\n");
+    printf("    -C              CRC-32C trailer on every frame and the image CRC-32C on terminators (implies -H)\n");
+    printf("    -E depth        Reed-Solomon (255,223) codeblocks interleaved depth deep (1-%d), for receivetm -E\n",
+            RS_DEPTH_MAX);
+    printf("    -H              framing header on every frame, for receivetm -H\n");
+    printf("    -i images       images to send (default 1)\n");
+    printf("    -s image_bytes  image size (default %d)\n", IMAGE_SIZE);
+    printf("    -f frame_bytes  data frame size (default 4096)\n");
+    printf("    -m Mbps         line rate, 0 = as fast as possible (default 10)\n");
+    printf("    -e N            a CRC error in about one frame in N, on each target\n");
+    printf("    -d N            a dropped frame in about one in N, on each target\n");
+    printf("    -X N            the catalog entry frame of every Nth image is lost, on every target\n");
+    printf("    -x bytes        catalog entry frame size (default one frame per entry)\n");
+    printf("    -c N            a corrupted frame that passes the link CRC in about one in N, on each target\n");
+    printf("    -B bytes        -e and -c errors are bursts of this many random bytes\n");
+    printf("    target          fifo:path | pty:/dev/pts/N | file:path | udp:[addr:]port | tmj:path\n");
+    printf("                    (up to %d, each sent every frame)\n", TARGETS_MAX);
+}
+
+int main(int argc, char *argv[]) {
+    tm_target t[TARGETS_MAX];
+    int nt = 0;
+    double mbps = 10;
+    unsigned char *image;
+    char name[TERM_IMAGE_LEN + 1];
+    char xml[1024];
+    int images = 1;
+    size_t size = IMAGE_SIZE;
+    size_t frame_size = 4096;
+    time_t stamp = time(NULL);
+    struct tm ts;
+    struct timespec end;
+    double secs;
+    size_t i;
+    int bench = 0;
+    int n, opt;
+
+    memset(t, 0, sizeof (t));
+
+    while ((opt = getopt(argc, argv, "bCE:Hi:s:f:m:e:d:c:B:X:x:h")) != -1) {
+        switch (opt) {
+            case 'b': bench = 1; break;
+            case 'C': framed = crc_trailer = 1; break;
+            case 'E': fec_depth = atoi(optarg); break;
+            case 'H': framed = 1; break;
+            case 'i': images = atoi(optarg); break;
+            case 's': size = strtoul(optarg, NULL, 0); break;
+            case 'f': frame_size = strtoul(optarg, NULL, 0); break;
+            case 'm': mbps = atof(optarg); break;
+            case 'e': crc_every = strtoul(optarg, NULL, 0); break;
+            case 'd': drop_every = strtoul(optarg, NULL, 0); break;
+            case 'X': lose_entry = strtoul(optarg, NULL, 0); break;
+            case 'x': entry_frame = strtoul(optarg, NULL, 0); break;
+            case 'c': corrupt_every = strtoul(optarg, NULL, 0); break;
+            case 'B': burst_len = strtoul(optarg, NULL, 0); break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (fec_depth < 0 || fec_depth > RS_DEPTH_MAX) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (bench)
+        return crc_bench(frame_size) < 0;
+    if (optind >= argc || argc - optind > TARGETS_MAX || frame_size <= TERM_IMAGE_LEN + 8 || frame_size > (1 << 16) ||
+            (entry_frame > 0 && entry_frame <= TERM_IMAGE_LEN + 8)) {
+        usage(argv[0]);
+        return 1;
+    }
+    for (; optind < argc; optind++, nt++) {
+        t[nt].mbps = mbps;
+        t[nt].seed = 0x5eed + nt * 7919;
+        if (target_open(&t[nt], argv[optind]) < 0)
+            return 1;
+    }
+
+    image = malloc(size);
+    if (image == NULL)
+        return 1;
+    if (crc_trailer)
+        crc32c_init();
+    if (fec_depth > 0)
+        rs_init();
+
+    for (n = 0; n < images; n++) {
+        frame_image = n;
+        /* same ramp the ROE test pattern produces */
+        for (i = 0; i + 1 < size; i += 2) {
+            image[i]     = (i / 2) & 0xff;
+            image[i + 1] = 0x40 | (((i / 2) >> 8) & 0x0f) | (n & 0x3) << 4;
+        }
+        if (send_image(t, nt, FRAMING_DATA, image, size, frame_size) < 0)
+            return 1;
+
+        ts = *localtime(&stamp);
+        strftime(name, sizeof (name), "%y%m%d%H%M%S", &ts);
+        memcpy(name + 12, ".roe", 4);
+        if (send_tm(t, nt, FRAMING_TERM_IMAGE, (unsigned char *) name, TERM_IMAGE_LEN, size,
+                crc_trailer ? crc32c(0, image, size) : 0) < 0)
+            return 1;
+
+        snprintf(xml, sizeof (xml),
+                "<ROEIMAGE>\n\t<FILENAME>/mdata/%.16s</FILENAME>\n"
+                "\t<NAME>sequence/tmgen.seq</NAME>\n\t<BITPIX>16</BITPIX>\n"
+                "\t<WIDTH>%d</WIDTH>\n\t<HEIGHT>%d</HEIGHT>\n"
+                "\t<INSTRUMENT>MOSES</INSTRUMENT>\n\t<CHANNELS>123</CHANNELS>\n"
+                "</ROEIMAGE>\n", name, IMAGE_WIDTH, IMAGE_HEIGHT);
+        if (lose_entry > 0 && (n + 1) % lose_entry == 0)
+            frame_seq++;                //lost on the way: a gap in the sequence with -H
+        else if (send_image(t, nt, FRAMING_XML, (unsigned char *) xml, strlen(xml),
+                entry_frame ? entry_frame : strlen(xml)) < 0)
+            return 1;
+        if (send_tm(t, nt, FRAMING_TERM_XML, (unsigned char *) XML_TERM, TERM_XML_LEN, strlen(xml), 0) < 0)
+            return 1;
+        stamp++;
+    }
+
+    /* zero length frame ends the pass for fifo/file/udp sources */
+    send_all(t, nt, (unsigned char *) "", 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    secs = (end.tv_sec - t[0].start.tv_sec) + (end.tv_nsec - t[0].start.tv_nsec) / 1e9;
+    printf("sent %d images to %d target%s, %.1f MB each in %.2f s (%.1f Mbps each)\n", images, nt,
+            nt > 1 ? "s" : "", t[0].sent_bits / 8e6, secs, t[0].sent_bits / secs / 1e6);
+
+    for (n = 0; n < nt; n++) {
+        if (t[n].crc_errs + t[n].drops + t[n].corrupted > 0)
+            printf("%s: %lu CRC errors, %lu frames dropped, %lu corrupted past the link CRC\n",
+                    argv[argc - nt + n], t[n].crc_errs, t[n].drops, t[n].corrupted);
+        close(t[n].fd);
+    }
+    free(image);
+    return 0;
+}